@@ -285,6 +285,10 @@ impl<'c> MoneroWalletRpc {
         &self.client
     }
 
+    pub fn rpc_port(&self) -> u16 {
+        self.rpc_port
+    }
+
     // It takes a little while for the wallet to sync with monerod.
     pub async fn wait_for_wallet_height(&self, height: u32) -> Result<()> {
         let mut retry: u8 = 0;
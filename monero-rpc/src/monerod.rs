@@ -12,6 +12,14 @@ pub trait MonerodRpc {
     async fn get_block_header_by_height(&self, height: u32) -> BlockHeader;
     async fn get_block_count(&self) -> BlockCount;
     async fn get_block(&self, height: u32) -> GetBlockResponse;
+    async fn get_output_distribution(
+        &self,
+        amounts: Vec<u64>,
+        from_height: u64,
+        to_height: u64,
+        cumulative: bool,
+        binary: bool,
+    ) -> GetOutputDistribution;
 }
 
 #[jsonrpc_client::implement(MonerodRpc)]
@@ -21,6 +29,7 @@ pub struct Client {
     base_url: reqwest::Url,
     get_o_indexes_bin_url: reqwest::Url,
     get_outs_bin_url: reqwest::Url,
+    get_transactions_url: reqwest::Url,
 }
 
 impl Client {
@@ -29,6 +38,20 @@ impl Client {
         Self::new("127.0.0.1".to_owned(), port)
     }
 
+    /// New monerod RPC client for an address of the form `host:port`, as
+    /// passed to monero-wallet-rpc's `--daemon-address`.
+    pub fn from_daemon_address(address: &str) -> Result<Self> {
+        let address = address.trim_start_matches("http://").trim_end_matches('/');
+        let (host, port) = address
+            .rsplit_once(':')
+            .with_context(|| format!("Monero daemon address {} is missing a port", address))?;
+        let port = port
+            .parse()
+            .with_context(|| format!("Invalid port in Monero daemon address {}", address))?;
+
+        Self::new(host.to_owned(), port)
+    }
+
     fn new(host: String, port: u16) -> Result<Self> {
         Ok(Self {
             inner: reqwest::ClientBuilder::new()
@@ -43,6 +66,9 @@ impl Client {
             get_outs_bin_url: format!("http://{}:{}/get_outs.bin", host, port)
                 .parse()
                 .context("url is well formed")?,
+            get_transactions_url: format!("http://{}:{}/get_transactions", host, port)
+                .parse()
+                .context("url is well formed")?,
         })
     }
 
@@ -58,6 +84,30 @@ impl Client {
             .await
     }
 
+    /// Fetches transactions from the pool or the blockchain, decoded as JSON.
+    pub async fn get_transactions(&self, txids: Vec<String>) -> Result<GetTransactionsResponse> {
+        let response = self
+            .inner
+            .post(self.get_transactions_url.clone())
+            .json(&GetTransactionsPayload {
+                txs_hashes: txids,
+                decode_as_json: true,
+            })
+            .send()
+            .await?;
+
+        if !response.status().is_success() {
+            anyhow::bail!("Request failed with status code {}", response.status())
+        }
+
+        let response = response.json::<GetTransactionsResponse>().await?;
+        if response.status != "OK" {
+            anyhow::bail!("Failed to get transactions: {}", response.status)
+        }
+
+        Ok(response)
+    }
+
     async fn binary_request<Req, Res>(&self, url: reqwest::Url, request: Req) -> Result<Res>
     where
         Req: Serialize,
@@ -114,6 +164,25 @@ pub struct BlockHeader {
 pub struct GetBlockResponse {
     #[serde(with = "monero_serde_hex_block")]
     pub blob: monero::Block,
+    /// Hex encoded hashes of the transactions in the block, without the miner
+    /// transaction.
+    #[serde(default)]
+    pub tx_hashes: Vec<String>,
+}
+
+#[derive(Clone, Debug, Deserialize)]
+pub struct GetOutputDistribution {
+    pub distributions: Vec<OutputDistribution>,
+}
+
+#[derive(Clone, Debug, Deserialize)]
+pub struct OutputDistribution {
+    pub amount: u64,
+    pub start_height: u64,
+    /// Number of outputs per block from `start_height` on, or the number of
+    /// outputs up to and including each block if requested as cumulative.
+    pub distribution: Vec<u64>,
+    pub base: u64,
 }
 
 #[derive(Debug, Deserialize)]
@@ -173,6 +242,82 @@ pub struct GetOIndexesResponse {
     pub o_indexes: Vec<u64>,
 }
 
+#[derive(Clone, Debug, Serialize)]
+struct GetTransactionsPayload {
+    txs_hashes: Vec<String>,
+    decode_as_json: bool,
+}
+
+#[derive(Clone, Debug, Deserialize)]
+pub struct GetTransactionsResponse {
+    pub status: String,
+    #[serde(default)]
+    pub txs: Vec<TransactionEntry>,
+    #[serde(default)]
+    pub missed_tx: Vec<String>,
+}
+
+#[derive(Clone, Debug, Deserialize)]
+pub struct TransactionEntry {
+    pub tx_hash: String,
+    #[serde(with = "json_string")]
+    pub as_json: TransactionJson,
+    /// Only set once the transaction is included in a block.
+    #[serde(default)]
+    pub block_height: u64,
+    pub in_pool: bool,
+}
+
+/// The parts of a transaction, as decoded by monerod, that are needed to find
+/// and decrypt the outputs sent to an address.
+#[derive(Clone, Debug, Deserialize, PartialEq)]
+pub struct TransactionJson {
+    pub vout: Vec<TxOutJson>,
+    #[serde(default)]
+    pub extra: Vec<u8>,
+    pub rct_signatures: RctSignaturesJson,
+}
+
+#[derive(Clone, Debug, Deserialize, PartialEq)]
+pub struct TxOutJson {
+    pub amount: u64,
+    pub target: TxOutTargetJson,
+}
+
+#[derive(Clone, Debug, Deserialize, PartialEq)]
+#[serde(rename_all = "snake_case")]
+pub enum TxOutTargetJson {
+    Key(String),
+    TaggedKey { key: String, view_tag: String },
+}
+
+impl TxOutTargetJson {
+    /// The hex encoded one-time public key of the output.
+    pub fn key(&self) -> &str {
+        match self {
+            TxOutTargetJson::Key(key) => key,
+            TxOutTargetJson::TaggedKey { key, .. } => key,
+        }
+    }
+}
+
+#[derive(Clone, Debug, Deserialize, PartialEq)]
+pub struct RctSignaturesJson {
+    #[serde(rename = "type")]
+    pub rct_type: u8,
+    #[serde(rename = "ecdhInfo", default)]
+    pub ecdh_info: Vec<EcdhInfoJson>,
+    /// Hex encoded amount commitments of the outputs.
+    #[serde(rename = "outPk", default)]
+    pub out_pk: Vec<String>,
+}
+
+#[derive(Clone, Debug, Deserialize, PartialEq)]
+pub struct EcdhInfoJson {
+    /// Hex encoded encrypted amount.
+    pub amount: String,
+}
+
 #[derive(Clone, Copy, Debug, Deserialize, PartialEq)]
 pub enum Status {
     #[serde(rename = "OK")]
@@ -203,6 +348,23 @@ mod monero_serde_hex_block {
     }
 }
 
+/// monerod returns the decoded transaction as a JSON document inside a string.
+mod json_string {
+    use super::*;
+    use serde::de::Error;
+    use serde::Deserializer;
+
+    pub fn deserialize<'de, D, T>(deserializer: D) -> Result<T, D::Error>
+    where
+        D: Deserializer<'de>,
+        T: DeserializeOwned,
+    {
+        let json = String::deserialize(deserializer)?;
+
+        serde_json::from_str(&json).map_err(D::Error::custom)
+    }
+}
+
 mod byte_array {
     use super::*;
     use serde::de::Error;
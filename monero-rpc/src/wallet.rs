@@ -33,6 +33,11 @@ pub trait MoneroWalletRpc {
     async fn refresh(&self) -> Refreshed;
     async fn sweep_all(&self, address: String) -> SweepAll;
     async fn get_version(&self) -> Version;
+    async fn incoming_transfers(
+        &self,
+        transfer_type: String,
+        account_index: u32,
+    ) -> IncomingTransfers;
 }
 
 #[jsonrpc_client::implement(MoneroWalletRpc)]
@@ -92,6 +97,20 @@ pub struct GetBalance {
     pub unlocked_balance: u64,
 }
 
+#[derive(Deserialize, Debug, Clone)]
+pub struct IncomingTransfers {
+    #[serde(default)]
+    pub transfers: Vec<IncomingTransfer>,
+}
+
+#[derive(Deserialize, Debug, Clone)]
+pub struct IncomingTransfer {
+    pub amount: u64,
+    pub spent: bool,
+    pub tx_hash: String,
+    pub unlocked: bool,
+}
+
 #[derive(Deserialize, Debug, Clone)]
 pub struct CreateAccount {
     pub account_index: u32,
@@ -0,0 +1,277 @@
+//! Finds the outputs of a transaction that pay to an address and decrypts
+//! their amounts, given the secret key of the transaction.
+//!
+//! This is what monero-wallet-rpc's `check_tx_key` does, except that it only
+//! needs the transaction itself and not a synced wallet.
+
+use anyhow::{bail, Context, Result};
+use curve25519_dalek::constants::ED25519_BASEPOINT_TABLE;
+use curve25519_dalek::edwards::{CompressedEdwardsY, EdwardsPoint};
+use curve25519_dalek::scalar::Scalar;
+use monero::cryptonote::hash::keccak_256;
+use monero::{Address, PrivateKey};
+use monero_rpc::monerod::TransactionJson;
+use std::convert::TryFrom;
+
+/// RingCT types that encrypt amounts into 8 bytes, every other type is no
+/// longer accepted by the network.
+const COMPACT_AMOUNT_RCT_TYPES: [u8; 3] = [
+    4, // Bulletproof2
+    5, // CLSAG
+    6, // BulletproofPlus
+];
+
+/// The generator `H` that amounts are committed to.
+const H: CompressedEdwardsY = CompressedEdwardsY([
+    0x8b, 0x65, 0x59, 0x70, 0x15, 0x37, 0x99, 0xaf, 0x2a, 0xea, 0xdc, 0x9f, 0xf1, 0xad, 0xd0, 0xea,
+    0x6c, 0x72, 0x51, 0xd5, 0x41, 0x54, 0xcf, 0xa9, 0x2c, 0x17, 0x3a, 0x0d, 0xd3, 0x9c, 0x1f, 0x94,
+]);
+
+/// Sums up the amounts of all outputs of `tx` that pay to `address`.
+///
+/// Every amount is checked against its commitment, hence a sender cannot
+/// claim more than they actually locked.
+pub fn received_amount(tx: &TransactionJson, tx_key: PrivateKey, address: Address) -> Result<u64> {
+    let public_view = decompress(address.public_view.point)?;
+    let public_spend = decompress(address.public_spend.point)?;
+    let derivation = derivation(&tx_key.scalar, &public_view);
+
+    owned_outputs(tx, &derivation, &public_spend)?
+        .iter()
+        .try_fold(0u64, |received, output| received.checked_add(output.amount))
+        .context("Received amount overflows")
+}
+
+/// An output of a transaction that belongs to the keys it was searched with.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct OwnedOutput {
+    pub index: usize,
+    pub amount: u64,
+}
+
+/// The key derivation `8rA`, where either `r` is the secret key of a
+/// transaction and `A` the public view key of the recipient, or `r` the private
+/// view key and `A` the public key of the transaction.
+pub fn derivation(secret: &Scalar, public: &EdwardsPoint) -> CompressedEdwardsY {
+    (secret * public).mul_by_cofactor().compress()
+}
+
+/// Finds the outputs of `tx` that belong to the given derivation and public
+/// spend key, and decrypts their amounts.
+pub fn owned_outputs(
+    tx: &TransactionJson,
+    derivation: &CompressedEdwardsY,
+    public_spend: &EdwardsPoint,
+) -> Result<Vec<OwnedOutput>> {
+    let rct = &tx.rct_signatures;
+    let mut owned = Vec::new();
+
+    for (index, output) in tx.vout.iter().enumerate() {
+        let shared_secret = derivation_to_scalar(derivation, index);
+        let output_key = &shared_secret * &ED25519_BASEPOINT_TABLE + public_spend;
+
+        if bytes32(output.target.key())? != output_key.compress().to_bytes() {
+            continue;
+        }
+
+        if !COMPACT_AMOUNT_RCT_TYPES.contains(&rct.rct_type) {
+            bail!("Unsupported RingCT type {}", rct.rct_type)
+        }
+
+        let encrypted_amount = &rct
+            .ecdh_info
+            .get(index)
+            .with_context(|| format!("Missing encrypted amount of output {}", index))?
+            .amount;
+        let commitment = rct
+            .out_pk
+            .get(index)
+            .with_context(|| format!("Missing commitment of output {}", index))?;
+
+        let amount = decrypt_amount(&shared_secret, encrypted_amount)?;
+
+        let mask = hash_to_scalar(&[b"commitment_mask".as_ref(), shared_secret.as_bytes()]);
+        let expected_commitment = &mask * &ED25519_BASEPOINT_TABLE + Scalar::from(amount) * h();
+        if bytes32(commitment)? != expected_commitment.compress().to_bytes() {
+            bail!("Amount of output {} does not match its commitment", index)
+        }
+
+        owned.push(OwnedOutput { index, amount });
+    }
+
+    Ok(owned)
+}
+
+/// Derives the shared secret of the output at `index`, `Hs(8rA || index)`.
+fn derivation_to_scalar(derivation: &CompressedEdwardsY, index: usize) -> Scalar {
+    hash_to_scalar(&[derivation.as_bytes().as_ref(), &varint(index as u64)[..]])
+}
+
+fn decrypt_amount(shared_secret: &Scalar, encrypted_amount: &str) -> Result<u64> {
+    let encrypted_amount = <[u8; 8]>::try_from(hex::decode(encrypted_amount)?.as_slice())
+        .context("Encrypted amount is not 8 bytes long")?;
+    let key = keccak_256(&[b"amount".as_ref(), shared_secret.as_bytes()].concat());
+
+    let mut amount = [0u8; 8];
+    for (i, byte) in amount.iter_mut().enumerate() {
+        *byte = encrypted_amount[i] ^ key[i];
+    }
+
+    Ok(u64::from_le_bytes(amount))
+}
+
+fn hash_to_scalar(parts: &[&[u8]]) -> Scalar {
+    Scalar::from_bytes_mod_order(keccak_256(&parts.concat()))
+}
+
+fn varint(mut value: u64) -> Vec<u8> {
+    let mut bytes = Vec::new();
+
+    while value >= 0x80 {
+        bytes.push((value & 0x7f) as u8 | 0x80);
+        value >>= 7;
+    }
+    bytes.push(value as u8);
+
+    bytes
+}
+
+fn h() -> EdwardsPoint {
+    H.decompress().expect("H to be a valid point")
+}
+
+pub fn decompress(point: CompressedEdwardsY) -> Result<EdwardsPoint> {
+    point.decompress().context("Invalid public key")
+}
+
+fn bytes32(hex: &str) -> Result<[u8; 32]> {
+    <[u8; 32]>::try_from(hex::decode(hex)?.as_slice())
+        .with_context(|| format!("{} is not 32 bytes long", hex))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use curve25519_dalek::constants::ED25519_BASEPOINT_POINT;
+    use monero::{Network, PublicKey};
+    use monero_rpc::monerod::{EcdhInfoJson, RctSignaturesJson, TxOutJson, TxOutTargetJson};
+
+    #[test]
+    fn finds_and_decrypts_outputs_paying_to_address() {
+        let (tx_key, address) = keys();
+        let tx = transaction(tx_key, address, &[Some(1_000), None, Some(234)]);
+
+        let received = received_amount(&tx, tx_key, address).unwrap();
+
+        assert_eq!(received, 1_234);
+    }
+
+    #[test]
+    fn nothing_is_received_by_other_addresses() {
+        let (tx_key, address) = keys();
+        let (_, other_address) = keys();
+        let tx = transaction(tx_key, address, &[Some(1_000)]);
+
+        let received = received_amount(&tx, tx_key, other_address).unwrap();
+
+        assert_eq!(received, 0);
+    }
+
+    #[test]
+    fn amount_that_does_not_match_commitment_is_rejected() {
+        let (tx_key, address) = keys();
+        let mut tx = transaction(tx_key, address, &[Some(1_000)]);
+        tx.rct_signatures.ecdh_info[0] = transaction(tx_key, address, &[Some(2_000)])
+            .rct_signatures
+            .ecdh_info[0]
+            .clone();
+
+        let result = received_amount(&tx, tx_key, address);
+
+        assert!(result.is_err());
+    }
+
+    #[test]
+    fn varint_is_encoded_like_monero() {
+        assert_eq!(varint(0), vec![0x00]);
+        assert_eq!(varint(127), vec![0x7f]);
+        assert_eq!(varint(128), vec![0x80, 0x01]);
+        assert_eq!(varint(300), vec![0xac, 0x02]);
+    }
+
+    fn keys() -> (PrivateKey, Address) {
+        let mut rng = rand::thread_rng();
+        let tx_key = private_key(&mut rng);
+        let address = Address::standard(
+            Network::Mainnet,
+            PublicKey::from_private_key(&private_key(&mut rng)),
+            PublicKey::from_private_key(&private_key(&mut rng)),
+        );
+
+        (tx_key, address)
+    }
+
+    fn private_key(rng: &mut impl rand::RngCore) -> PrivateKey {
+        let mut bytes = [0u8; 64];
+        rng.fill_bytes(&mut bytes);
+
+        PrivateKey {
+            scalar: Scalar::from_bytes_mod_order_wide(&bytes),
+        }
+    }
+
+    /// Builds a transaction the way a sender would, paying the given amounts
+    /// to `address` or, for `None`, to a random other address.
+    fn transaction(
+        tx_key: PrivateKey,
+        address: Address,
+        amounts: &[Option<u64>],
+    ) -> TransactionJson {
+        let mut vout = Vec::new();
+        let mut ecdh_info = Vec::new();
+        let mut out_pk = Vec::new();
+
+        for (index, amount) in amounts.iter().enumerate() {
+            let recipient = match amount {
+                Some(_) => address,
+                None => keys().1,
+            };
+            let amount = amount.unwrap_or(42);
+
+            let public_view = recipient.public_view.point.decompress().unwrap();
+            let public_spend = recipient.public_spend.point.decompress().unwrap();
+            let derivation = derivation(&tx_key.scalar, &public_view);
+            let shared_secret = derivation_to_scalar(&derivation, index);
+
+            let output_key = shared_secret * ED25519_BASEPOINT_POINT + public_spend;
+            let key = keccak_256(&[b"amount".as_ref(), shared_secret.as_bytes()].concat());
+            let encrypted_amount = amount
+                .to_le_bytes()
+                .iter()
+                .zip(key.iter())
+                .map(|(amount, key)| amount ^ key)
+                .collect::<Vec<_>>();
+            let mask = hash_to_scalar(&[b"commitment_mask".as_ref(), shared_secret.as_bytes()]);
+            let commitment = mask * ED25519_BASEPOINT_POINT + Scalar::from(amount) * h();
+
+            vout.push(TxOutJson {
+                amount: 0,
+                target: TxOutTargetJson::Key(hex::encode(output_key.compress().as_bytes())),
+            });
+            ecdh_info.push(EcdhInfoJson {
+                amount: hex::encode(encrypted_amount),
+            });
+            out_pk.push(hex::encode(commitment.compress().as_bytes()));
+        }
+
+        TransactionJson {
+            vout,
+            extra: Vec::new(),
+            rct_signatures: RctSignaturesJson {
+                rct_type: 5,
+                ecdh_info,
+                out_pk,
+            },
+        }
+    }
+}
@@ -0,0 +1,216 @@
+//! Chooses decoys for the rings of new transactions like wallet2 does.
+//!
+//! The age of a decoy is drawn from a gamma distribution that was fitted to
+//! real spending patterns, and translated into an output index through the
+//! number of outputs per block. The distribution is cached, so choosing decoys
+//! does not talk to the daemon.
+
+use anyhow::{bail, Result};
+use rand::Rng;
+use rand_distr::{Distribution, Gamma};
+
+const GAMMA_SHAPE: f64 = 19.28;
+const GAMMA_SCALE: f64 = 1.0 / 1.61;
+
+/// Seconds between two blocks.
+const DIFFICULTY_TARGET: f64 = 120.0;
+
+/// Number of blocks on top of an output before it can be spent.
+const SPENDABLE_AGE: usize = 10;
+
+/// The density of outputs is averaged over a year of blocks.
+const BLOCKS_TO_CONSIDER: usize = 365 * 720;
+
+/// Number of blocks at the tip that are fetched again on every update, in
+/// case they were reorganised.
+pub const REORG_DEPTH: u64 = 10;
+
+/// Choosing decoys is given up after this many draws per decoy, which only
+/// happens on chains with very few outputs.
+const MAX_DRAWS_PER_DECOY: usize = 100;
+
+/// The number of RingCT outputs up to and including each block.
+#[derive(Debug, Clone, Default, PartialEq)]
+pub struct OutputDistribution {
+    start_height: u64,
+    /// Number of outputs before `start_height`.
+    base: u64,
+    cumulative: Vec<u64>,
+}
+
+impl OutputDistribution {
+    /// Height of the first block that is not part of the distribution yet.
+    pub fn next_height(&self) -> u64 {
+        self.start_height + self.cumulative.len() as u64
+    }
+
+    /// Replaces the distribution from `start_height` on with the given
+    /// cumulative output counts.
+    pub fn extend(&mut self, start_height: u64, base: u64, cumulative: Vec<u64>) {
+        if self.cumulative.is_empty()
+            || start_height < self.start_height
+            || start_height > self.next_height()
+        {
+            *self = Self {
+                start_height,
+                base,
+                cumulative,
+            };
+            return;
+        }
+
+        self.cumulative
+            .truncate((start_height - self.start_height) as usize);
+        self.cumulative.extend(cumulative);
+    }
+
+    /// Chooses `count` distinct global indices of spendable outputs.
+    pub fn choose_decoys<R: Rng>(&self, rng: &mut R, count: usize) -> Result<Vec<u64>> {
+        if self.cumulative.len() <= SPENDABLE_AGE {
+            bail!("Not enough blocks to choose decoys from")
+        }
+
+        let spendable = &self.cumulative[..self.cumulative.len() - SPENDABLE_AGE];
+        let num_outputs = spendable[spendable.len() - 1];
+
+        let blocks_to_consider = spendable.len().min(BLOCKS_TO_CONSIDER);
+        let outputs_before = match spendable.len().checked_sub(blocks_to_consider + 1) {
+            Some(block) => spendable[block],
+            None => self.base,
+        };
+        let outputs_to_consider = num_outputs.saturating_sub(outputs_before);
+        if outputs_to_consider == 0 {
+            bail!("No spendable outputs to choose decoys from")
+        }
+
+        let average_output_time =
+            DIFFICULTY_TARGET * blocks_to_consider as f64 / outputs_to_consider as f64;
+        let gamma = Gamma::new(GAMMA_SHAPE, GAMMA_SCALE).expect("gamma parameters to be valid");
+        let unlock_time = DIFFICULTY_TARGET * SPENDABLE_AGE as f64;
+
+        let mut decoys = Vec::with_capacity(count);
+
+        for _ in 0..count * MAX_DRAWS_PER_DECOY {
+            if decoys.len() == count {
+                break;
+            }
+
+            // Outputs younger than the unlock time cannot be spent, their share
+            // of the distribution is spread evenly across the most recent
+            // spendable outputs.
+            let age = gamma.sample(rng).exp();
+            let age = if age > unlock_time {
+                age - unlock_time
+            } else {
+                rng.gen_range(0.0, unlock_time)
+            };
+
+            let offset = (age / average_output_time) as u64;
+            if offset >= num_outputs {
+                continue;
+            }
+            let target = num_outputs - 1 - offset;
+
+            // The output at `target` determines the block, the decoy is any output
+            // of that block.
+            let block = spendable.partition_point(|&outputs| outputs <= target);
+            let first = match block.checked_sub(1) {
+                Some(previous) => spendable[previous],
+                None => self.base,
+            };
+            let outputs_in_block = spendable[block] - first;
+            if outputs_in_block == 0 {
+                continue;
+            }
+
+            let decoy = first + rng.gen_range(0, outputs_in_block);
+            if !decoys.contains(&decoy) {
+                decoys.push(decoy);
+            }
+        }
+
+        if decoys.len() < count {
+            bail!(
+                "Only found {} of {} decoys in {} spendable outputs",
+                decoys.len(),
+                count,
+                num_outputs
+            )
+        }
+
+        Ok(decoys)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use rand::rngs::StdRng;
+    use rand::SeedableRng;
+
+    #[test]
+    fn chooses_distinct_spendable_decoys() {
+        let distribution = distribution(0, 1000, 5);
+        let spendable_outputs = 990 * 5;
+
+        let decoys = distribution
+            .choose_decoys(&mut StdRng::seed_from_u64(0), 11)
+            .unwrap();
+
+        let mut distinct = decoys.clone();
+        distinct.sort_unstable();
+        distinct.dedup();
+        assert_eq!(distinct.len(), 11);
+        assert!(decoys.iter().all(|decoy| *decoy < spendable_outputs));
+    }
+
+    #[test]
+    fn prefers_recent_outputs() {
+        let distribution = distribution(0, 10_000, 1);
+
+        let decoys = distribution
+            .choose_decoys(&mut StdRng::seed_from_u64(0), 100)
+            .unwrap();
+
+        let recent = decoys.iter().filter(|decoy| **decoy >= 5_000).count();
+        assert!(recent > 50, "only {} of 100 decoys are recent", recent);
+    }
+
+    #[test]
+    fn extending_replaces_reorganised_blocks() {
+        let mut distribution = distribution(100, 20, 2);
+
+        distribution.extend(115, 0, vec![1000, 1001, 1002, 1003, 1004, 1005, 1006]);
+
+        assert_eq!(distribution.next_height(), 122);
+        assert_eq!(distribution.cumulative[14], 30);
+        assert_eq!(distribution.cumulative[15], 1000);
+        assert_eq!(distribution.base, 0);
+    }
+
+    #[test]
+    fn too_short_distribution_has_no_decoys() {
+        let distribution = distribution(0, SPENDABLE_AGE, 5);
+
+        assert!(distribution
+            .choose_decoys(&mut StdRng::seed_from_u64(0), 11)
+            .is_err());
+    }
+
+    fn distribution(
+        start_height: u64,
+        blocks: usize,
+        outputs_per_block: u64,
+    ) -> OutputDistribution {
+        let mut distribution = OutputDistribution::default();
+        distribution.extend(
+            start_height,
+            0,
+            (1..=blocks as u64)
+                .map(|block| block * outputs_per_block)
+                .collect(),
+        );
+
+        distribution
+    }
+}
@@ -1,57 +1,126 @@
-use anyhow::{Context, Result};
+mod check_tx_key;
+mod decoys;
+mod scanner;
+
+pub use scanner::FoundOutput;
+
+use crate::decoys::{OutputDistribution, REORG_DEPTH};
+use anyhow::{anyhow, Context, Result};
 use monero::consensus::encode::VarInt;
-use monero::cryptonote::hash::Hashable;
+use monero::{Address, PrivateKey};
 use monero_rpc::monerod;
-use monero_rpc::monerod::{GetBlockResponse, MonerodRpc as _};
+use monero_rpc::monerod::MonerodRpc as _;
+use monero_rpc::wallet::CheckTxKey;
 use rand::Rng;
+use std::convert::TryFrom;
+use std::sync::{Arc, Mutex, MutexGuard, PoisonError};
 
+#[derive(Debug, Clone)]
 pub struct Wallet {
     client: monerod::Client,
+    output_distribution: Arc<Mutex<OutputDistribution>>,
 }
 
 impl Wallet {
-    /// Chooses 10 random key offsets for use within a new confidential
-    /// transactions.
+    pub fn new(client: monerod::Client) -> Self {
+        Self {
+            client,
+            output_distribution: Arc::new(Mutex::new(OutputDistribution::default())),
+        }
+    }
+
+    /// The number of blocks in the blockchain of the daemon.
+    pub async fn block_height(&self) -> Result<u32> {
+        Ok(self.client.get_block_count().await?.count)
+    }
+
+    /// Checks how much a transaction sends to `address` and how many
+    /// confirmations it has, like monero-wallet-rpc's `check_tx_key`.
     ///
-    /// Choosing these offsets randomly is not ideal for privacy, instead they
-    /// should be chosen in a way that mimics a real spending pattern as much as
-    /// possible.
-    pub async fn choose_ten_random_key_offsets(&self) -> Result<[VarInt; 10]> {
-        let latest_block = self.client.get_block_count().await?;
-        let latest_spendable_block = latest_block.count - 10;
+    /// The transaction is fetched straight from the daemon and its outputs are
+    /// decrypted locally, so there is no wallet that has to be synced first.
+    pub async fn check_tx_key(
+        &self,
+        txid: &str,
+        tx_key: PrivateKey,
+        address: Address,
+    ) -> Result<CheckTxKey> {
+        let response = self.client.get_transactions(vec![txid.to_owned()]).await?;
+        let tx = response
+            .txs
+            .into_iter()
+            .find(|tx| tx.tx_hash == txid)
+            .with_context(|| format!("Transaction {} not found", txid))?;
+
+        let received = check_tx_key::received_amount(&tx.as_json, tx_key, address)?;
 
-        let block: GetBlockResponse = self.client.get_block(latest_spendable_block).await?;
+        let confirmations = if tx.in_pool {
+            0
+        } else {
+            let height = self.block_height().await?;
+            u64::from(height).saturating_sub(tx.block_height)
+        };
 
-        let tx_hash = block
-            .blob
-            .tx_hashes
-            .first()
-            .copied()
-            .unwrap_or_else(|| block.blob.miner_tx.hash());
+        Ok(CheckTxKey {
+            confirmations,
+            received,
+        })
+    }
 
-        let indices = self.client.get_o_indexes(tx_hash).await?;
+    /// Fetches the blocks that were added to the chain since the last update
+    /// into the cached output distribution.
+    ///
+    /// The first update fetches the whole distribution, later updates only the
+    /// new blocks and the ones that might have been reorganised.
+    pub async fn update_output_distribution(&self) -> Result<()> {
+        let from_height = self
+            .output_distribution()
+            .next_height()
+            .saturating_sub(REORG_DEPTH);
 
-        let last_index = indices
-            .o_indexes
+        let response = self
+            .client
+            .get_output_distribution(vec![0], from_height, 0, true, false)
+            .await?;
+        let distribution = response
+            .distributions
             .into_iter()
-            .max()
-            .context("Expected at least one output index")?;
-        let oldest_index = last_index - (last_index / 100) * 40; // oldest index must be within last 40% TODO: CONFIRM THIS
-
-        let mut rng = rand::thread_rng();
-
-        Ok([
-            VarInt(rng.gen_range(oldest_index, last_index)),
-            VarInt(rng.gen_range(oldest_index, last_index)),
-            VarInt(rng.gen_range(oldest_index, last_index)),
-            VarInt(rng.gen_range(oldest_index, last_index)),
-            VarInt(rng.gen_range(oldest_index, last_index)),
-            VarInt(rng.gen_range(oldest_index, last_index)),
-            VarInt(rng.gen_range(oldest_index, last_index)),
-            VarInt(rng.gen_range(oldest_index, last_index)),
-            VarInt(rng.gen_range(oldest_index, last_index)),
-            VarInt(rng.gen_range(oldest_index, last_index)),
-        ])
+            .find(|distribution| distribution.amount == 0)
+            .context("Expected the distribution of RingCT outputs")?;
+
+        self.output_distribution().extend(
+            distribution.start_height,
+            distribution.base,
+            distribution.distribution,
+        );
+
+        Ok(())
+    }
+
+    /// Chooses `count` decoys from the cached output distribution, without
+    /// talking to the daemon.
+    pub fn choose_decoys<R: Rng>(&self, rng: &mut R, count: usize) -> Result<Vec<u64>> {
+        self.output_distribution().choose_decoys(rng, count)
+    }
+
+    /// Chooses 10 key offsets for use within a new confidential transaction,
+    /// after bringing the cached output distribution up to date.
+    pub async fn choose_ten_random_key_offsets(&self) -> Result<[VarInt; 10]> {
+        self.update_output_distribution().await?;
+
+        let offsets = self
+            .choose_decoys(&mut rand::thread_rng(), 10)?
+            .into_iter()
+            .map(VarInt)
+            .collect::<Vec<_>>();
+
+        <[VarInt; 10]>::try_from(offsets).map_err(|_| anyhow!("Expected 10 decoys"))
+    }
+
+    fn output_distribution(&self) -> MutexGuard<'_, OutputDistribution> {
+        self.output_distribution
+            .lock()
+            .unwrap_or_else(PoisonError::into_inner)
     }
 }
 
@@ -69,9 +138,7 @@ mod tests {
         let container = cli.run(Monerod::default());
         let rpc_client = Client::localhost(container.get_host_port(18081).unwrap()).unwrap();
         rpc_client.generateblocks(150, "498AVruCDWgP9Az9LjMm89VWjrBrSZ2W2K3HFBiyzzrRjUJWUcCVxvY1iitfuKoek2FdX6MKGAD9Qb1G1P8QgR5jPmmt3Vj".to_owned()).await.unwrap();
-        let wallet = Wallet {
-            client: rpc_client.clone(),
-        };
+        let wallet = Wallet::new(rpc_client.clone());
 
         let key_offsets = wallet.choose_ten_random_key_offsets().await.unwrap();
         let result = rpc_client
@@ -0,0 +1,172 @@
+//! Scans the blockchain for outputs that belong to a private view key and a
+//! public spend key, without loading the keys into a wallet.
+
+use crate::check_tx_key::{decompress, derivation, owned_outputs};
+use crate::Wallet;
+use anyhow::Result;
+use curve25519_dalek::edwards::{CompressedEdwardsY, EdwardsPoint};
+use futures::future;
+use monero::{PrivateKey, PublicKey};
+use monero_rpc::monerod::{MonerodRpc as _, TransactionEntry};
+use std::convert::TryFrom;
+
+/// How many blocks are fetched at the same time.
+const BATCH_SIZE: u32 = 20;
+
+/// Restricted monerod RPCs do not return more transactions per request.
+const MAX_TRANSACTIONS_PER_REQUEST: usize = 100;
+
+const TX_EXTRA_TAG_PUBKEY: u8 = 0x01;
+const TX_EXTRA_NONCE: u8 = 0x02;
+const TX_EXTRA_MERGE_MINING_TAG: u8 = 0x03;
+const TX_EXTRA_TAG_ADDITIONAL_PUBKEYS: u8 = 0x04;
+
+#[derive(Debug, Clone, PartialEq)]
+pub struct FoundOutput {
+    pub txid: String,
+    pub height: u64,
+    pub index: usize,
+    pub amount: u64,
+}
+
+impl Wallet {
+    /// Scans the blocks from `from_height` up to the current tip for the first
+    /// output that belongs to the given keys.
+    ///
+    /// Blocks are fetched in parallel batches and the scan stops with the batch
+    /// that contains the output, so usually only a few blocks after
+    /// `from_height` are downloaded.
+    pub async fn find_output(
+        &self,
+        private_view_key: PrivateKey,
+        public_spend_key: PublicKey,
+        from_height: u32,
+    ) -> Result<Option<FoundOutput>> {
+        let public_spend = decompress(public_spend_key.point)?;
+        let tip = self.block_height().await?;
+
+        let mut height = from_height;
+        while height < tip {
+            let batch_end = height.saturating_add(BATCH_SIZE).min(tip);
+
+            let blocks = future::try_join_all(
+                (height..batch_end).map(|height| self.client.get_block(height)),
+            )
+            .await?;
+            let tx_hashes = blocks
+                .into_iter()
+                .flat_map(|block| block.tx_hashes)
+                .collect::<Vec<_>>();
+
+            let responses = future::try_join_all(
+                tx_hashes
+                    .chunks(MAX_TRANSACTIONS_PER_REQUEST)
+                    .map(|chunk| self.client.get_transactions(chunk.to_vec())),
+            )
+            .await?;
+
+            for tx in responses.into_iter().flat_map(|response| response.txs) {
+                if let Some(found) = scan_transaction(&tx, &private_view_key, &public_spend)? {
+                    return Ok(Some(found));
+                }
+            }
+
+            height = batch_end;
+        }
+
+        Ok(None)
+    }
+}
+
+fn scan_transaction(
+    tx: &TransactionEntry,
+    private_view_key: &PrivateKey,
+    public_spend: &EdwardsPoint,
+) -> Result<Option<FoundOutput>> {
+    let tx_public_key = match tx_public_key(&tx.as_json.extra) {
+        Some(key) => key,
+        None => return Ok(None),
+    };
+
+    let derivation = derivation(&private_view_key.scalar, &tx_public_key);
+    let found = owned_outputs(&tx.as_json, &derivation, public_spend)?
+        .first()
+        .map(|output| FoundOutput {
+            txid: tx.tx_hash.clone(),
+            height: tx.block_height,
+            index: output.index,
+            amount: output.amount,
+        });
+
+    Ok(found)
+}
+
+/// Reads the public key of the transaction from its extra field.
+fn tx_public_key(extra: &[u8]) -> Option<EdwardsPoint> {
+    let mut rest = extra;
+
+    while let Some((&tag, tail)) = rest.split_first() {
+        match tag {
+            TX_EXTRA_TAG_PUBKEY => {
+                let key = <[u8; 32]>::try_from(tail.get(..32)?).ok()?;
+                return CompressedEdwardsY(key).decompress();
+            }
+            TX_EXTRA_NONCE | TX_EXTRA_MERGE_MINING_TAG => {
+                let (length, tail) = read_varint(tail)?;
+                rest = tail.get(length..)?;
+            }
+            TX_EXTRA_TAG_ADDITIONAL_PUBKEYS => {
+                let (count, tail) = read_varint(tail)?;
+                rest = tail.get(count.checked_mul(32)?..)?;
+            }
+            // Padding or a field we do not know the length of.
+            _ => return None,
+        }
+    }
+
+    None
+}
+
+fn read_varint(bytes: &[u8]) -> Option<(usize, &[u8])> {
+    let mut value = 0usize;
+
+    for (i, byte) in bytes.iter().enumerate().take(9) {
+        value |= usize::from(byte & 0x7f) << (7 * i);
+
+        if byte & 0x80 == 0 {
+            return Some((value, &bytes[i + 1..]));
+        }
+    }
+
+    None
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use curve25519_dalek::constants::ED25519_BASEPOINT_POINT;
+
+    #[test]
+    fn finds_public_key_after_other_fields() {
+        let key = ED25519_BASEPOINT_POINT.compress();
+
+        let mut extra = vec![TX_EXTRA_NONCE, 3, 0xaa, 0xbb, 0xcc];
+        extra.push(TX_EXTRA_TAG_PUBKEY);
+        extra.extend_from_slice(key.as_bytes());
+        extra.extend_from_slice(&[TX_EXTRA_TAG_ADDITIONAL_PUBKEYS, 0]);
+
+        assert_eq!(tx_public_key(&extra).map(|key| key.compress()), Some(key));
+    }
+
+    #[test]
+    fn truncated_extra_has_no_public_key() {
+        assert_eq!(tx_public_key(&[TX_EXTRA_NONCE, 10, 0xaa]), None);
+        assert_eq!(tx_public_key(&[TX_EXTRA_TAG_PUBKEY, 0x58]), None);
+    }
+
+    #[test]
+    fn reads_multi_byte_varint() {
+        assert_eq!(read_varint(&[0xac, 0x02, 0xff]), Some((300, &[0xff][..])));
+        assert_eq!(read_varint(&[0x80]), None);
+    }
+}
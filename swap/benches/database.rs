@@ -0,0 +1,61 @@
+//! Benchmarks how many swap state transitions the database makes durable per
+//! second, with a number of swaps writing concurrently.
+//!
+//! ```text
+//! cargo bench -p swap --bench database
+//! ```
+
+use criterion::{criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use futures::future;
+use std::sync::Arc;
+use swap::database::{Alice, Database, Swap};
+use swap::protocol::alice::AliceState;
+use tokio::runtime::Runtime;
+use uuid::Uuid;
+
+const TRANSITIONS_PER_SWAP: usize = 10;
+const CONCURRENT_SWAPS: [usize; 4] = [1, 8, 32, 128];
+
+fn transitions(c: &mut Criterion) {
+    let runtime = Runtime::new().unwrap();
+    let db_dir = tempfile::tempdir().unwrap();
+    let db = Arc::new(Database::open(db_dir.path()).unwrap());
+
+    let states = [
+        AliceState::SafelyAborted,
+        AliceState::BtcRedeemed,
+        AliceState::XmrRefunded,
+        AliceState::BtcPunished,
+    ]
+    .iter()
+    .map(|state| Swap::Alice(Alice::from(state)))
+    .collect::<Vec<_>>();
+
+    let mut group = c.benchmark_group("transitions");
+    group.sample_size(20);
+
+    for swaps in CONCURRENT_SWAPS.iter().copied() {
+        group.throughput(Throughput::Elements((swaps * TRANSITIONS_PER_SWAP) as u64));
+        group.bench_with_input(BenchmarkId::from_parameter(swaps), &swaps, |b, &swaps| {
+            b.iter(|| {
+                runtime.block_on(future::join_all((0..swaps).map(|_| {
+                    let db = db.clone();
+                    let states = states.clone();
+
+                    tokio::spawn(async move {
+                        let swap_id = Uuid::new_v4();
+
+                        for state in states.into_iter().cycle().take(TRANSITIONS_PER_SWAP) {
+                            db.insert_latest_state(swap_id, state).await.unwrap();
+                        }
+                    })
+                })))
+            })
+        });
+    }
+
+    group.finish();
+}
+
+criterion_group!(benches, transitions);
+criterion_main!(benches);
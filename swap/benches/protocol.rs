@@ -0,0 +1,277 @@
+//! Benchmarks of the cryptography and transaction construction that every swap
+//! goes through.
+//!
+//! All inputs are derived from a fixed seed, so results of different revisions
+//! can be compared against each other:
+//!
+//! ```text
+//! cargo bench -p swap --bench protocol -- --save-baseline before
+//! cargo bench -p swap --bench protocol -- --baseline before
+//! ```
+
+#![allow(non_snake_case)]
+
+use ::bitcoin::util::psbt::PartiallySignedTransaction;
+use ::bitcoin::{OutPoint, Transaction, TxIn, TxOut};
+use criterion::{black_box, criterion_group, criterion_main, BatchSize, Criterion};
+use ecdsa_fun::adaptor::{Adaptor, HashTranscript};
+use ecdsa_fun::fun::Point;
+use ecdsa_fun::nonce::Deterministic;
+use miniscript::DescriptorTrait;
+use rand::SeedableRng;
+use rand_chacha::ChaCha20Rng;
+use rust_decimal_macros::dec;
+use sha2::Sha256;
+use std::str::FromStr;
+use swap::asb::Rate;
+use swap::bitcoin::{
+    build_shared_output_descriptor, recover, verify_encsig, Address, Amount, CancelTimelock,
+    PunishTimelock, SecretKey, TxCancel, TxLock, TxPunish, TxRedeem, TxRefund,
+};
+use swap::monero;
+use swap::protocol::CROSS_CURVE_PROOF_SYSTEM;
+
+const SEED: u64 = 42;
+const BTC_AMOUNT: u64 = 1_000_000;
+const SPENDING_FEE: u64 = 1_000;
+const REDEEM_ADDRESS: &str = "bcrt1q08pfqpsyrt7acllzyjm8q5qsz5capvyahm49rw";
+const REFUND_ADDRESS: &str = "bcrt1qqqqsyqcyq5rqwzqfpg9scrgwpugpzysnard0ew";
+
+fn dleq(c: &mut Criterion) {
+    let mut rng = ChaCha20Rng::seed_from_u64(SEED);
+    let s = monero::Scalar::random(&mut rng);
+    let (proof, (S_bitcoin, S_monero)) = CROSS_CURVE_PROOF_SYSTEM.prove(&s, &mut rng);
+    let S_bitcoin = swap::bitcoin::PublicKey::from(S_bitcoin);
+
+    let mut group = c.benchmark_group("dleq");
+    group.sample_size(20);
+
+    group.bench_function("prove", |b| {
+        let mut rng = ChaCha20Rng::seed_from_u64(SEED);
+        b.iter(|| CROSS_CURVE_PROOF_SYSTEM.prove(black_box(&s), &mut rng))
+    });
+    group.bench_function("verify", |b| {
+        b.iter(|| {
+            assert!(CROSS_CURVE_PROOF_SYSTEM.verify(
+                black_box(&proof),
+                (S_bitcoin.into(), S_monero)
+            ))
+        })
+    });
+
+    group.finish();
+}
+
+fn adaptor_signatures(c: &mut Criterion) {
+    let keys = Keys::new();
+    let tx_lock = keys.tx_lock();
+    let digest = TxRedeem::new(&tx_lock, &address(REDEEM_ADDRESS), spending_fee()).digest();
+
+    let encsig = keys.b.encsign(keys.S_a, digest);
+    // What Alice publishes after decrypting Bob's signature with her spend key
+    // share, and what Bob recovers the share from.
+    let sig = Adaptor::<HashTranscript<Sha256>, Deterministic<Sha256>>::default()
+        .decrypt_signature(&keys.s_a.clone().into(), encsig.clone());
+
+    let mut group = c.benchmark_group("adaptor_signatures");
+
+    group.bench_function("sign", |b| b.iter(|| keys.a.sign(black_box(digest))));
+    group.bench_function("encsign", |b| {
+        b.iter(|| keys.b.encsign(keys.S_a, black_box(digest)))
+    });
+    group.bench_function("verify_encsig", |b| {
+        b.iter(|| verify_encsig(keys.b.public(), keys.S_a, black_box(&digest), &encsig).unwrap())
+    });
+    group.bench_function("recover", |b| {
+        b.iter(|| recover(keys.S_a, black_box(sig.clone()), encsig.clone()).unwrap())
+    });
+
+    group.finish();
+}
+
+fn descriptor(c: &mut Criterion) {
+    let keys = Keys::new();
+    let A = Point::from(keys.a.public());
+    let B = Point::from(keys.b.public());
+
+    c.bench_function("build_shared_output_descriptor", |b| {
+        b.iter(|| build_shared_output_descriptor(black_box(A), black_box(B)))
+    });
+}
+
+fn transactions(c: &mut Criterion) {
+    let keys = Keys::new();
+    let tx_lock = keys.tx_lock();
+    let redeem_address = address(REDEEM_ADDRESS);
+    let refund_address = address(REFUND_ADDRESS);
+
+    let A = keys.a.public();
+    let B = keys.b.public();
+
+    let mut group = c.benchmark_group("transactions");
+
+    group.bench_function("tx_lock", |b| {
+        b.iter_batched(
+            || keys.lock_psbt(),
+            |psbt| TxLock::from_psbt(psbt, A, B, btc_amount()).unwrap(),
+            BatchSize::SmallInput,
+        )
+    });
+
+    group.bench_function("tx_cancel", |b| {
+        b.iter_batched(
+            || keys.b.sign(keys.tx_cancel(&tx_lock).digest()),
+            |tx_cancel_sig_b| {
+                keys.tx_cancel(&tx_lock)
+                    .complete_as_alice(keys.a.clone(), keys.b.public(), tx_cancel_sig_b)
+                    .unwrap()
+            },
+            BatchSize::SmallInput,
+        )
+    });
+
+    let tx_cancel = keys.tx_cancel(&tx_lock);
+
+    group.bench_function("tx_refund", |b| {
+        b.iter(|| {
+            let tx_refund = TxRefund::new(&tx_cancel, &refund_address, spending_fee());
+            let sig_a = keys.a.sign(tx_refund.digest());
+            let sig_b = keys.b.sign(tx_refund.digest());
+
+            tx_refund
+                .add_signatures((keys.a.public(), sig_a), (keys.b.public(), sig_b))
+                .unwrap()
+        })
+    });
+
+    group.bench_function("tx_redeem", |b| {
+        let encsig = keys.b.encsign(
+            keys.S_a,
+            TxRedeem::new(&tx_lock, &redeem_address, spending_fee()).digest(),
+        );
+
+        b.iter(|| {
+            TxRedeem::new(&tx_lock, &redeem_address, spending_fee())
+                .complete(
+                    encsig.clone(),
+                    keys.a.clone(),
+                    keys.s_a.clone().into(),
+                    keys.b.public(),
+                )
+                .unwrap()
+        })
+    });
+
+    group.bench_function("tx_punish", |b| {
+        b.iter(|| {
+            let tx_punish = TxPunish::new(
+                &tx_cancel,
+                &redeem_address,
+                PunishTimelock::new(20),
+                spending_fee(),
+            );
+            let sig_b = keys.b.sign(tx_punish.digest());
+
+            tx_punish
+                .complete(sig_b, keys.a.clone(), keys.b.public())
+                .unwrap()
+        })
+    });
+
+    group.finish();
+}
+
+fn sell_quote(c: &mut Criterion) {
+    let rate = Rate::new(Amount::from_sat(500_000), dec!(0.02));
+
+    c.bench_function("sell_quote", |b| {
+        b.iter(|| rate.sell_quote(black_box(btc_amount())).unwrap())
+    });
+}
+
+/// Keys of both parties, derived from a fixed seed.
+struct Keys {
+    a: SecretKey,
+    b: SecretKey,
+    s_a: SecretKey,
+    S_a: swap::bitcoin::PublicKey,
+}
+
+impl Keys {
+    fn new() -> Self {
+        let mut rng = ChaCha20Rng::seed_from_u64(SEED);
+        let a = SecretKey::new_random(&mut rng);
+        let b = SecretKey::new_random(&mut rng);
+        let s_a = SecretKey::new_random(&mut rng);
+        let S_a = s_a.public();
+
+        Self { a, b, s_a, S_a }
+    }
+
+    /// A lock transaction without change that pays into the shared output.
+    fn lock_psbt(&self) -> PartiallySignedTransaction {
+        let script_pubkey =
+            build_shared_output_descriptor(self.a.public().into(), self.b.public().into())
+                .script_pubkey();
+
+        let transaction = Transaction {
+            version: 2,
+            lock_time: 0,
+            input: vec![TxIn {
+                previous_output: OutPoint::default(),
+                script_sig: Default::default(),
+                sequence: 0xFFFF_FFFF,
+                witness: Vec::new(),
+            }],
+            output: vec![TxOut {
+                value: BTC_AMOUNT,
+                script_pubkey,
+            }],
+        };
+
+        PartiallySignedTransaction::from_unsigned_tx(transaction)
+            .expect("transaction to be unsigned")
+    }
+
+    fn tx_lock(&self) -> TxLock {
+        TxLock::from_psbt(
+            self.lock_psbt(),
+            self.a.public(),
+            self.b.public(),
+            btc_amount(),
+        )
+        .expect("psbt to pay into the shared output")
+    }
+
+    fn tx_cancel(&self, tx_lock: &TxLock) -> TxCancel {
+        TxCancel::new(
+            tx_lock,
+            CancelTimelock::new(12),
+            self.a.public(),
+            self.b.public(),
+            spending_fee(),
+        )
+    }
+}
+
+fn btc_amount() -> Amount {
+    Amount::from_sat(BTC_AMOUNT)
+}
+
+fn spending_fee() -> Amount {
+    Amount::from_sat(SPENDING_FEE)
+}
+
+fn address(address: &str) -> Address {
+    Address::from_str(address).expect("a valid address")
+}
+
+criterion_group!(
+    benches,
+    dleq,
+    adaptor_signatures,
+    descriptor,
+    transactions,
+    sell_quote
+);
+criterion_main!(benches);
@@ -1,12 +1,15 @@
 pub mod command;
 pub mod config;
 mod event_loop;
+mod latency;
+mod ledger;
 mod network;
 mod rate;
 mod recovery;
 pub mod tracing;
 
 pub use event_loop::{EventLoop, EventLoopHandle, FixedRate, KrakenRate, LatestRate};
+pub use latency::{phase_latencies, PhaseLatency};
 pub use network::behaviour::{Behaviour, OutEvent};
 pub use network::transport;
 pub use rate::Rate;
@@ -1,5 +1,6 @@
 use crate::asb::config::GetDefaults;
 use crate::bitcoin::Amount;
+use crate::database::{parse_date, Format, Query, Status};
 use crate::env;
 use crate::env::GetConfig;
 use anyhow::{bail, Result};
@@ -31,12 +32,42 @@ where
             env_config: env_config(is_testnet),
             cmd: Command::Start { resume_only },
         },
-        RawCommand::History => Arguments {
+        RawCommand::History {
+            format,
+            status,
+            since,
+            before,
+            after,
+            limit,
+        } => Arguments {
             testnet: is_testnet,
             json: is_json,
             config_path: config_path(config, is_testnet)?,
             env_config: env_config(is_testnet),
-            cmd: Command::History,
+            cmd: Command::History {
+                query: Query {
+                    status,
+                    started_since: since,
+                    started_before: before,
+                    after,
+                    limit,
+                },
+                format,
+            },
+        },
+        RawCommand::PhaseLatencies => Arguments {
+            testnet: is_testnet,
+            json: is_json,
+            config_path: config_path(config, is_testnet)?,
+            env_config: env_config(is_testnet),
+            cmd: Command::PhaseLatencies,
+        },
+        RawCommand::Archive { older_than_days } => Arguments {
+            testnet: is_testnet,
+            json: is_json,
+            config_path: config_path(config, is_testnet)?,
+            env_config: env_config(is_testnet),
+            cmd: Command::Archive { older_than_days },
         },
         RawCommand::WithdrawBtc { amount, address } => Arguments {
             testnet: is_testnet,
@@ -168,7 +199,14 @@ pub enum Command {
     Start {
         resume_only: bool,
     },
-    History,
+    History {
+        query: Query,
+        format: Format,
+    },
+    PhaseLatencies,
+    Archive {
+        older_than_days: u64,
+    },
     WithdrawBtc {
         amount: Option<Amount>,
         address: Address,
@@ -237,7 +275,50 @@ pub enum RawCommand {
         resume_only: bool,
     },
     #[structopt(about = "Prints swap-id and the state of each swap ever made.")]
-    History,
+    History {
+        #[structopt(
+            long = "format",
+            help = "Output format: table, json (one object per line) or csv.",
+            default_value = "table"
+        )]
+        format: Format,
+        #[structopt(long = "status", help = "Only list swaps that are active or done.")]
+        status: Option<Status>,
+        #[structopt(
+            long = "since",
+            help = "Only list swaps started on or after this date (YYYY-MM-DD, UTC).",
+            parse(try_from_str = parse_date)
+        )]
+        since: Option<u64>,
+        #[structopt(
+            long = "before",
+            help = "Only list swaps started before this date (YYYY-MM-DD, UTC).",
+            parse(try_from_str = parse_date)
+        )]
+        before: Option<u64>,
+        #[structopt(
+            long = "after",
+            help = "Continue after the swap with this id, e.g. the last swap of the previous page."
+        )]
+        after: Option<Uuid>,
+        #[structopt(long = "limit", help = "List at most this many swaps.")]
+        limit: Option<usize>,
+    },
+    #[structopt(
+        about = "Prints percentiles of how long swaps took to go through each phase, measured from the swap state journal."
+    )]
+    PhaseLatencies,
+    #[structopt(
+        about = "Moves finished swaps from the database to the archive file in the data directory and compacts the database. The ASB must not be running."
+    )]
+    Archive {
+        #[structopt(
+            long = "older-than-days",
+            help = "Only swaps that finished at least this many days ago are archived.",
+            default_value = "90"
+        )]
+        older_than_days: u64,
+    },
     #[structopt(about = "Allows withdrawing BTC from the internal Bitcoin wallet.")]
     WithdrawBtc {
         #[structopt(
@@ -350,7 +431,67 @@ mod tests {
             json: false,
             config_path: default_mainnet_conf_path.clone(),
             env_config: mainnet_env_config,
-            cmd: Command::History,
+            cmd: Command::History {
+                query: Query::default(),
+                format: Format::Table,
+            },
+        };
+        let args = parse_args(raw_ars).unwrap();
+        assert_eq!(expected_args, args);
+
+        let raw_ars = vec![
+            BINARY_NAME,
+            "history",
+            "--format",
+            "csv",
+            "--status",
+            "done",
+            "--since",
+            "2021-07-09",
+            "--after",
+            SWAP_ID,
+            "--limit",
+            "100",
+        ];
+        let expected_args = Arguments {
+            testnet: false,
+            json: false,
+            config_path: default_mainnet_conf_path.clone(),
+            env_config: mainnet_env_config,
+            cmd: Command::History {
+                query: Query {
+                    status: Some(Status::Done),
+                    started_since: Some(1_625_788_800),
+                    started_before: None,
+                    after: Some(Uuid::parse_str(SWAP_ID).unwrap()),
+                    limit: Some(100),
+                },
+                format: Format::Csv,
+            },
+        };
+        let args = parse_args(raw_ars).unwrap();
+        assert_eq!(expected_args, args);
+
+        let raw_ars = vec![BINARY_NAME, "phase-latencies"];
+        let expected_args = Arguments {
+            testnet: false,
+            json: false,
+            config_path: default_mainnet_conf_path.clone(),
+            env_config: mainnet_env_config,
+            cmd: Command::PhaseLatencies,
+        };
+        let args = parse_args(raw_ars).unwrap();
+        assert_eq!(expected_args, args);
+
+        let raw_ars = vec![BINARY_NAME, "archive", "--older-than-days", "30"];
+        let expected_args = Arguments {
+            testnet: false,
+            json: false,
+            config_path: default_mainnet_conf_path.clone(),
+            env_config: mainnet_env_config,
+            cmd: Command::Archive {
+                older_than_days: 30,
+            },
         };
         let args = parse_args(raw_ars).unwrap();
         assert_eq!(expected_args, args);
@@ -487,7 +628,10 @@ mod tests {
             json: false,
             config_path: default_testnet_conf_path.clone(),
             env_config: testnet_env_config,
-            cmd: Command::History,
+            cmd: Command::History {
+                query: Query::default(),
+                format: Format::Table,
+            },
         };
         let args = parse_args(raw_ars).unwrap();
         assert_eq!(expected_args, args);
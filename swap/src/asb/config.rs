@@ -128,12 +128,23 @@ pub struct Network {
 #[serde(deny_unknown_fields)]
 pub struct Bitcoin {
     pub electrum_rpc_url: Url,
+    /// Further Electrum servers to fall back to and balance requests across.
+    #[serde(default)]
+    pub additional_electrum_rpc_urls: Vec<Url>,
     pub target_block: usize,
     pub finality_confirmations: Option<u32>,
     #[serde(with = "crate::bitcoin::network")]
     pub network: bitcoin::Network,
 }
 
+impl Bitcoin {
+    pub fn electrum_rpc_urls(&self) -> Vec<Url> {
+        std::iter::once(self.electrum_rpc_url.clone())
+            .chain(self.additional_electrum_rpc_urls.iter().cloned())
+            .collect()
+    }
+}
+
 #[derive(Clone, Debug, Deserialize, PartialEq, Serialize)]
 #[serde(deny_unknown_fields)]
 pub struct Monero {
@@ -141,6 +152,17 @@ pub struct Monero {
     pub finality_confirmations: Option<u64>,
     #[serde(with = "crate::monero::network")]
     pub network: monero::Network,
+    /// Address of the monerod that monero-wallet-rpc worker processes connect
+    /// to. If set, refund wallets are swept by a worker instead of the wallet
+    /// RPC of the main wallet, and Monero lock transfers are verified against
+    /// this monerod.
+    pub daemon_address: Option<String>,
+    /// Number of similarly sized outputs the Monero balance is kept split
+    /// into, so that the change of one swap does not block the next one.
+    pub split_outputs: Option<usize>,
+    /// Seconds to wait for other swaps to lock their Monero, before sending
+    /// all lock transfers in a single transaction.
+    pub lock_batch_window_secs: Option<u64>,
 }
 
 #[derive(Clone, Debug, Deserialize, PartialEq, Serialize)]
@@ -309,6 +331,7 @@ pub fn query_user_for_initial_config(testnet: bool) -> Result<Config> {
         },
         bitcoin: Bitcoin {
             electrum_rpc_url,
+            additional_electrum_rpc_urls: vec![],
             target_block,
             finality_confirmations: None,
             network: bitcoin_network,
@@ -317,6 +340,9 @@ pub fn query_user_for_initial_config(testnet: bool) -> Result<Config> {
             wallet_rpc_url: monero_wallet_rpc_url,
             finality_confirmations: None,
             network: monero_network,
+            daemon_address: None,
+            split_outputs: None,
+            lock_batch_window_secs: None,
         },
         tor: TorConf {
             control_port: tor_control_port,
@@ -349,6 +375,7 @@ mod tests {
             },
             bitcoin: Bitcoin {
                 electrum_rpc_url: defaults.electrum_rpc_url,
+                additional_electrum_rpc_urls: vec![],
                 target_block: defaults.bitcoin_confirmation_target,
                 finality_confirmations: None,
                 network: bitcoin::Network::Testnet,
@@ -363,6 +390,9 @@ mod tests {
                 wallet_rpc_url: defaults.monero_wallet_rpc_url,
                 finality_confirmations: None,
                 network: monero::Network::Stagenet,
+                daemon_address: None,
+                split_outputs: None,
+                lock_batch_window_secs: None,
             },
             tor: Default::default(),
             maker: Maker {
@@ -392,6 +422,7 @@ mod tests {
             },
             bitcoin: Bitcoin {
                 electrum_rpc_url: defaults.electrum_rpc_url,
+                additional_electrum_rpc_urls: vec![],
                 target_block: defaults.bitcoin_confirmation_target,
                 finality_confirmations: None,
                 network: bitcoin::Network::Bitcoin,
@@ -406,6 +437,9 @@ mod tests {
                 wallet_rpc_url: defaults.monero_wallet_rpc_url,
                 finality_confirmations: None,
                 network: monero::Network::Mainnet,
+                daemon_address: None,
+                split_outputs: None,
+                lock_batch_window_secs: None,
             },
             tor: Default::default(),
             maker: Maker {
@@ -1,3 +1,4 @@
+use crate::asb::ledger::Ledger;
 use crate::asb::{Behaviour, OutEvent, Rate};
 use crate::database::Database;
 use crate::network::quote::BidQuote;
@@ -17,9 +18,14 @@ use std::collections::HashMap;
 use std::convert::Infallible;
 use std::fmt::Debug;
 use std::sync::Arc;
-use tokio::sync::mpsc;
+use tokio::sync::{mpsc, Semaphore};
 use uuid::Uuid;
 
+/// How many wallet snapshots are captured at the same time.
+///
+/// Additional swap setups wait for a slot outside of the event loop.
+const MAX_CONCURRENT_WALLET_SNAPSHOTS: usize = 10;
+
 /// A future that resolves to a tuple of `PeerId`, `transfer_proof::Request` and
 /// `Responder`.
 ///
@@ -40,12 +46,17 @@ where
     bitcoin_wallet: Arc<bitcoin::Wallet>,
     monero_wallet: Arc<monero::Wallet>,
     db: Arc<Database>,
+    ledger: Arc<Ledger>,
     latest_rate: LR,
     min_buy: bitcoin::Amount,
     max_buy: bitcoin::Amount,
 
     swap_sender: mpsc::Sender<Swap>,
 
+    /// Tracks [`WalletSnapshot`]s that are being captured for swap setups.
+    inflight_wallet_snapshots: FuturesUnordered<BoxFuture<'static, ()>>,
+    wallet_snapshot_slots: Arc<Semaphore>,
+
     /// Stores incoming [`EncryptedSignature`]s per swap.
     recv_encrypted_signature: HashMap<Uuid, bmrng::RequestSender<bitcoin::EncryptedSignature, ()>>,
     inflight_encrypted_signatures: FuturesUnordered<BoxFuture<'static, ResponseChannel<()>>>,
@@ -77,6 +88,7 @@ where
         max_buy: bitcoin::Amount,
     ) -> Result<(Self, mpsc::Receiver<Swap>)> {
         let swap_channel = MpscChannels::default();
+        let ledger = Ledger::spawn(db.clone(), monero_wallet.clone());
 
         let event_loop = EventLoop {
             swarm,
@@ -84,10 +96,13 @@ where
             bitcoin_wallet,
             monero_wallet,
             db,
+            ledger,
             latest_rate,
             swap_sender: swap_channel.sender,
             min_buy,
             max_buy,
+            inflight_wallet_snapshots: Default::default(),
+            wallet_snapshot_slots: Arc::new(Semaphore::new(MAX_CONCURRENT_WALLET_SNAPSHOTS)),
             recv_encrypted_signature: Default::default(),
             inflight_encrypted_signatures: Default::default(),
             send_transfer_proof: Default::default(),
@@ -107,6 +122,8 @@ where
         self.send_transfer_proof.push(future::pending().boxed());
         self.inflight_encrypted_signatures
             .push(future::pending().boxed());
+        self.inflight_wallet_snapshots
+            .push(future::pending().boxed());
 
         let unfinished_swaps = match self.db.unfinished_alice() {
             Ok(unfinished_swaps) => unfinished_swaps,
@@ -149,26 +166,9 @@ where
             tokio::select! {
                 swarm_event = self.swarm.select_next_some() => {
                     match swarm_event {
-                        SwarmEvent::Behaviour(OutEvent::SwapSetupInitiated { mut send_wallet_snapshot }) => {
-
-                            let (btc, responder) = match send_wallet_snapshot.recv().await {
-                                Ok((btc, responder)) => (btc, responder),
-                                Err(error) => {
-                                    tracing::error!("Swap request will be ignored because of a failure when requesting information for the wallet snapshot: {:#}", error);
-                                    continue;
-                                }
-                            };
-
-                            let wallet_snapshot = match WalletSnapshot::capture(&self.bitcoin_wallet, &self.monero_wallet, btc).await {
-                                Ok(wallet_snapshot) => wallet_snapshot,
-                                Err(error) => {
-                                    tracing::error!("Swap request will be ignored because we were unable to create wallet snapshot for swap: {:#}", error);
-                                    continue;
-                                }
-                            };
-
-                            // Ignore result, we should never hit this because the receiver will alive as long as the connection is.
-                            let _ = responder.respond(wallet_snapshot);
+                        SwarmEvent::Behaviour(OutEvent::SwapSetupInitiated { send_wallet_snapshot }) => {
+                            let capture = self.capture_wallet_snapshot(send_wallet_snapshot);
+                            self.inflight_wallet_snapshots.push(capture);
                         }
                         SwarmEvent::Behaviour(OutEvent::SwapSetupCompleted{peer_id, swap_id, state3}) => {
                             let _ = self.handle_execution_setup_done(peer_id, swap_id, state3).await;
@@ -305,10 +305,57 @@ where
                 Some(response_channel) = self.inflight_encrypted_signatures.next() => {
                     let _ = self.swarm.behaviour_mut().encrypted_signature.send_response(response_channel, ());
                 }
+                Some(()) = self.inflight_wallet_snapshots.next() => {}
             }
         }
     }
 
+    /// Captures a [`WalletSnapshot`] for a swap setup without holding up the
+    /// event loop.
+    ///
+    /// Talking to the wallets takes a while, in the meantime the event loop
+    /// keeps answering quotes and relaying messages of running swaps.
+    fn capture_wallet_snapshot(
+        &self,
+        mut send_wallet_snapshot: bmrng::RequestReceiver<bitcoin::Amount, WalletSnapshot>,
+    ) -> BoxFuture<'static, ()> {
+        let bitcoin_wallet = self.bitcoin_wallet.clone();
+        let ledger = self.ledger.clone();
+        let slots = self.wallet_snapshot_slots.clone();
+
+        async move {
+            let (btc, responder) = match send_wallet_snapshot.recv().await {
+                Ok((btc, responder)) => (btc, responder),
+                Err(error) => {
+                    tracing::error!("Swap request will be ignored because of a failure when requesting information for the wallet snapshot: {:#}", error);
+                    return;
+                }
+            };
+
+            let _slot = match slots.acquire().await {
+                Ok(slot) => slot,
+                Err(_) => return,
+            };
+
+            let wallet_snapshot = match async {
+                let balance = ledger.available().await?;
+                WalletSnapshot::capture(&bitcoin_wallet, balance, btc).await
+            }
+            .await
+            {
+                Ok(wallet_snapshot) => wallet_snapshot,
+                Err(error) => {
+                    tracing::error!("Swap request will be ignored because we were unable to create wallet snapshot for swap: {:#}", error);
+                    return;
+                }
+            };
+
+            // Ignore result, we should never hit this because the receiver will alive as long as the connection is.
+            let _ = responder.respond(wallet_snapshot);
+        }
+        .boxed()
+    }
+
     async fn make_quote(
         &mut self,
         min_buy: bitcoin::Amount,
@@ -319,10 +366,27 @@ where
             .latest_rate()
             .context("Failed to get latest rate")?;
 
+        let ask_price = rate.ask().context("Failed to compute asking price")?;
+
+        // Only quote against the Monero that can be locked right now and is not
+        // promised to another swap, anything else would fail the swap setup.
+        let available_balance = self.ledger.available().await?;
+        let max_bitcoin_for_monero = available_balance
+            .max_bitcoin_for_price(ask_price)
+            .unwrap_or(bitcoin::Amount::ZERO);
+
+        if max_bitcoin_for_monero < max_buy {
+            tracing::debug!(
+                %available_balance,
+                max_quantity = %max_bitcoin_for_monero,
+                "Limiting quote to available Monero balance"
+            );
+        }
+
         Ok(BidQuote {
-            price: rate.ask().context("Failed to compute asking price")?,
+            price: ask_price,
             min_quantity: min_buy,
-            max_quantity: max_buy,
+            max_quantity: max_buy.min(max_bitcoin_for_monero),
         })
     }
 
@@ -334,6 +398,12 @@ where
     ) {
         let handle = self.new_handle(bob_peer_id, swap_id);
 
+        // Reserve right away, the swap only writes its first state once it runs.
+        // Released again if the swap never gets to run.
+        self.db
+            .reservations()
+            .reserve(swap_id, state3.xmr + monero::MONERO_FEE);
+
         let initial_state = AliceState::Started {
             state3: Box::new(state3),
         };
@@ -355,10 +425,12 @@ where
             Ok(_) => {
                 if let Err(error) = self.swap_sender.send(swap).await {
                     tracing::warn!(%swap_id, "Failed to start swap: {}", error);
+                    self.db.reservations().release(swap_id);
                 }
             }
             Err(error) => {
                 tracing::warn!(%swap_id, "Unable to save peer-id in database: {}", error);
+                self.db.reservations().release(swap_id);
             }
         }
     }
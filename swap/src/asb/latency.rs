@@ -0,0 +1,135 @@
+use crate::database::JournalEntry;
+use std::time::Duration;
+
+/// The phases of a swap as Alice, each ending with the first transition into
+/// the given state.
+///
+/// A phase starts at the end of the last phase the swap went through, or when
+/// the swap was started.
+pub const PHASES: [(&str, &str); 7] = [
+    ("Bitcoin lock seen", "BtcLockTransactionSeen"),
+    ("Bitcoin locked", "BtcLocked"),
+    ("Monero lock sent", "XmrLockTransactionSent"),
+    ("Monero locked", "XmrLocked"),
+    ("Encrypted signature learned", "EncSigLearned"),
+    ("Bitcoin redeem published", "BtcRedeemTransactionPublished"),
+    ("Bitcoin redeemed", "Done(BtcRedeemed)"),
+];
+
+/// The state every swap starts in, and that the first phase is measured from.
+const STARTED: &str = "Started";
+
+/// How long one phase took across swaps.
+#[derive(Debug, Clone, PartialEq)]
+pub struct PhaseLatency {
+    pub phase: &'static str,
+    /// Durations of the phase in ascending order, one per swap that went
+    /// through it.
+    samples: Vec<Duration>,
+}
+
+impl PhaseLatency {
+    pub fn swaps(&self) -> usize {
+        self.samples.len()
+    }
+
+    /// The nearest-rank percentile, `None` if no swap went through the phase.
+    pub fn percentile(&self, percent: usize) -> Option<Duration> {
+        let rank = (percent.min(100) * self.samples.len() + 99) / 100;
+
+        self.samples.get(rank.max(1) - 1).copied()
+    }
+}
+
+/// Collects the duration of every phase from the journals of Alice's swaps.
+pub fn phase_latencies<I>(journals: I) -> Vec<PhaseLatency>
+where
+    I: IntoIterator<Item = Vec<JournalEntry>>,
+{
+    let mut latencies = PHASES
+        .iter()
+        .map(|(phase, _)| PhaseLatency {
+            phase: *phase,
+            samples: Vec::new(),
+        })
+        .collect::<Vec<_>>();
+
+    for journal in journals {
+        // Swaps that were already running when the journal was introduced
+        // start somewhere in the middle, their first phase cannot be measured.
+        let mut phase_start = match journal.first() {
+            Some(entry) if entry.tag == STARTED => entry.timestamp,
+            _ => continue,
+        };
+
+        for (latency, (_, tag)) in latencies.iter_mut().zip(PHASES.iter()) {
+            if let Some(entry) = journal.iter().find(|entry| entry.tag == *tag) {
+                let millis = entry.timestamp.saturating_sub(phase_start);
+                latency.samples.push(Duration::from_millis(millis));
+                phase_start = entry.timestamp;
+            }
+        }
+    }
+
+    for latency in latencies.iter_mut() {
+        latency.samples.sort();
+    }
+
+    latencies
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn phases_are_measured_from_the_last_phase_reached() {
+        let journals = vec![
+            journal(&[
+                ("Started", 0),
+                ("BtcLockTransactionSeen", 1_000),
+                ("BtcLocked", 3_000),
+            ]),
+            // The lock transaction was only seen once confirmed.
+            journal(&[("Started", 10_000), ("BtcLocked", 15_000)]),
+            // Already running when the journal was introduced.
+            journal(&[("BtcLocked", 20_000), ("XmrLockTransactionSent", 20_010)]),
+        ];
+
+        let latencies = phase_latencies(journals);
+
+        assert_eq!(latencies[0].swaps(), 1);
+        assert_eq!(latencies[0].percentile(50), Some(Duration::from_secs(1)));
+        assert_eq!(latencies[1].swaps(), 2);
+        assert_eq!(latencies[1].percentile(50), Some(Duration::from_secs(2)));
+        assert_eq!(latencies[1].percentile(100), Some(Duration::from_secs(5)));
+        assert_eq!(latencies[2].percentile(50), None);
+    }
+
+    #[test]
+    fn percentiles_use_the_nearest_rank() {
+        let latency = PhaseLatency {
+            phase: "test",
+            samples: (1..=10).map(Duration::from_secs).collect(),
+        };
+
+        assert_eq!(latency.percentile(0), Some(Duration::from_secs(1)));
+        assert_eq!(latency.percentile(50), Some(Duration::from_secs(5)));
+        assert_eq!(latency.percentile(90), Some(Duration::from_secs(9)));
+        assert_eq!(latency.percentile(99), Some(Duration::from_secs(10)));
+    }
+
+    fn journal(transitions: &[(&str, u64)]) -> Vec<JournalEntry> {
+        transitions
+            .iter()
+            .map(|(tag, timestamp)| JournalEntry {
+                tag: tag.to_string(),
+                timestamp: *timestamp,
+                btc_amount: None,
+                xmr_amount: None,
+                bitcoin_txid: None,
+                monero_tx_hash: None,
+            })
+            .collect()
+    }
+}
@@ -0,0 +1,167 @@
+use crate::database::{Database, Reservations};
+use crate::monero;
+use anyhow::{Context, Result};
+use std::sync::{Arc, Mutex, MutexGuard, PoisonError, Weak};
+use std::time::{Duration, Instant};
+
+/// How often the balance and block height of the wallet are refreshed.
+const REFRESH_INTERVAL: Duration = Duration::from_secs(10);
+
+/// A balance older than this is not trusted anymore, the wallet is asked
+/// again and quotes fail if it does not answer.
+const MAX_BALANCE_AGE: Duration = Duration::from_secs(60);
+
+/// Tells how much Monero can be promised to new swaps.
+///
+/// The unlocked balance is read in the background, which also keeps the cache
+/// of the wallet fresh. Monero that is reserved for swaps that did not lock
+/// yet, and Monero that was locked since the last refresh, is taken off it.
+/// Swap setups and quotes therefore never wait for the wallet and cannot
+/// promise the same Monero twice.
+pub struct Ledger {
+    db: Arc<Database>,
+    monero_wallet: Arc<monero::Wallet>,
+    balance: Mutex<Option<Balance>>,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+struct Balance {
+    unlocked: monero::Amount,
+    /// What the swaps had locked in total before the balance was fetched.
+    locked_before: monero::Amount,
+    fetched_at: Instant,
+}
+
+impl Ledger {
+    /// Creates the ledger and keeps its balance up to date until it is
+    /// dropped.
+    pub fn spawn(db: Arc<Database>, monero_wallet: Arc<monero::Wallet>) -> Arc<Self> {
+        let ledger = Arc::new(Self {
+            db,
+            monero_wallet,
+            balance: Mutex::new(None),
+        });
+
+        tokio::spawn(track_balance(Arc::downgrade(&ledger)));
+
+        ledger
+    }
+
+    /// The Monero that is neither reserved for nor locked by a swap.
+    ///
+    /// Only asks the wallet if the balance was not fetched successfully within
+    /// [`MAX_BALANCE_AGE`].
+    pub async fn available(&self) -> Result<monero::Amount> {
+        let cached = *self.balance();
+        let balance = match cached {
+            Some(balance) if balance.is_fresh() => balance,
+            _ => self.refresh().await?,
+        };
+
+        Ok(balance.available(self.db.reservations()))
+    }
+
+    async fn refresh(&self) -> Result<Balance> {
+        // Read before the balance, a swap locking in between is rather taken
+        // off twice than not at all.
+        let locked_before = self.db.reservations().locked();
+        let unlocked = self
+            .monero_wallet
+            .refresh_cache()
+            .await
+            .context("Failed to get unlocked Monero balance")?
+            .unlocked;
+
+        let balance = Balance {
+            unlocked,
+            locked_before,
+            fetched_at: Instant::now(),
+        };
+        *self.balance() = Some(balance);
+
+        Ok(balance)
+    }
+
+    fn balance(&self) -> MutexGuard<'_, Option<Balance>> {
+        self.balance.lock().unwrap_or_else(PoisonError::into_inner)
+    }
+}
+
+impl Balance {
+    fn is_fresh(&self) -> bool {
+        self.fetched_at.elapsed() < MAX_BALANCE_AGE
+    }
+
+    fn available(&self, reservations: &Reservations) -> monero::Amount {
+        let locked_since = reservations
+            .locked()
+            .as_piconero()
+            .saturating_sub(self.locked_before.as_piconero());
+
+        monero::Amount::from_piconero(
+            self.unlocked
+                .as_piconero()
+                .saturating_sub(reservations.reserved().as_piconero())
+                .saturating_sub(locked_since),
+        )
+    }
+}
+
+async fn track_balance(ledger: Weak<Ledger>) {
+    let mut interval = tokio::time::interval(REFRESH_INTERVAL);
+
+    loop {
+        interval.tick().await;
+
+        let ledger = match ledger.upgrade() {
+            Some(ledger) => ledger,
+            None => return,
+        };
+
+        if let Err(error) = ledger.refresh().await {
+            tracing::warn!("Failed to refresh Monero balance: {:#}", error);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use uuid::Uuid;
+
+    #[test]
+    fn reserved_monero_is_not_available() {
+        let reservations = Reservations::default();
+        let balance = Balance {
+            unlocked: xmr(10),
+            locked_before: monero::Amount::ZERO,
+            fetched_at: Instant::now(),
+        };
+
+        reservations.reserve(Uuid::new_v4(), xmr(3));
+        assert_eq!(balance.available(&reservations), xmr(7));
+
+        reservations.reserve(Uuid::new_v4(), xmr(8));
+        assert_eq!(balance.available(&reservations), monero::Amount::ZERO);
+    }
+
+    #[test]
+    fn old_balances_are_not_fresh() {
+        let balance = Balance {
+            unlocked: xmr(10),
+            locked_before: monero::Amount::ZERO,
+            fetched_at: Instant::now(),
+        };
+        assert!(balance.is_fresh());
+
+        let stale = Balance {
+            fetched_at: Instant::now() - MAX_BALANCE_AGE,
+            ..balance
+        };
+        assert!(!stale.is_fresh());
+    }
+
+    fn xmr(amount: u64) -> monero::Amount {
+        monero::Amount::ONE_XMR * amount
+    }
+}
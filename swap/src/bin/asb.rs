@@ -18,9 +18,11 @@ use libp2p::core::multiaddr::Protocol;
 use libp2p::core::Multiaddr;
 use libp2p::swarm::AddressScore;
 use libp2p::Swarm;
-use std::env;
+use monero_rpc::monerod;
 use std::net::{IpAddr, Ipv4Addr, SocketAddr};
 use std::sync::Arc;
+use std::time::Duration;
+use std::{env, io};
 use structopt::clap;
 use structopt::clap::ErrorKind;
 use swap::asb::command::{parse_args, Arguments, Command};
@@ -28,7 +30,7 @@ use swap::asb::config::{
     initial_setup, query_user_for_initial_config, read_config, Config, ConfigNotInitialized,
 };
 use swap::asb::{cancel, punish, redeem, refund, safely_abort, EventLoop, Finality, KrakenRate};
-use swap::database::Database;
+use swap::database::{export_history, Database, Role};
 use swap::monero::Amount;
 use swap::network::rendezvous::XmrBtcNamespace;
 use swap::network::swarm;
@@ -39,6 +41,7 @@ use swap::{asb, bitcoin, kraken, monero, tor};
 use tracing_subscriber::filter::LevelFilter;
 
 const DEFAULT_WALLET_NAME: &str = "asb-wallet";
+const ARCHIVE_FILE_NAME: &str = "swap-archive";
 
 #[tokio::main]
 async fn main() -> Result<()> {
@@ -91,7 +94,7 @@ async fn main() -> Result<()> {
 
     let db_path = config.data.dir.join("database");
 
-    let db = Database::open(config.data.dir.join(db_path).as_path())
+    let db = Database::open(config.data.dir.join(&db_path).as_path())
         .context("Could not open database")?;
 
     let seed =
@@ -99,7 +102,10 @@ async fn main() -> Result<()> {
 
     match cmd {
         Command::Start { resume_only } => {
-            let bitcoin_wallet = init_bitcoin_wallet(&config, &seed, env_config).await?;
+            let bitcoin_wallet = Arc::new(init_bitcoin_wallet(&config, &seed, env_config).await?);
+            tokio::spawn(bitcoin::report_electrum_stats(Arc::downgrade(
+                &bitcoin_wallet,
+            )));
 
             let monero_wallet = init_monero_wallet(&config, env_config).await?;
 
@@ -171,12 +177,22 @@ async fn main() -> Result<()> {
                 );
             }
 
+            let monero_wallet = Arc::new(monero_wallet);
+            let db = Arc::new(db);
+            if let Some(target) = config.monero.split_outputs {
+                tokio::spawn(monero::keep_outputs_split(
+                    Arc::downgrade(&monero_wallet),
+                    Arc::downgrade(&db),
+                    target,
+                ));
+            }
+
             let (event_loop, mut swap_receiver) = EventLoop::new(
                 swarm,
                 env_config,
-                Arc::new(bitcoin_wallet),
-                Arc::new(monero_wallet),
-                Arc::new(db),
+                bitcoin_wallet,
+                monero_wallet,
+                db,
                 kraken_rate.clone(),
                 config.maker.min_buy_btc,
                 config.maker.max_buy_btc,
@@ -188,11 +204,15 @@ async fn main() -> Result<()> {
                     let rate = kraken_rate.clone();
                     tokio::spawn(async move {
                         let swap_id = swap.swap_id;
+                        let db = swap.db.clone();
                         match run(swap, rate).await {
                             Ok(state) => {
                                 tracing::debug!(%swap_id, final_state=%state, "Swap completed")
                             }
                             Err(error) => {
+                                // The swap is only resumed on restart, which reserves
+                                // its Monero again.
+                                db.reservations().release(swap_id);
                                 tracing::error!(%swap_id, "Swap failed: {:#}", error)
                             }
                         }
@@ -202,17 +222,50 @@ async fn main() -> Result<()> {
 
             event_loop.run().await;
         }
-        Command::History => {
+        Command::History { query, format } => {
+            let stdout = io::stdout();
+            export_history(
+                db.history(Role::Alice, &query)?,
+                format,
+                io::BufWriter::new(stdout.lock()),
+            )?;
+        }
+        Command::PhaseLatencies => {
+            let journals = db
+                .journals()
+                .map(|journal| journal.map(|(_, entries)| entries))
+                .collect::<Result<Vec<_>>>()?;
+
             let mut table = Table::new();
 
-            table.set_header(vec!["SWAP ID", "STATE"]);
+            table.set_header(vec!["PHASE", "SWAPS", "P50", "P90", "P99", "MAX"]);
+
+            for latency in asb::phase_latencies(journals) {
+                let mut row = vec![latency.phase.to_string(), latency.swaps().to_string()];
+                row.extend([50, 90, 99, 100].iter().map(|percent| {
+                    latency.percentile(*percent).map_or_else(
+                        || "-".to_string(),
+                        |duration| format!("{:.1}s", duration.as_secs_f64()),
+                    )
+                }));
 
-            for (swap_id, state) in db.all_alice()? {
-                table.add_row(vec![swap_id.to_string(), state.to_string()]);
+                table.add_row(row);
             }
 
             println!("{}", table);
         }
+        Command::Archive { older_than_days } => {
+            let archive_path = config.data.dir.join(ARCHIVE_FILE_NAME);
+            let older_than = Duration::from_secs(older_than_days.saturating_mul(24 * 60 * 60));
+
+            let archived = db.archive_finished_swaps(&archive_path, older_than).await?;
+            db.compact(&db_path).context("Could not compact database")?;
+
+            tracing::info!(
+                %archived,
+                archive=%archive_path.display(),
+                "Archived finished swaps");
+        }
         Command::WithdrawBtc { amount, address } => {
             let bitcoin_wallet = init_bitcoin_wallet(&config, &seed, env_config).await?;
 
@@ -312,7 +365,7 @@ async fn init_bitcoin_wallet(
     let wallet_dir = config.data.dir.join("wallet");
 
     let wallet = bitcoin::Wallet::new(
-        config.bitcoin.electrum_rpc_url.clone(),
+        config.bitcoin.electrum_rpc_urls(),
         &wallet_dir,
         seed.derive_extended_private_key(env_config.bitcoin_network)?,
         env_config,
@@ -338,6 +391,28 @@ async fn init_monero_wallet(
     )
     .await?;
 
+    let wallet = match &config.monero.daemon_address {
+        Some(daemon_address) => {
+            let wallet_rpc = monero::WalletRpc::new(config.data.dir.join("monero")).await?;
+
+            wallet
+                .with_daemon(monero_wallet::Wallet::new(
+                    monerod::Client::from_daemon_address(daemon_address)?,
+                ))
+                .with_workers(monero::WalletRpcPool::new(
+                    wallet_rpc,
+                    env_config.monero_network,
+                    daemon_address.clone(),
+                ))
+        }
+        None => wallet,
+    };
+
+    let wallet = match config.monero.lock_batch_window_secs {
+        Some(window) => wallet.with_transfer_batching(Duration::from_secs(window)),
+        None => wallet,
+    };
+
     Ok(wallet)
 }
 
@@ -14,18 +14,19 @@
 
 use anyhow::{Context, Result};
 use comfy_table::Table;
+use monero_rpc::monerod;
 use qrcode::render::unicode;
 use qrcode::QrCode;
 use std::cmp::min;
-use std::env;
 use std::future::Future;
 use std::path::PathBuf;
 use std::sync::Arc;
 use std::time::Duration;
+use std::{env, io};
 use swap::bitcoin::TxLock;
 use swap::cli::command::{parse_args_and_apply_defaults, Arguments, Command, ParseResult};
 use swap::cli::{list_sellers, EventLoop, SellerStatus};
-use swap::database::Database;
+use swap::database::{export_history, Database, Role};
 use swap::env::Config;
 use swap::libp2p_ext::MultiAddrExt;
 use swap::network::quote::BidQuote;
@@ -56,7 +57,7 @@ async fn main() -> Result<()> {
     match cmd {
         Command::BuyXmr {
             seller,
-            bitcoin_electrum_rpc_url,
+            bitcoin_electrum_rpc_urls,
             bitcoin_target_block,
             bitcoin_change_address,
             monero_receive_address,
@@ -72,7 +73,7 @@ async fn main() -> Result<()> {
                 .context("Failed to read in seed file")?;
 
             let bitcoin_wallet = init_bitcoin_wallet(
-                bitcoin_electrum_rpc_url,
+                bitcoin_electrum_rpc_urls,
                 &seed,
                 data_dir.clone(),
                 env_config,
@@ -138,23 +139,20 @@ async fn main() -> Result<()> {
                 }
             }
         }
-        Command::History => {
+        Command::History { query, format } => {
             let db = Database::open(data_dir.join("database").as_path())
                 .context("Failed to open database")?;
 
-            let mut table = Table::new();
-
-            table.set_header(vec!["SWAP ID", "STATE"]);
-
-            for (swap_id, state) in db.all_bob()? {
-                table.add_row(vec![swap_id.to_string(), state.to_string()]);
-            }
-
-            println!("{}", table);
+            let stdout = io::stdout();
+            export_history(
+                db.history(Role::Bob, &query)?,
+                format,
+                io::BufWriter::new(stdout.lock()),
+            )?;
         }
         Command::Resume {
             swap_id,
-            bitcoin_electrum_rpc_url,
+            bitcoin_electrum_rpc_urls,
             bitcoin_target_block,
             monero_daemon_address,
             tor_socks5_port,
@@ -166,7 +164,7 @@ async fn main() -> Result<()> {
                 .context("Failed to read in seed file")?;
 
             let bitcoin_wallet = init_bitcoin_wallet(
-                bitcoin_electrum_rpc_url,
+                bitcoin_electrum_rpc_urls,
                 &seed,
                 data_dir.clone(),
                 env_config,
@@ -219,7 +217,7 @@ async fn main() -> Result<()> {
         Command::Cancel {
             swap_id,
             force,
-            bitcoin_electrum_rpc_url,
+            bitcoin_electrum_rpc_urls,
             bitcoin_target_block,
         } => {
             cli::tracing::init(debug, json, data_dir.join("logs"), Some(swap_id))?;
@@ -229,7 +227,7 @@ async fn main() -> Result<()> {
                 .context("Failed to read in seed file")?;
 
             let bitcoin_wallet = init_bitcoin_wallet(
-                bitcoin_electrum_rpc_url,
+                bitcoin_electrum_rpc_urls,
                 &seed,
                 data_dir,
                 env_config,
@@ -251,7 +249,7 @@ async fn main() -> Result<()> {
         Command::Refund {
             swap_id,
             force,
-            bitcoin_electrum_rpc_url,
+            bitcoin_electrum_rpc_urls,
             bitcoin_target_block,
         } => {
             cli::tracing::init(debug, json, data_dir.join("logs"), Some(swap_id))?;
@@ -261,7 +259,7 @@ async fn main() -> Result<()> {
                 .context("Failed to read in seed file")?;
 
             let bitcoin_wallet = init_bitcoin_wallet(
-                bitcoin_electrum_rpc_url,
+                bitcoin_electrum_rpc_urls,
                 &seed,
                 data_dir,
                 env_config,
@@ -342,7 +340,7 @@ async fn main() -> Result<()> {
 }
 
 async fn init_bitcoin_wallet(
-    electrum_rpc_url: Url,
+    electrum_rpc_urls: Vec<Url>,
     seed: &Seed,
     data_dir: PathBuf,
     env_config: Config,
@@ -351,7 +349,7 @@ async fn init_bitcoin_wallet(
     let wallet_dir = data_dir.join("wallet");
 
     let wallet = bitcoin::Wallet::new(
-        electrum_rpc_url.clone(),
+        electrum_rpc_urls,
         &wallet_dir,
         seed.derive_extended_private_key(env_config.bitcoin_network)?,
         env_config,
@@ -385,7 +383,15 @@ async fn init_monero_wallet(
         MONERO_BLOCKCHAIN_MONITORING_WALLET_NAME.to_string(),
         env_config,
     )
-    .await?;
+    .await?
+    .with_daemon(monero_wallet::Wallet::new(
+        monerod::Client::from_daemon_address(&monero_daemon_address)?,
+    ))
+    .with_workers(monero::WalletRpcPool::new(
+        monero_wallet_rpc,
+        network,
+        monero_daemon_address,
+    ));
 
     Ok((monero_wallet, monero_wallet_rpc_process))
 }
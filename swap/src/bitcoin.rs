@@ -1,5 +1,7 @@
+pub mod electrum;
 pub mod wallet;
 
+mod address_pool;
 mod cancel;
 mod lock;
 mod punish;
@@ -7,6 +9,7 @@ mod redeem;
 mod refund;
 mod timelocks;
 
+pub use crate::bitcoin::address_pool::PooledAddress;
 pub use crate::bitcoin::cancel::{CancelTimelock, PunishTimelock, TxCancel};
 pub use crate::bitcoin::lock::TxLock;
 pub use crate::bitcoin::punish::TxPunish;
@@ -19,7 +22,7 @@ pub use ::bitcoin::{Address, Network, Transaction, Txid};
 pub use ecdsa_fun::adaptor::EncryptedSignature;
 pub use ecdsa_fun::fun::Scalar;
 pub use ecdsa_fun::Signature;
-pub use wallet::Wallet;
+pub use wallet::{report_electrum_stats, Wallet};
 
 use crate::bitcoin::wallet::ScriptStatus;
 use ::bitcoin::hashes::hex::ToHex;
@@ -343,6 +346,7 @@ mod tests {
             punish_address,
             tx_redeem_fee,
             tx_punish_fee,
+            alice::SpendKeyShare::new_random(&mut OsRng),
             &mut OsRng,
         );
 
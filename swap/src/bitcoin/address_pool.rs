@@ -0,0 +1,203 @@
+use crate::bitcoin::Address;
+use anyhow::{Context, Result};
+use std::collections::VecDeque;
+use std::convert::TryFrom;
+use std::sync::{Arc, Mutex, MutexGuard, PoisonError, Weak};
+
+/// How many addresses are kept ready.
+///
+/// Every swap setup takes two addresses. Addresses are derived ahead of their
+/// use, hence the pool must stay well below the stop gap the wallet syncs
+/// with.
+pub const ADDRESS_POOL_SIZE: usize = 10;
+
+/// Addresses derived ahead of time, so that taking one doesn't wait for the
+/// wallet lock.
+///
+/// The derivation indices of the pooled addresses are kept in a sled tree next
+/// to the wallet database. Addresses that were pooled but never used are
+/// handed out again after a restart, instead of deriving a fresh set and
+/// growing the gap of unused addresses with every start.
+#[derive(Debug, Default)]
+pub struct AddressPool {
+    addresses: Mutex<VecDeque<(u32, Address)>>,
+    store: Option<bdk::sled::Tree>,
+}
+
+impl AddressPool {
+    pub fn new(store: bdk::sled::Tree) -> Self {
+        Self {
+            addresses: Mutex::default(),
+            store: Some(store),
+        }
+    }
+
+    /// The derivation indices of the addresses that were in the pool when it
+    /// was last used, in ascending order.
+    pub fn stored_indices(&self) -> Result<Vec<u32>> {
+        let store = match &self.store {
+            Some(store) => store,
+            None => return Ok(Vec::new()),
+        };
+
+        store
+            .iter()
+            .keys()
+            .map(|key| {
+                let key = key.context("Failed to read address pool")?;
+                let index = <[u8; 4]>::try_from(key.as_ref())
+                    .context("Address pool holds an invalid derivation index")?;
+
+                Ok(u32::from_be_bytes(index))
+            })
+            .collect()
+    }
+
+    pub fn take(self: &Arc<Self>) -> Option<PooledAddress> {
+        let (index, address) = self.addresses().pop_front()?;
+        self.forget(index);
+
+        Some(PooledAddress::new(index, address, self))
+    }
+
+    pub fn push(&self, index: u32, address: Address) {
+        self.remember(index);
+        self.addresses().push_back((index, address));
+    }
+
+    pub fn len(&self) -> usize {
+        self.addresses().len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.addresses().is_empty()
+    }
+
+    /// Returned addresses have been derived before the ones still in the pool,
+    /// hence they are handed out first to keep the gap small.
+    fn put_back(&self, index: u32, address: Address) {
+        self.remember(index);
+        self.addresses().push_front((index, address));
+    }
+
+    fn addresses(&self) -> MutexGuard<'_, VecDeque<(u32, Address)>> {
+        self.addresses
+            .lock()
+            .unwrap_or_else(PoisonError::into_inner)
+    }
+
+    // Failing to store the pool only costs an address that is derived anew
+    // after the next restart.
+    fn remember(&self, index: u32) {
+        if let Some(store) = &self.store {
+            if let Err(error) = store.insert(index.to_be_bytes(), Vec::<u8>::new()) {
+                tracing::warn!(%index, "Failed to store pooled address: {:#}", error);
+            }
+        }
+    }
+
+    fn forget(&self, index: u32) {
+        if let Some(store) = &self.store {
+            if let Err(error) = store.remove(index.to_be_bytes()) {
+                tracing::warn!(%index, "Failed to remove taken address from store: {:#}", error);
+            }
+        }
+    }
+}
+
+/// An address taken from the [`AddressPool`].
+///
+/// Unless it is marked as used through [`PooledAddress::into_address`], the
+/// address goes back into the pool when this is dropped.
+#[derive(Debug)]
+pub struct PooledAddress {
+    address: Option<(u32, Address)>,
+    pool: Weak<AddressPool>,
+}
+
+impl PooledAddress {
+    pub fn new(index: u32, address: Address, pool: &Arc<AddressPool>) -> Self {
+        Self {
+            address: Some((index, address)),
+            pool: Arc::downgrade(pool),
+        }
+    }
+
+    pub fn address(&self) -> &Address {
+        self.address
+            .as_ref()
+            .map(|(_, address)| address)
+            .expect("address to be present until dropped")
+    }
+
+    /// Marks the address as used, it will not be handed out again.
+    pub fn into_address(mut self) -> Address {
+        self.address
+            .take()
+            .map(|(_, address)| address)
+            .expect("address to be present until dropped")
+    }
+}
+
+impl Drop for PooledAddress {
+    fn drop(&mut self) {
+        if let (Some((index, address)), Some(pool)) = (self.address.take(), self.pool.upgrade()) {
+            pool.put_back(index, address);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::str::FromStr;
+
+    #[test]
+    fn dropped_address_is_handed_out_again_first() {
+        let pool = Arc::new(AddressPool::default());
+        pool.push(0, address("bcrt1q08pfqpsyrt7acllzyjm8q5qsz5capvyahm49rw"));
+        pool.push(1, address("bcrt1qqqqsyqcyq5rqwzqfpg9scrgwpugpzysnard0ew"));
+
+        let first = pool.take().unwrap();
+        assert_eq!(pool.len(), 1);
+
+        let first_address = first.address().clone();
+        drop(first);
+
+        assert_eq!(pool.len(), 2);
+        assert_eq!(pool.take().unwrap().address(), &first_address);
+    }
+
+    #[test]
+    fn used_address_is_not_returned() {
+        let pool = Arc::new(AddressPool::default());
+        pool.push(0, address("bcrt1q08pfqpsyrt7acllzyjm8q5qsz5capvyahm49rw"));
+
+        let _ = pool.take().unwrap().into_address();
+
+        assert!(pool.is_empty());
+    }
+
+    #[test]
+    fn unused_addresses_are_stored_across_restarts() {
+        let store = bdk::sled::Config::new()
+            .temporary(true)
+            .open()
+            .unwrap()
+            .open_tree("address_pool")
+            .unwrap();
+        let pool = Arc::new(AddressPool::new(store.clone()));
+        pool.push(3, address("bcrt1q08pfqpsyrt7acllzyjm8q5qsz5capvyahm49rw"));
+        pool.push(4, address("bcrt1qqqqsyqcyq5rqwzqfpg9scrgwpugpzysnard0ew"));
+
+        let _ = pool.take().unwrap().into_address();
+        drop(pool.take().unwrap());
+
+        let restarted = AddressPool::new(store);
+        assert_eq!(restarted.stored_indices().unwrap(), vec![4]);
+    }
+
+    fn address(address: &str) -> Address {
+        Address::from_str(address).unwrap()
+    }
+}
@@ -0,0 +1,421 @@
+use anyhow::{anyhow, bail, Context, Result};
+use bdk::electrum_client::{Client, ElectrumApi, Error};
+use reqwest::Url;
+use std::convert::TryFrom;
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::{Arc, Mutex, PoisonError, Weak};
+use std::time::{Duration, Instant};
+
+/// How often all endpoints are pinged to measure their latency and bring
+/// failed ones back into rotation.
+const HEALTH_CHECK_INTERVAL: Duration = Duration::from_secs(30);
+
+/// Number of endpoints a hedged request is sent to.
+const HEDGE_FANOUT: usize = 2;
+
+/// A set of Electrum servers that requests are balanced across.
+///
+/// Each request is sent to the healthy endpoint with the lowest latency. If it
+/// fails, the request is retried on the next best endpoint. Time-critical
+/// requests can be hedged, i.e. sent to several endpoints at once, taking
+/// whichever response arrives first.
+pub struct Pool {
+    endpoints: Vec<Arc<Endpoint>>,
+}
+
+impl Pool {
+    /// Connects to all given servers and measures their latency.
+    ///
+    /// Fails if none of them is reachable.
+    pub fn new(urls: Vec<Url>) -> Result<Self> {
+        if urls.is_empty() {
+            bail!("At least one Electrum server is required")
+        }
+
+        let endpoints = urls
+            .into_iter()
+            .map(|url| Arc::new(Endpoint::new(url)))
+            .collect::<Vec<_>>();
+
+        for endpoint in endpoints.iter() {
+            if let Err(error) = endpoint.check_health() {
+                tracing::warn!(url = %endpoint.url, "Electrum server is unreachable: {:#}", error);
+            }
+        }
+
+        if !endpoints.iter().any(|endpoint| endpoint.is_healthy()) {
+            bail!("Failed to connect to any Electrum server")
+        }
+
+        Ok(Self { endpoints })
+    }
+
+    /// Opens a new connection to the best endpoint that accepts it.
+    ///
+    /// The connection is not shared with anybody, which is what subscriptions
+    /// need because notifications are bound to a connection.
+    pub fn connect(&self) -> Result<Client> {
+        let mut last_error = None;
+
+        for endpoint in self.ranked() {
+            match Client::new(endpoint.url.as_str()) {
+                Ok(client) => {
+                    tracing::debug!(url = %endpoint.url, "Connected to Electrum server");
+                    return Ok(client);
+                }
+                Err(error) => {
+                    endpoint.record_failure();
+                    last_error = Some(error);
+                }
+            }
+        }
+
+        Err(anyhow!(
+            last_error.expect("pool to have at least one endpoint")
+        ))
+        .context("Failed to connect to any Electrum server")
+    }
+
+    /// Sends the request to the best endpoint, failing over to the others in
+    /// order of their latency.
+    pub async fn call<T, F>(&self, request: F) -> Result<T>
+    where
+        F: Fn(&Client) -> Result<T, Error> + Send + Sync + 'static,
+        T: Send + 'static,
+    {
+        call_in_order(self.ranked(), Arc::new(request)).await
+    }
+
+    /// Sends the request to the two best endpoints at once and returns the
+    /// first successful response.
+    ///
+    /// Falls back to [`Pool::call`] if there are not enough healthy endpoints.
+    pub async fn call_hedged<T, F>(&self, request: F) -> Result<T>
+    where
+        F: Fn(&Client) -> Result<T, Error> + Send + Sync + 'static,
+        T: Send + 'static,
+    {
+        let ranked = self.ranked();
+        let healthy = ranked
+            .iter()
+            .filter(|endpoint| endpoint.is_healthy())
+            .count();
+
+        if healthy < HEDGE_FANOUT {
+            return call_in_order(ranked, Arc::new(request)).await;
+        }
+
+        let request = Arc::new(request);
+        let mut hedged = ranked.into_iter();
+        let first = call_endpoint(hedged.next().expect("two endpoints"), request.clone());
+        let second = call_endpoint(hedged.next().expect("two endpoints"), request);
+
+        tokio::pin!(first, second);
+
+        // The slower request keeps running in the background, its outcome still counts
+        // towards the statistics of its endpoint.
+        tokio::select! {
+            result = &mut first => match result {
+                Ok(response) => Ok(response),
+                Err(error) => {
+                    tracing::debug!("Hedged Electrum request failed: {:#}", error);
+                    second.await
+                }
+            },
+            result = &mut second => match result {
+                Ok(response) => Ok(response),
+                Err(error) => {
+                    tracing::debug!("Hedged Electrum request failed: {:#}", error);
+                    first.await
+                }
+            },
+        }
+    }
+
+    pub fn stats(&self) -> Vec<EndpointStats> {
+        self.endpoints
+            .iter()
+            .map(|endpoint| endpoint.stats())
+            .collect()
+    }
+
+    /// All endpoints, the healthy ones first, ordered by their latency.
+    fn ranked(&self) -> Vec<Arc<Endpoint>> {
+        let mut endpoints = self.endpoints.clone();
+        endpoints.sort_by_key(|endpoint| (!endpoint.is_healthy(), endpoint.latency_micros()));
+
+        endpoints
+    }
+}
+
+/// Regularly pings all endpoints of the pool until the pool is dropped.
+pub async fn check_health(pool: Weak<Pool>) {
+    let mut interval = tokio::time::interval(HEALTH_CHECK_INTERVAL);
+
+    loop {
+        interval.tick().await;
+
+        let endpoints = match pool.upgrade() {
+            Some(pool) => pool.endpoints.clone(),
+            None => return,
+        };
+
+        for endpoint in endpoints {
+            let check = tokio::task::spawn_blocking({
+                let endpoint = endpoint.clone();
+                move || endpoint.check_health()
+            })
+            .await;
+
+            let stats = endpoint.stats();
+            match check {
+                Ok(Ok(())) => {
+                    tracing::debug!(
+                        url = %stats.url,
+                        latency = ?stats.latency,
+                        requests = stats.requests,
+                        errors = stats.errors,
+                        "Electrum server is healthy"
+                    );
+                }
+                Ok(Err(error)) => {
+                    tracing::warn!(
+                        url = %stats.url,
+                        requests = stats.requests,
+                        errors = stats.errors,
+                        "Electrum server failed health check: {:#}",
+                        error
+                    );
+                }
+                Err(error) => {
+                    tracing::error!("Electrum health check did not complete: {:#}", error);
+                }
+            }
+        }
+    }
+}
+
+#[derive(Debug, Clone, PartialEq)]
+pub struct EndpointStats {
+    pub url: Url,
+    pub healthy: bool,
+    /// Moving average of the round-trip time, `None` until the first
+    /// successful request.
+    pub latency: Option<Duration>,
+    pub requests: u64,
+    pub errors: u64,
+}
+
+struct Endpoint {
+    url: Url,
+    client: Mutex<Option<Arc<Client>>>,
+    healthy: AtomicBool,
+    latency_micros: AtomicU64,
+    requests: AtomicU64,
+    errors: AtomicU64,
+}
+
+impl Endpoint {
+    fn new(url: Url) -> Self {
+        Self {
+            url,
+            client: Mutex::new(None),
+            healthy: AtomicBool::new(false),
+            latency_micros: AtomicU64::new(0),
+            requests: AtomicU64::new(0),
+            errors: AtomicU64::new(0),
+        }
+    }
+
+    fn check_health(&self) -> Result<(), Error> {
+        self.call(&|client: &Client| client.ping())
+    }
+
+    /// Sends the request, (re-)connecting if necessary.
+    ///
+    /// Errors returned by the server itself say nothing about the health of
+    /// the endpoint, only transport errors take it out of rotation.
+    fn call<T>(&self, request: &dyn Fn(&Client) -> Result<T, Error>) -> Result<T, Error> {
+        let client = match self.client() {
+            Ok(client) => client,
+            Err(error) => {
+                self.record_failure();
+                return Err(error);
+            }
+        };
+
+        let started = Instant::now();
+        let response = request(&client);
+
+        match &response {
+            Ok(_) | Err(Error::Protocol(_)) => self.record_success(started.elapsed()),
+            Err(_) => self.record_failure(),
+        }
+
+        response
+    }
+
+    fn client(&self) -> Result<Arc<Client>, Error> {
+        if let Some(client) = self.lock_client().as_ref() {
+            return Ok(client.clone());
+        }
+
+        let client = Arc::new(Client::new(self.url.as_str())?);
+        *self.lock_client() = Some(client.clone());
+
+        Ok(client)
+    }
+
+    fn lock_client(&self) -> std::sync::MutexGuard<'_, Option<Arc<Client>>> {
+        self.client.lock().unwrap_or_else(PoisonError::into_inner)
+    }
+
+    fn record_success(&self, latency: Duration) {
+        let sample = u64::try_from(latency.as_micros())
+            .unwrap_or(u64::MAX)
+            .max(1);
+        let average = match self.latency_micros.load(Ordering::Relaxed) {
+            0 => sample,
+            // Exponential moving average, weighing the latest sample with 1/4.
+            average => (average * 3 + sample) / 4,
+        };
+
+        self.latency_micros.store(average, Ordering::Relaxed);
+        self.requests.fetch_add(1, Ordering::Relaxed);
+
+        if !self.healthy.swap(true, Ordering::Relaxed) {
+            tracing::debug!(url = %self.url, "Electrum server is back in rotation");
+        }
+    }
+
+    fn record_failure(&self) {
+        self.requests.fetch_add(1, Ordering::Relaxed);
+        self.errors.fetch_add(1, Ordering::Relaxed);
+        self.healthy.store(false, Ordering::Relaxed);
+
+        // The connection might be broken, start over with the next request.
+        self.lock_client().take();
+    }
+
+    fn is_healthy(&self) -> bool {
+        self.healthy.load(Ordering::Relaxed)
+    }
+
+    /// Endpoints we have no measurement for yet sort last.
+    fn latency_micros(&self) -> u64 {
+        match self.latency_micros.load(Ordering::Relaxed) {
+            0 => u64::MAX,
+            latency => latency,
+        }
+    }
+
+    fn stats(&self) -> EndpointStats {
+        let latency = match self.latency_micros.load(Ordering::Relaxed) {
+            0 => None,
+            latency => Some(Duration::from_micros(latency)),
+        };
+
+        EndpointStats {
+            url: self.url.clone(),
+            healthy: self.is_healthy(),
+            latency,
+            requests: self.requests.load(Ordering::Relaxed),
+            errors: self.errors.load(Ordering::Relaxed),
+        }
+    }
+}
+
+async fn call_in_order<T, F>(endpoints: Vec<Arc<Endpoint>>, request: Arc<F>) -> Result<T>
+where
+    F: Fn(&Client) -> Result<T, Error> + Send + Sync + 'static,
+    T: Send + 'static,
+{
+    let mut last_error = None;
+
+    for endpoint in endpoints {
+        let url = endpoint.url.clone();
+
+        match call_endpoint(endpoint, request.clone()).await {
+            Ok(response) => return Ok(response),
+            Err(error) if error.downcast_ref::<Error>().map_or(false, is_server_error) => {
+                return Err(error)
+            }
+            Err(error) => {
+                tracing::debug!(%url, "Electrum request failed, trying next server: {:#}", error);
+                last_error = Some(error);
+            }
+        }
+    }
+
+    Err(last_error.unwrap_or_else(|| anyhow!("No Electrum server configured")))
+}
+
+async fn call_endpoint<T, F>(endpoint: Arc<Endpoint>, request: Arc<F>) -> Result<T>
+where
+    F: Fn(&Client) -> Result<T, Error> + Send + Sync + 'static,
+    T: Send + 'static,
+{
+    let url = endpoint.url.clone();
+    let response = tokio::task::spawn_blocking(move || endpoint.call(&*request))
+        .await
+        .context("Electrum request did not complete")?
+        .with_context(|| format!("Electrum request to {} failed", url))?;
+
+    Ok(response)
+}
+
+/// The server understood the request and rejected it, asking somebody else
+/// will not help.
+fn is_server_error(error: &Error) -> bool {
+    matches!(error, Error::Protocol(_))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn healthy_endpoints_are_ranked_by_latency() {
+        let slow = endpoint("tcp://slow:50001", Some(Duration::from_millis(300)));
+        let fast = endpoint("tcp://fast:50001", Some(Duration::from_millis(20)));
+        let down = endpoint("tcp://down:50001", None);
+        down.record_success(Duration::from_millis(1));
+        down.healthy.store(false, Ordering::Relaxed);
+
+        let pool = Pool {
+            endpoints: vec![down, slow, fast],
+        };
+
+        let ranked = pool
+            .ranked()
+            .iter()
+            .map(|endpoint| endpoint.url.host_str().unwrap().to_owned())
+            .collect::<Vec<_>>();
+
+        assert_eq!(ranked, vec!["fast", "slow", "down"]);
+    }
+
+    #[test]
+    fn latency_is_a_moving_average_of_successful_requests() {
+        let endpoint = endpoint("tcp://localhost:50001", Some(Duration::from_millis(100)));
+
+        endpoint.record_success(Duration::from_millis(500));
+        endpoint.record_failure();
+
+        let stats = endpoint.stats();
+        assert_eq!(stats.latency, Some(Duration::from_millis(200)));
+        assert_eq!(stats.requests, 3);
+        assert_eq!(stats.errors, 1);
+        assert!(!stats.healthy);
+    }
+
+    fn endpoint(url: &str, latency: Option<Duration>) -> Arc<Endpoint> {
+        let endpoint = Endpoint::new(Url::parse(url).unwrap());
+
+        if let Some(latency) = latency {
+            endpoint.record_success(latency);
+        }
+
+        Arc::new(endpoint)
+    }
+}
@@ -11,6 +11,12 @@ use std::ops::Add;
 #[serde(transparent)]
 pub struct BlockHeight(u32);
 
+impl BlockHeight {
+    pub const fn new(block_height: u32) -> Self {
+        Self(block_height)
+    }
+}
+
 impl From<BlockHeight> for u32 {
     fn from(height: BlockHeight) -> Self {
         height.0
@@ -1,9 +1,12 @@
+use crate::bitcoin::address_pool::{AddressPool, PooledAddress, ADDRESS_POOL_SIZE};
+use crate::bitcoin::electrum::{self, EndpointStats};
 use crate::bitcoin::timelocks::BlockHeight;
 use crate::bitcoin::{Address, Amount, Transaction};
 use crate::env;
 use ::bitcoin::util::psbt::PartiallySignedTransaction;
 use ::bitcoin::Txid;
 use anyhow::{bail, Context, Result};
+use async_trait::async_trait;
 use bdk::blockchain::{noop_progress, Blockchain, ElectrumBlockchain};
 use bdk::database::BatchDatabase;
 use bdk::descriptor::Segwitv0;
@@ -16,15 +19,17 @@ use reqwest::Url;
 use rust_decimal::prelude::*;
 use rust_decimal::Decimal;
 use rust_decimal_macros::dec;
-use std::collections::{BTreeMap, HashMap};
+use std::collections::{BTreeMap, BTreeSet, HashMap, HashSet};
 use std::convert::TryFrom;
 use std::fmt;
 use std::path::Path;
-use std::sync::Arc;
+use std::sync::atomic::{AtomicU32, Ordering};
+use std::sync::{Arc, MutexGuard, PoisonError, Weak};
 use std::time::{Duration, Instant};
 use tokio::sync::{watch, Mutex};
 
 const SLED_TREE_NAME: &str = "default_tree";
+const ADDRESS_POOL_TREE_NAME: &str = "address_pool";
 
 /// Assuming we add a spread of 3% we don't want to pay more than 3% of the
 /// amount for tx fees.
@@ -32,9 +37,26 @@ const MAX_RELATIVE_TX_FEE: Decimal = dec!(0.03);
 const MAX_ABSOLUTE_TX_FEE: Decimal = dec!(100_000);
 const DUST_AMOUNT: u64 = 546;
 
+/// How often we check for notifications from the Electrum server.
+///
+/// The Electrum client only reads notifications off the connection while
+/// processing a request, hence we need to send a (cheap) ping regularly.
+const NOTIFICATION_POLL_INTERVAL: Duration = Duration::from_secs(1);
+
+/// Fee estimates are refreshed with every block but kept no longer than this,
+/// in case blocks take unusually long.
+const FEE_CACHE_TTL: Duration = Duration::from_secs(10 * 60);
+
+const ADDRESS_POOL_REFILL_INTERVAL: Duration = Duration::from_secs(1);
+
+/// How often the latency and error counters of the Electrum servers are
+/// logged by [`report_electrum_stats`].
+const ELECTRUM_STATS_REPORT_INTERVAL: Duration = Duration::from_secs(10 * 60);
+
 pub struct Wallet<B = ElectrumBlockchain, D = bdk::sled::Tree, C = Client> {
-    client: Arc<Mutex<C>>,
+    client: Arc<C>,
     wallet: Arc<Mutex<bdk::Wallet<B, D>>>,
+    address_pool: Arc<AddressPool>,
     finality_confirmations: u32,
     network: Network,
     target_block: usize,
@@ -42,16 +64,17 @@ pub struct Wallet<B = ElectrumBlockchain, D = bdk::sled::Tree, C = Client> {
 
 impl Wallet {
     pub async fn new(
-        electrum_rpc_url: Url,
+        electrum_rpc_urls: Vec<Url>,
         wallet_dir: &Path,
         key: impl DerivableKey<Segwitv0> + Clone,
         env_config: env::Config,
         target_block: usize,
     ) -> Result<Self> {
-        let client = bdk::electrum_client::Client::new(electrum_rpc_url.as_str())
-            .context("Failed to initialize Electrum RPC client")?;
+        let electrum = Arc::new(electrum::Pool::new(electrum_rpc_urls)?);
+        let client = electrum.connect()?;
 
-        let db = bdk::sled::open(wallet_dir)?.open_tree(SLED_TREE_NAME)?;
+        let sled = bdk::sled::open(wallet_dir)?;
+        let db = sled.open_tree(SLED_TREE_NAME)?;
 
         let wallet = bdk::Wallet::new(
             bdk::template::Bip84(key.clone(), KeychainKind::External),
@@ -61,17 +84,28 @@ impl Wallet {
             ElectrumBlockchain::from(client),
         )?;
 
-        let electrum = bdk::electrum_client::Client::new(electrum_rpc_url.as_str())
-            .context("Failed to initialize Electrum RPC client")?;
-
         let network = wallet.network();
 
+        let client = Arc::new(Client::new(electrum, env_config.bitcoin_sync_interval())?);
+
+        let address_pool = Arc::new(AddressPool::new(sled.open_tree(ADDRESS_POOL_TREE_NAME)?));
+        for index in address_pool.stored_indices()? {
+            let address = wallet
+                .get_address(AddressIndex::Peek(index))
+                .context("Failed to restore pooled address")?;
+            address_pool.push(index, address.address);
+        }
+
+        let wallet = Arc::new(Mutex::new(wallet));
+        tokio::spawn(refill_address_pool(
+            Arc::downgrade(&address_pool),
+            Arc::downgrade(&wallet),
+        ));
+
         Ok(Self {
-            client: Arc::new(Mutex::new(Client::new(
-                electrum,
-                env_config.bitcoin_sync_interval(),
-            )?)),
-            wallet: Arc::new(Mutex::new(wallet)),
+            client,
+            wallet,
+            address_pool,
             finality_confirmations: env_config.bitcoin_finality_confirmations,
             network,
             target_block,
@@ -95,13 +129,9 @@ impl Wallet {
             .subscribe_to((txid, transaction.output[0].script_pubkey.clone()))
             .await;
 
-        self.wallet
-            .lock()
-            .await
-            .broadcast(transaction)
-            .with_context(|| {
-                format!("Failed to broadcast Bitcoin {} transaction {}", kind, txid)
-            })?;
+        self.client.broadcast(transaction).await.with_context(|| {
+            format!("Failed to broadcast Bitcoin {} transaction {}", kind, txid)
+        })?;
 
         tracing::info!(%txid, %kind, "Published Bitcoin transaction");
 
@@ -109,8 +139,9 @@ impl Wallet {
     }
 
     pub async fn get_raw_transaction(&self, txid: Txid) -> Result<Transaction> {
-        self.get_tx(txid)
-            .await?
+        self.client
+            .get_transaction(txid)
+            .await
             .with_context(|| format!("Could not get raw tx with id: {}", txid))
     }
 
@@ -118,58 +149,125 @@ impl Wallet {
     where
         T: Watchable,
     {
-        self.client.lock().await.status_of_script(tx)
+        self.client.status_of_script(tx).await
+    }
+
+    /// Latency and error counters of all configured Electrum servers.
+    pub fn electrum_stats(&self) -> Vec<EndpointStats> {
+        self.client.electrum.stats()
     }
 
+    /// Subscribe to status updates of the given transaction.
+    ///
+    /// Subscriptions are not polled individually. All watched scripts are
+    /// refreshed together by a single background task, see [`watch_scripts`].
     pub async fn subscribe_to(&self, tx: impl Watchable + Send + 'static) -> Subscription {
         let txid = tx.id();
         let script = tx.script();
 
-        let sub = self
-            .client
-            .lock()
-            .await
-            .subscriptions
-            .entry((txid, script.clone()))
-            .or_insert_with(|| {
-                let (sender, receiver) = watch::channel(ScriptStatus::Unseen);
-                let client = self.client.clone();
-
-                tokio::spawn(async move {
-                    let mut last_status = None;
-
-                    loop {
-                        tokio::time::sleep(Duration::from_secs(5)).await;
-
-                        let new_status = match client.lock().await.status_of_script(&tx) {
-                            Ok(new_status) => new_status,
-                            Err(error) => {
-                                tracing::warn!(%txid, "Failed to get status of script: {:#}", error);
-                                return;
-                            }
-                        };
-
-                        last_status = Some(print_status_change(txid, last_status, new_status));
-
-                        let all_receivers_gone = sender.send(new_status).is_err();
-
-                        if all_receivers_gone {
-                            tracing::debug!(%txid, "All receivers gone, removing subscription");
-                            client.lock().await.subscriptions.remove(&(txid, script));
-                            return;
-                        }
-                    }
-                });
-
-                Subscription {
-                    receiver,
-                    finality_confirmations: self.finality_confirmations,
-                    txid,
+        self.client
+            .subscribe(txid, script, self.finality_confirmations)
+    }
+}
+
+/// Regularly logs the latency and error counters of all Electrum servers
+/// until the wallet is dropped.
+pub async fn report_electrum_stats(wallet: Weak<Wallet>) {
+    let mut interval = tokio::time::interval(ELECTRUM_STATS_REPORT_INTERVAL);
+
+    loop {
+        interval.tick().await;
+
+        let stats = match wallet.upgrade() {
+            Some(wallet) => wallet.electrum_stats(),
+            None => return,
+        };
+
+        for stats in stats {
+            tracing::info!(
+                url = %stats.url,
+                healthy = stats.healthy,
+                latency = ?stats.latency,
+                requests = stats.requests,
+                errors = stats.errors,
+                "Electrum server statistics"
+            );
+        }
+    }
+}
+
+/// Keeps the [`AddressPool`] filled, such that taking an address from it
+/// doesn't have to wait for the wallet.
+///
+/// The task stops once the wallet has been dropped.
+async fn refill_address_pool<B, D>(
+    address_pool: Weak<AddressPool>,
+    wallet: Weak<Mutex<bdk::Wallet<B, D>>>,
+) where
+    D: BatchDatabase,
+{
+    let mut interval = tokio::time::interval(ADDRESS_POOL_REFILL_INTERVAL);
+
+    loop {
+        interval.tick().await;
+
+        let (address_pool, wallet) = match (address_pool.upgrade(), wallet.upgrade()) {
+            (Some(address_pool), Some(wallet)) => (address_pool, wallet),
+            _ => return,
+        };
+
+        while address_pool.len() < ADDRESS_POOL_SIZE {
+            let address = wallet.lock().await.get_address(AddressIndex::New);
+
+            match address {
+                Ok(address) => address_pool.push(address.index, address.address),
+                Err(error) => {
+                    tracing::warn!("Failed to derive address for address pool: {:#}", error);
+                    break;
                 }
-            })
-            .clone();
+            }
+        }
+    }
+}
 
-        sub
+/// Processes Electrum notifications for all watched scripts and pushes status
+/// changes to the subscribers.
+///
+/// A single task serves all subscriptions of a wallet, regardless of how many
+/// swaps are in flight. It owns its Electrum connection, hence the blocking
+/// requests it makes don't hold up anybody else. The task stops once the
+/// wallet has been dropped.
+async fn watch_scripts(mut watcher: Watcher, state: Weak<WatcherState>) {
+    let mut interval = tokio::time::interval(NOTIFICATION_POLL_INTERVAL);
+
+    loop {
+        interval.tick().await;
+
+        let state = match state.upgrade() {
+            Some(state) => state,
+            None => return,
+        };
+
+        let refresh = tokio::task::spawn_blocking(move || {
+            let result = watcher.refresh_subscriptions(&state);
+
+            (watcher, result)
+        });
+
+        let result = match refresh.await {
+            Ok((returned, result)) => {
+                watcher = returned;
+                result
+            }
+            Err(error) => {
+                tracing::error!("Bitcoin script watcher stopped unexpectedly: {:#}", error);
+                return;
+            }
+        };
+
+        if let Err(error) = result {
+            tracing::warn!("Failed to refresh watched Bitcoin scripts: {:#}", error);
+        }
     }
 }
 
@@ -193,6 +291,8 @@ pub struct Subscription {
     receiver: watch::Receiver<ScriptStatus>,
     finality_confirmations: u32,
     txid: Txid,
+    /// Keeps the subscription alive within the [`ScriptWatcher`].
+    _handle: Arc<()>,
 }
 
 impl Subscription {
@@ -297,6 +397,29 @@ where
         Ok(address)
     }
 
+    /// Takes an address from the pool of pre-derived addresses.
+    ///
+    /// Only derives a new address if the pool has run dry. Unless it is marked
+    /// as used, the address is returned to the pool once dropped.
+    pub async fn pooled_address(&self) -> Result<PooledAddress> {
+        if let Some(address) = self.address_pool.take() {
+            return Ok(address);
+        }
+
+        let address = self
+            .wallet
+            .lock()
+            .await
+            .get_address(AddressIndex::New)
+            .context("Failed to get new Bitcoin address")?;
+
+        Ok(PooledAddress::new(
+            address.index,
+            address.address,
+            &self.address_pool,
+        ))
+    }
+
     pub async fn transaction_fee(&self, txid: Txid) -> Result<Amount> {
         let fees = self
             .wallet
@@ -331,16 +454,19 @@ where
             }
         }
 
-        let wallet = self.wallet.lock().await;
-        let client = self.client.lock().await;
-        let fee_rate = client.estimate_feerate(self.target_block)?;
+        let fee_rate = self.client.estimate_feerate(self.target_block).await?;
         let script = address.script_pubkey();
 
-        let mut tx_builder = wallet.build_tx();
-        tx_builder.add_recipient(script.clone(), amount.as_sat());
-        tx_builder.fee_rate(fee_rate);
-        let (psbt, _details) = tx_builder.finish()?;
-        let mut psbt: PartiallySignedTransaction = psbt;
+        let mut psbt: PartiallySignedTransaction = {
+            let wallet = self.wallet.lock().await;
+
+            let mut tx_builder = wallet.build_tx();
+            tx_builder.add_recipient(script.clone(), amount.as_sat());
+            tx_builder.fee_rate(fee_rate);
+            let (psbt, _details) = tx_builder.finish()?;
+
+            psbt
+        };
 
         match psbt.global.unsigned_tx.output.as_mut_slice() {
             // our primary output is the 2nd one? reverse the vectors
@@ -377,20 +503,23 @@ where
     /// already accounting for the fees we need to spend to get the
     /// transaction confirmed.
     pub async fn max_giveable(&self, locking_script_size: usize) -> Result<Amount> {
-        let wallet = self.wallet.lock().await;
-        let balance = wallet.get_balance()?;
+        let balance = self.wallet.lock().await.get_balance()?;
         if balance < DUST_AMOUNT {
             return Ok(Amount::ZERO);
         }
-        let client = self.client.lock().await;
-        let min_relay_fee = client.min_relay_fee()?.as_sat();
 
-        if balance < min_relay_fee {
+        let (fee_rate, min_relay_fee) = tokio::try_join!(
+            self.client.estimate_feerate(self.target_block),
+            self.client.min_relay_fee()
+        )?;
+
+        if balance < min_relay_fee.as_sat() {
             return Ok(Amount::ZERO);
         }
 
-        let fee_rate = client.estimate_feerate(self.target_block)?;
-
+        // The balance might have changed in the meantime, which is fine because
+        // building the transaction drains whatever there is.
+        let wallet = self.wallet.lock().await;
         let mut tx_builder = wallet.build_tx();
 
         let dummy_script = Script::from(vec![0u8; locking_script_size]);
@@ -417,9 +546,10 @@ where
         weight: usize,
         transfer_amount: bitcoin::Amount,
     ) -> Result<bitcoin::Amount> {
-        let client = self.client.lock().await;
-        let fee_rate = client.estimate_feerate(self.target_block)?;
-        let min_relay_fee = client.min_relay_fee()?;
+        let (fee_rate, min_relay_fee) = tokio::try_join!(
+            self.client.estimate_feerate(self.target_block),
+            self.client.min_relay_fee()
+        )?;
 
         estimate_fee(weight, transfer_amount, fee_rate, min_relay_fee)
     }
@@ -500,12 +630,6 @@ where
     B: Blockchain,
     D: BatchDatabase,
 {
-    pub async fn get_tx(&self, txid: Txid) -> Result<Option<Transaction>> {
-        let tx = self.wallet.lock().await.client().get_tx(&txid)?;
-
-        Ok(tx)
-    }
-
     pub async fn sync(&self) -> Result<()> {
         self.wallet
             .lock()
@@ -524,9 +648,10 @@ impl<B, D, C> Wallet<B, D, C> {
     }
 }
 
+#[async_trait]
 pub trait EstimateFeeRate {
-    fn estimate_feerate(&self, target_block: usize) -> Result<FeeRate>;
-    fn min_relay_fee(&self) -> Result<bitcoin::Amount>;
+    async fn estimate_feerate(&self, target_block: usize) -> Result<FeeRate>;
+    async fn min_relay_fee(&self) -> Result<bitcoin::Amount>;
 }
 
 #[cfg(test)]
@@ -536,12 +661,13 @@ pub struct StaticFeeRate {
 }
 
 #[cfg(test)]
+#[async_trait]
 impl EstimateFeeRate for StaticFeeRate {
-    fn estimate_feerate(&self, _target_block: usize) -> Result<FeeRate> {
+    async fn estimate_feerate(&self, _target_block: usize) -> Result<FeeRate> {
         Ok(self.fee_rate)
     }
 
-    fn min_relay_fee(&self) -> Result<bitcoin::Amount> {
+    async fn min_relay_fee(&self) -> Result<bitcoin::Amount> {
         Ok(self.min_relay_fee)
     }
 }
@@ -586,11 +712,12 @@ impl Wallet<(), bdk::database::MemoryDatabase, StaticFeeRate> {
             bdk::Wallet::new_offline(&descriptors.0, None, Network::Regtest, database).unwrap();
 
         Self {
-            client: Arc::new(Mutex::new(StaticFeeRate {
+            client: Arc::new(StaticFeeRate {
                 fee_rate: FeeRate::from_sat_per_vb(sats_per_vb),
                 min_relay_fee: bitcoin::Amount::from_sat(min_relay_fee_sats),
-            })),
+            }),
             wallet: Arc::new(Mutex::new(wallet)),
+            address_pool: Default::default(),
             finality_confirmations: 1,
             network: Network::Regtest,
             target_block: 1,
@@ -619,99 +746,300 @@ impl Watchable for (Txid, Script) {
     }
 }
 
+/// Connection of a wallet to its Electrum servers.
+///
+/// Watched scripts are served by a background task with a connection of its
+/// own. All other requests go through the connections of the [`electrum::Pool`]
+/// on which the Electrum client pipelines concurrent requests, hence fee
+/// queries neither wait for each other nor for the script watcher.
 pub struct Client {
+    electrum: Arc<electrum::Pool>,
+    state: Arc<WatcherState>,
+    fees: Arc<FeeCache>,
+}
+
+impl Client {
+    fn new(electrum: Arc<electrum::Pool>, sync_interval: Duration) -> Result<Self> {
+        let watcher = Watcher::new(electrum.clone(), sync_interval)?;
+        let state = Arc::new(WatcherState {
+            subscriptions: Default::default(),
+            latest_block_height: AtomicU32::new(u32::from(watcher.latest_block_height)),
+        });
+
+        tokio::spawn(watch_scripts(watcher, Arc::downgrade(&state)));
+        tokio::spawn(electrum::check_health(Arc::downgrade(&electrum)));
+
+        let fees = Arc::new(FeeCache::default());
+        tokio::spawn(refresh_fees(
+            Arc::downgrade(&fees),
+            electrum.clone(),
+            state.clone(),
+        ));
+
+        Ok(Self {
+            electrum,
+            state,
+            fees,
+        })
+    }
+
+    fn subscribe(&self, txid: Txid, script: Script, finality_confirmations: u32) -> Subscription {
+        // The script is subscribed to on the Electrum server with the next round of
+        // notification processing.
+        self.state
+            .subscriptions()
+            .subscribe(txid, script, finality_confirmations)
+    }
+
+    async fn status_of_script<T>(&self, tx: &T) -> Result<ScriptStatus>
+    where
+        T: Watchable,
+    {
+        let txid = tx.id();
+        let script = tx.script();
+
+        // Mostly used to check on lock transactions, where a slow server delays the
+        // swap.
+        let history = self
+            .electrum
+            .call_hedged(move |electrum| electrum.script_get_history(&script))
+            .await
+            .context("Failed to get script history")?;
+        status_from_history(txid, &history, self.state.latest_block_height())
+    }
+
+    /// Fetches a transaction without holding the lock on the BDK wallet, so a
+    /// slow server does not block other wallet operations.
+    async fn get_transaction(&self, txid: Txid) -> Result<Transaction> {
+        self.electrum
+            .call(move |electrum| electrum.transaction_get(&txid))
+            .await
+    }
+
+    async fn broadcast(&self, transaction: Transaction) -> Result<Txid> {
+        self.electrum
+            .call_hedged(move |electrum| electrum.transaction_broadcast(&transaction))
+            .await
+    }
+}
+
+/// State shared between a [`Client`] and its background [`Watcher`].
+struct WatcherState {
+    subscriptions: std::sync::Mutex<ScriptWatcher>,
+    latest_block_height: AtomicU32,
+}
+
+impl WatcherState {
+    /// The lock is only ever held for bookkeeping, never across a request to
+    /// the Electrum server.
+    fn subscriptions(&self) -> MutexGuard<'_, ScriptWatcher> {
+        self.subscriptions
+            .lock()
+            .unwrap_or_else(PoisonError::into_inner)
+    }
+
+    fn latest_block_height(&self) -> BlockHeight {
+        BlockHeight::new(self.latest_block_height.load(Ordering::SeqCst))
+    }
+}
+
+/// Tracks the history of all watched scripts through Electrum notifications.
+struct Watcher {
     electrum: bdk::electrum_client::Client,
+    pool: Arc<electrum::Pool>,
     latest_block_height: BlockHeight,
     last_sync: Instant,
     sync_interval: Duration,
     script_history: BTreeMap<Script, Vec<GetHistoryRes>>,
-    subscriptions: HashMap<(Txid, Script), Subscription>,
+    /// Scripts we are subscribed to on the current Electrum connection.
+    subscribed_scripts: HashSet<Script>,
 }
 
-impl Client {
-    fn new(electrum: bdk::electrum_client::Client, interval: Duration) -> Result<Self> {
-        // Initially fetch the latest block for storing the height.
-        // We do not act on this subscription after this call.
+impl Watcher {
+    fn new(pool: Arc<electrum::Pool>, interval: Duration) -> Result<Self> {
+        let electrum = pool.connect()?;
+
         let latest_block = electrum
             .block_headers_subscribe()
             .context("Failed to subscribe to header notifications")?;
 
         Ok(Self {
             electrum,
+            pool,
             latest_block_height: BlockHeight::try_from(latest_block)?,
             last_sync: Instant::now(),
             sync_interval: interval,
             script_history: Default::default(),
-            subscriptions: Default::default(),
+            subscribed_scripts: Default::default(),
         })
     }
 
-    fn update_state(&mut self) -> Result<()> {
-        let now = Instant::now();
-        if now < self.last_sync + self.sync_interval {
-            return Ok(());
+    /// Processes all pending notifications and pushes the resulting status to
+    /// all subscribers.
+    ///
+    /// If the connection to the Electrum server fails, we reconnect and replay
+    /// all subscriptions.
+    fn refresh_subscriptions(&mut self, state: &WatcherState) -> Result<()> {
+        for script in state.subscriptions().scripts() {
+            self.script_history.entry(script).or_default();
         }
 
-        self.last_sync = now;
-        self.update_latest_block()?;
-        self.update_script_histories()?;
+        if let Err(error) = self.process_notifications() {
+            tracing::warn!(
+                "Failed to process Electrum notifications, reconnecting: {:#}",
+                error
+            );
+            self.reconnect()?;
+        }
+
+        state
+            .latest_block_height
+            .store(u32::from(self.latest_block_height), Ordering::SeqCst);
+
+        let removed_scripts = state
+            .subscriptions()
+            .notify(&self.script_history, self.latest_block_height);
+
+        for script in removed_scripts {
+            self.script_history.remove(&script);
+
+            if self.subscribed_scripts.remove(&script) {
+                if let Err(error) = self.electrum.script_unsubscribe(&script) {
+                    tracing::debug!("Failed to unsubscribe from script: {:#}", error);
+                }
+            }
+        }
 
         Ok(())
     }
 
-    fn status_of_script<T>(&mut self, tx: &T) -> Result<ScriptStatus>
-    where
-        T: Watchable,
-    {
-        let txid = tx.id();
-        let script = tx.script();
+    fn process_notifications(&mut self) -> Result<()> {
+        let new_scripts = self
+            .script_history
+            .keys()
+            .filter(|script| !self.subscribed_scripts.contains(*script))
+            .cloned()
+            .collect::<Vec<_>>();
 
-        if !self.script_history.contains_key(&script) {
-            self.script_history.insert(script.clone(), vec![]);
+        let mut changed_scripts = Vec::new();
+        for script in new_scripts {
+            if self.subscribe_script(&script)? {
+                changed_scripts.push(script);
+            }
         }
 
-        self.update_state()?;
+        // Notifications are only received while the client is waiting for a response.
+        self.electrum
+            .ping()
+            .context("Failed to ping Electrum server")?;
 
-        let history = self.script_history.entry(script).or_default();
+        if Instant::now() >= self.last_sync + self.sync_interval {
+            self.last_sync = Instant::now();
 
-        let history_of_tx = history
-            .iter()
-            .filter(|entry| entry.tx_hash == txid)
-            .collect::<Vec<_>>();
+            if self.connection_was_reset()? {
+                tracing::debug!("Electrum client reconnected, replaying subscriptions");
+                return self.resubscribe_all();
+            }
+        }
 
-        match history_of_tx.as_slice() {
-            [] => Ok(ScriptStatus::Unseen),
-            [remaining @ .., last] => {
-                if !remaining.is_empty() {
-                    tracing::warn!("Found more than a single history entry for script. This is highly unexpected and those history entries will be ignored")
-                }
+        while let Some(header) = self
+            .electrum
+            .block_headers_pop()
+            .context("Failed to receive header notification")?
+        {
+            self.update_latest_block(BlockHeight::try_from(header)?);
+        }
 
-                if last.height <= 0 {
-                    Ok(ScriptStatus::InMempool)
-                } else {
-                    Ok(ScriptStatus::Confirmed(
-                        Confirmed::from_inclusion_and_latest_block(
-                            u32::try_from(last.height)?,
-                            u32::from(self.latest_block_height),
-                        ),
-                    ))
-                }
+        for script in self.subscribed_scripts.iter() {
+            let notification = self
+                .electrum
+                .script_pop(script)
+                .context("Failed to receive script notification")?;
+
+            if notification.is_some() {
+                changed_scripts.push(script.clone());
+            }
+        }
+
+        self.update_script_histories(changed_scripts)
+    }
+
+    /// Subscribes to status notifications of the given script.
+    ///
+    /// Returns whether the script has any history.
+    fn subscribe_script(&mut self, script: &Script) -> Result<bool> {
+        let has_history = match self.electrum.script_subscribe(script) {
+            Ok(status) => status.is_some(),
+            // If we are already subscribed, we don't know the status and need to assume that
+            // there is history to fetch.
+            Err(bdk::electrum_client::Error::AlreadySubscribed(_)) => true,
+            Err(error) => return Err(error).context("Failed to subscribe to script notifications"),
+        };
+
+        self.subscribed_scripts.insert(script.clone());
+
+        Ok(has_history)
+    }
+
+    /// Checks if the Electrum client silently replaced its connection.
+    ///
+    /// Subscriptions are bound to a connection, they are not carried over if
+    /// the client reconnects internally. Re-subscribing to a script we are
+    /// already subscribed to is rejected by the client, unless it is on a new
+    /// connection.
+    fn connection_was_reset(&mut self) -> Result<bool> {
+        let sentinel = match self.subscribed_scripts.iter().next() {
+            Some(script) => script.clone(),
+            None => {
+                // Without any scripts, there is nothing to lose but the header subscription.
+                let latest_block = self
+                    .electrum
+                    .block_headers_subscribe()
+                    .context("Failed to subscribe to header notifications")?;
+                self.update_latest_block(BlockHeight::try_from(latest_block)?);
+
+                return Ok(false);
             }
+        };
+
+        match self.electrum.script_subscribe(&sentinel) {
+            Err(bdk::electrum_client::Error::AlreadySubscribed(_)) => Ok(false),
+            Ok(_) => Ok(true),
+            Err(error) => Err(error).context("Failed to subscribe to script notifications"),
         }
     }
 
-    fn update_latest_block(&mut self) -> Result<()> {
-        // Fetch the latest block for storing the height.
-        // We do not act on this subscription after this call, as we cannot rely on
-        // subscription push notifications because eventually the Electrum server will
-        // close the connection and subscriptions are not automatically renewed
-        // upon renewing the connection.
+    fn reconnect(&mut self) -> Result<()> {
+        self.electrum = self
+            .pool
+            .connect()
+            .context("Failed to reconnect to Electrum server")?;
+
+        self.resubscribe_all()
+    }
+
+    /// Replays all subscriptions and fetches the complete history of every
+    /// script to reconcile with whatever happened while we were not
+    /// subscribed.
+    fn resubscribe_all(&mut self) -> Result<()> {
+        self.subscribed_scripts.clear();
+        self.last_sync = Instant::now();
+
         let latest_block = self
             .electrum
             .block_headers_subscribe()
             .context("Failed to subscribe to header notifications")?;
-        let latest_block_height = BlockHeight::try_from(latest_block)?;
+        self.update_latest_block(BlockHeight::try_from(latest_block)?);
+
+        let scripts = self.script_history.keys().cloned().collect::<Vec<_>>();
+        for script in scripts.iter() {
+            self.subscribe_script(script)?;
+        }
+
+        self.update_script_histories(scripts)
+    }
 
+    fn update_latest_block(&mut self, latest_block_height: BlockHeight) {
         if latest_block_height > self.latest_block_height {
             tracing::debug!(
                 block_height = u32::from(latest_block_height),
@@ -719,48 +1047,372 @@ impl Client {
             );
             self.latest_block_height = latest_block_height;
         }
-
-        Ok(())
     }
 
-    fn update_script_histories(&mut self) -> Result<()> {
+    fn update_script_histories(&mut self, scripts: Vec<Script>) -> Result<()> {
+        if scripts.is_empty() {
+            return Ok(());
+        }
+
         let histories = self
             .electrum
-            .batch_script_get_history(self.script_history.keys())
+            .batch_script_get_history(scripts.iter())
             .context("Failed to get script histories")?;
 
-        if histories.len() != self.script_history.len() {
+        if histories.len() != scripts.len() {
             bail!(
                 "Expected {} history entries, received {}",
-                self.script_history.len(),
+                scripts.len(),
                 histories.len()
             );
         }
 
-        let scripts = self.script_history.keys().cloned();
-        let histories = histories.into_iter();
-
-        self.script_history = scripts.zip(histories).collect::<BTreeMap<_, _>>();
+        self.script_history
+            .extend(scripts.into_iter().zip(histories));
 
         Ok(())
     }
 }
 
+fn status_from_history(
+    txid: Txid,
+    history: &[GetHistoryRes],
+    latest_block_height: BlockHeight,
+) -> Result<ScriptStatus> {
+    let history_of_tx = history
+        .iter()
+        .filter(|entry| entry.tx_hash == txid)
+        .collect::<Vec<_>>();
+
+    match history_of_tx.as_slice() {
+        [] => Ok(ScriptStatus::Unseen),
+        [remaining @ .., last] => {
+            if !remaining.is_empty() {
+                tracing::warn!("Found more than a single history entry for script. This is highly unexpected and those history entries will be ignored")
+            }
+
+            if last.height <= 0 {
+                Ok(ScriptStatus::InMempool)
+            } else {
+                Ok(ScriptStatus::Confirmed(
+                    Confirmed::from_inclusion_and_latest_block(
+                        u32::try_from(last.height)?,
+                        u32::from(latest_block_height),
+                    ),
+                ))
+            }
+        }
+    }
+}
+
+/// Keeps track of all subscriptions to watched transactions.
+///
+/// Each `(Txid, Script)` pair is only watched once, no matter how many
+/// [`Subscription`]s exist for it. Once all [`Subscription`]s of a pair are
+/// dropped, the pair is removed on the next notification round.
+#[derive(Default)]
+struct ScriptWatcher {
+    subscriptions: HashMap<(Txid, Script), WatchedScript>,
+}
+
+struct WatchedScript {
+    sender: watch::Sender<ScriptStatus>,
+    receiver: watch::Receiver<ScriptStatus>,
+    handle: Weak<()>,
+    last_status: Option<ScriptStatus>,
+}
+
+impl ScriptWatcher {
+    fn subscribe(
+        &mut self,
+        txid: Txid,
+        script: Script,
+        finality_confirmations: u32,
+    ) -> Subscription {
+        let key = (txid, script);
+
+        if let Some(watched) = self.subscriptions.get(&key) {
+            if let Some(handle) = watched.handle.upgrade() {
+                return Subscription {
+                    receiver: watched.receiver.clone(),
+                    finality_confirmations,
+                    txid,
+                    _handle: handle,
+                };
+            }
+        }
+
+        let (sender, receiver) = watch::channel(ScriptStatus::Unseen);
+        let handle = Arc::new(());
+
+        self.subscriptions.insert(key, WatchedScript {
+            sender,
+            receiver: receiver.clone(),
+            handle: Arc::downgrade(&handle),
+            last_status: None,
+        });
+
+        Subscription {
+            receiver,
+            finality_confirmations,
+            txid,
+            _handle: handle,
+        }
+    }
+
+    fn scripts(&self) -> BTreeSet<Script> {
+        self.subscriptions
+            .keys()
+            .map(|(_, script)| script.clone())
+            .collect()
+    }
+
+    /// Computes the status of every watched transaction from the given script
+    /// histories and sends it to the subscribers.
+    ///
+    /// Transactions whose script has no history yet are skipped, they have
+    /// been subscribed to after the histories were fetched.
+    ///
+    /// Returns the scripts that are no longer watched by anyone.
+    fn notify(
+        &mut self,
+        script_history: &BTreeMap<Script, Vec<GetHistoryRes>>,
+        latest_block_height: BlockHeight,
+    ) -> Vec<Script> {
+        let mut removed = Vec::new();
+
+        self.subscriptions.retain(|(txid, script), watched| {
+            if watched.handle.strong_count() == 0 {
+                tracing::debug!(%txid, "All receivers gone, removing subscription");
+                removed.push(script.clone());
+                return false;
+            }
+
+            let history = match script_history.get(script) {
+                Some(history) => history,
+                None => return true,
+            };
+
+            let new_status = match status_from_history(*txid, history, latest_block_height) {
+                Ok(new_status) => new_status,
+                Err(error) => {
+                    tracing::warn!(%txid, "Failed to get status of script: {:#}", error);
+                    return true;
+                }
+            };
+
+            watched.last_status = Some(print_status_change(*txid, watched.last_status, new_status));
+
+            // Cannot fail because we hold on to a receiver ourselves.
+            let _ = watched.sender.send(new_status);
+
+            true
+        });
+
+        // A script might be shared by several transactions, only stop watching it if
+        // none of them is still subscribed.
+        removed.retain(|script| {
+            !self
+                .subscriptions
+                .keys()
+                .any(|(_, watched_script)| watched_script == script)
+        });
+
+        removed
+    }
+}
+
+/// Serves fee estimates from the [`FeeCache`], only asking the Electrum server
+/// for a confirmation target we haven't seen before.
+#[async_trait]
 impl EstimateFeeRate for Client {
-    fn estimate_feerate(&self, target_block: usize) -> Result<FeeRate> {
-        // https://github.com/romanz/electrs/blob/f9cf5386d1b5de6769ee271df5eef324aa9491bc/src/rpc.rs#L213
-        // Returned estimated fees are per BTC/kb.
-        let fee_per_byte = self.electrum.estimate_fee(target_block)?;
-        // we do not expect fees being that high.
-        #[allow(clippy::cast_possible_truncation)]
-        Ok(FeeRate::from_btc_per_kvb(fee_per_byte as f32))
+    async fn estimate_feerate(&self, target_block: usize) -> Result<FeeRate> {
+        let latest_block_height = self.state.latest_block_height();
+
+        let cached = self
+            .fees
+            .fee_rate(target_block, latest_block_height, Instant::now());
+        if let Some(fee_rate) = cached {
+            return Ok(fee_rate);
+        }
+
+        let fee_rate = fetch_fee_rate(&self.electrum, target_block).await?;
+        self.fees
+            .insert_fee_rate(target_block, fee_rate, latest_block_height);
+
+        Ok(fee_rate)
     }
 
-    fn min_relay_fee(&self) -> Result<bitcoin::Amount> {
-        // https://github.com/romanz/electrs/blob/f9cf5386d1b5de6769ee271df5eef324aa9491bc/src/rpc.rs#L219
-        // Returned fee is in BTC/kb
-        let relay_fee = bitcoin::Amount::from_btc(self.electrum.relay_fee()?)?;
-        Ok(relay_fee)
+    async fn min_relay_fee(&self) -> Result<bitcoin::Amount> {
+        let latest_block_height = self.state.latest_block_height();
+
+        let cached = self.fees.min_relay_fee(latest_block_height, Instant::now());
+        if let Some(min_relay_fee) = cached {
+            return Ok(min_relay_fee);
+        }
+
+        let min_relay_fee = fetch_min_relay_fee(&self.electrum).await?;
+        self.fees
+            .insert_min_relay_fee(min_relay_fee, latest_block_height);
+
+        Ok(min_relay_fee)
+    }
+}
+
+async fn fetch_fee_rate(electrum: &electrum::Pool, target_block: usize) -> Result<FeeRate> {
+    // https://github.com/romanz/electrs/blob/f9cf5386d1b5de6769ee271df5eef324aa9491bc/src/rpc.rs#L213
+    // Returned estimated fees are per BTC/kb.
+    let fee_per_byte = electrum
+        .call(move |electrum| electrum.estimate_fee(target_block))
+        .await?;
+    // we do not expect fees being that high.
+    #[allow(clippy::cast_possible_truncation)]
+    Ok(FeeRate::from_btc_per_kvb(fee_per_byte as f32))
+}
+
+async fn fetch_min_relay_fee(electrum: &electrum::Pool) -> Result<bitcoin::Amount> {
+    // https://github.com/romanz/electrs/blob/f9cf5386d1b5de6769ee271df5eef324aa9491bc/src/rpc.rs#L219
+    // Returned fee is in BTC/kb
+    let relay_fee = electrum.call(|electrum| electrum.relay_fee()).await?;
+    let relay_fee = bitcoin::Amount::from_btc(relay_fee)?;
+    Ok(relay_fee)
+}
+
+/// Re-fetches all cached fee estimates once they are stale, i.e. with every
+/// new block.
+///
+/// Callers are thereby served from memory, even right after a block was found.
+/// The task stops once the wallet has been dropped.
+async fn refresh_fees(
+    fees: Weak<FeeCache>,
+    electrum: Arc<electrum::Pool>,
+    state: Arc<WatcherState>,
+) {
+    let mut interval = tokio::time::interval(NOTIFICATION_POLL_INTERVAL);
+
+    loop {
+        interval.tick().await;
+
+        let fees = match fees.upgrade() {
+            Some(fees) => fees,
+            None => return,
+        };
+
+        let latest_block_height = state.latest_block_height();
+        let now = Instant::now();
+
+        for target_block in fees.stale_targets(latest_block_height, now) {
+            match fetch_fee_rate(&electrum, target_block).await {
+                Ok(fee_rate) => fees.insert_fee_rate(target_block, fee_rate, latest_block_height),
+                Err(error) => {
+                    tracing::debug!(%target_block, "Failed to refresh fee estimate: {:#}", error)
+                }
+            }
+        }
+
+        if fees.min_relay_fee_is_stale(latest_block_height, now) {
+            match fetch_min_relay_fee(&electrum).await {
+                Ok(min_relay_fee) => fees.insert_min_relay_fee(min_relay_fee, latest_block_height),
+                Err(error) => tracing::debug!("Failed to refresh min relay fee: {:#}", error),
+            }
+        }
+    }
+}
+
+/// Fee estimates of the Electrum server for the current block.
+///
+/// An entry is stale once a new block arrives or it exceeds [`FEE_CACHE_TTL`].
+/// Stale entries are not handed out, see [`refresh_fees`] for how they are
+/// replaced.
+#[derive(Default)]
+struct FeeCache {
+    entries: std::sync::Mutex<FeeCacheEntries>,
+}
+
+#[derive(Default)]
+struct FeeCacheEntries {
+    fee_rates: HashMap<usize, Cached<FeeRate>>,
+    min_relay_fee: Option<Cached<bitcoin::Amount>>,
+}
+
+#[derive(Debug, Clone, Copy)]
+struct Cached<T> {
+    value: T,
+    block_height: BlockHeight,
+    fetched_at: Instant,
+}
+
+impl<T: Copy> Cached<T> {
+    fn new(value: T, block_height: BlockHeight) -> Self {
+        Self {
+            value,
+            block_height,
+            fetched_at: Instant::now(),
+        }
+    }
+
+    fn get(&self, latest_block_height: BlockHeight, now: Instant) -> Option<T> {
+        if self.block_height != latest_block_height || now >= self.fetched_at + FEE_CACHE_TTL {
+            return None;
+        }
+
+        Some(self.value)
+    }
+}
+
+impl FeeCache {
+    fn fee_rate(
+        &self,
+        target_block: usize,
+        latest_block_height: BlockHeight,
+        now: Instant,
+    ) -> Option<FeeRate> {
+        self.entries()
+            .fee_rates
+            .get(&target_block)
+            .and_then(|cached| cached.get(latest_block_height, now))
+    }
+
+    fn insert_fee_rate(&self, target_block: usize, fee_rate: FeeRate, block_height: BlockHeight) {
+        self.entries()
+            .fee_rates
+            .insert(target_block, Cached::new(fee_rate, block_height));
+    }
+
+    fn min_relay_fee(
+        &self,
+        latest_block_height: BlockHeight,
+        now: Instant,
+    ) -> Option<bitcoin::Amount> {
+        self.entries()
+            .min_relay_fee
+            .and_then(|cached| cached.get(latest_block_height, now))
+    }
+
+    fn insert_min_relay_fee(&self, min_relay_fee: bitcoin::Amount, block_height: BlockHeight) {
+        self.entries().min_relay_fee = Some(Cached::new(min_relay_fee, block_height));
+    }
+
+    /// Confirmation targets that have been asked for before and need to be
+    /// refreshed.
+    fn stale_targets(&self, latest_block_height: BlockHeight, now: Instant) -> Vec<usize> {
+        self.entries()
+            .fee_rates
+            .iter()
+            .filter(|(_, cached)| cached.get(latest_block_height, now).is_none())
+            .map(|(target_block, _)| *target_block)
+            .collect()
+    }
+
+    /// Only true if the min relay fee has been asked for before.
+    fn min_relay_fee_is_stale(&self, latest_block_height: BlockHeight, now: Instant) -> bool {
+        self.entries().min_relay_fee.map_or(false, |cached| {
+            cached.get(latest_block_height, now).is_none()
+        })
+    }
+
+    fn entries(&self) -> MutexGuard<'_, FeeCacheEntries> {
+        self.entries.lock().unwrap_or_else(PoisonError::into_inner)
     }
 }
 
@@ -1162,6 +1814,80 @@ DEBUG swap::bitcoin::wallet: Bitcoin transaction status changed txid=00000000000
         )
     }
 
+    #[test]
+    fn subscriptions_to_the_same_transaction_share_a_single_watched_script() {
+        let mut watcher = ScriptWatcher::default();
+        let txid = Txid::default();
+        let script = Script::new();
+
+        let first = watcher.subscribe(txid, script.clone(), 1);
+        let second = watcher.subscribe(txid, script.clone(), 1);
+        assert_eq!(watcher.subscriptions.len(), 1);
+
+        let histories = vec![(script, vec![GetHistoryRes {
+            height: 10,
+            tx_hash: txid,
+            fee: None,
+        }])]
+        .into_iter()
+        .collect();
+        let removed = watcher.notify(&histories, BlockHeight::new(11));
+
+        assert!(removed.is_empty());
+        assert_eq!(*first.receiver.borrow(), confs(2));
+        assert_eq!(*second.receiver.borrow(), confs(2));
+    }
+
+    #[test]
+    fn watched_script_is_removed_once_all_subscriptions_are_dropped() {
+        let mut watcher = ScriptWatcher::default();
+        let txid = Txid::default();
+        let script = Script::new();
+
+        let first = watcher.subscribe(txid, script.clone(), 1);
+        let second = watcher.subscribe(txid, script.clone(), 1);
+        drop(first);
+
+        let removed = watcher.notify(&BTreeMap::new(), BlockHeight::new(1));
+        assert!(removed.is_empty());
+        assert_eq!(*second.receiver.borrow(), ScriptStatus::Unseen);
+
+        drop(second);
+
+        let removed = watcher.notify(&BTreeMap::new(), BlockHeight::new(1));
+        assert_eq!(removed, vec![script]);
+        assert!(watcher.subscriptions.is_empty());
+    }
+
+    #[test]
+    fn cached_fees_are_stale_after_a_new_block_or_their_ttl() {
+        let cache = FeeCache::default();
+        let fee_rate = FeeRate::from_sat_per_vb(5.0);
+        let now = Instant::now();
+
+        cache.insert_fee_rate(1, fee_rate, BlockHeight::new(100));
+        cache.insert_min_relay_fee(Amount::from_sat(1000), BlockHeight::new(100));
+
+        assert_eq!(
+            cache.fee_rate(1, BlockHeight::new(100), now),
+            Some(fee_rate)
+        );
+        assert_eq!(cache.fee_rate(2, BlockHeight::new(100), now), None);
+        assert!(cache.stale_targets(BlockHeight::new(100), now).is_empty());
+        assert!(!cache.min_relay_fee_is_stale(BlockHeight::new(100), now));
+
+        assert_eq!(cache.fee_rate(1, BlockHeight::new(101), now), None);
+        assert_eq!(cache.min_relay_fee(BlockHeight::new(101), now), None);
+        assert_eq!(cache.stale_targets(BlockHeight::new(101), now), vec![1]);
+        assert!(cache.min_relay_fee_is_stale(BlockHeight::new(101), now));
+
+        let after_ttl = Instant::now() + FEE_CACHE_TTL;
+        assert_eq!(cache.fee_rate(1, BlockHeight::new(100), after_ttl), None);
+        assert_eq!(cache.stale_targets(BlockHeight::new(100), after_ttl), vec![
+            1
+        ]);
+    }
+
     fn confs(confirmations: u32) -> ScriptStatus {
         ScriptStatus::from_confirmations(confirmations)
     }
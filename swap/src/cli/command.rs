@@ -1,3 +1,4 @@
+use crate::database::{parse_date, Format, Query, Status};
 use crate::env::GetConfig;
 use crate::fs::system_data_dir;
 use crate::network::rendezvous::XmrBtcNamespace;
@@ -76,7 +77,7 @@ where
             monero_receive_address,
             tor: Tor { tor_socks5_port },
         } => {
-            let (bitcoin_electrum_rpc_url, bitcoin_target_block) =
+            let (bitcoin_electrum_rpc_urls, bitcoin_target_block) =
                 bitcoin.apply_defaults(is_testnet)?;
             let monero_daemon_address = monero.apply_defaults(is_testnet);
             let monero_receive_address =
@@ -91,7 +92,7 @@ where
                 data_dir: data::data_dir_from(data, is_testnet)?,
                 cmd: Command::BuyXmr {
                     seller,
-                    bitcoin_electrum_rpc_url,
+                    bitcoin_electrum_rpc_urls,
                     bitcoin_target_block,
                     bitcoin_change_address,
                     monero_receive_address,
@@ -100,12 +101,28 @@ where
                 },
             }
         }
-        RawCommand::History => Arguments {
+        RawCommand::History {
+            format,
+            status,
+            since,
+            before,
+            after,
+            limit,
+        } => Arguments {
             env_config: env_config_from(is_testnet),
             debug,
             json,
             data_dir: data::data_dir_from(data, is_testnet)?,
-            cmd: Command::History,
+            cmd: Command::History {
+                query: Query {
+                    status,
+                    started_since: since,
+                    started_before: before,
+                    after,
+                    limit,
+                },
+                format,
+            },
         },
         RawCommand::Resume {
             swap_id: SwapId { swap_id },
@@ -113,7 +130,7 @@ where
             monero,
             tor: Tor { tor_socks5_port },
         } => {
-            let (bitcoin_electrum_rpc_url, bitcoin_target_block) =
+            let (bitcoin_electrum_rpc_urls, bitcoin_target_block) =
                 bitcoin.apply_defaults(is_testnet)?;
             let monero_daemon_address = monero.apply_defaults(is_testnet);
 
@@ -124,7 +141,7 @@ where
                 data_dir: data::data_dir_from(data, is_testnet)?,
                 cmd: Command::Resume {
                     swap_id,
-                    bitcoin_electrum_rpc_url,
+                    bitcoin_electrum_rpc_urls,
                     bitcoin_target_block,
                     monero_daemon_address,
                     tor_socks5_port,
@@ -136,7 +153,7 @@ where
             force,
             bitcoin,
         } => {
-            let (bitcoin_electrum_rpc_url, bitcoin_target_block) =
+            let (bitcoin_electrum_rpc_urls, bitcoin_target_block) =
                 bitcoin.apply_defaults(is_testnet)?;
 
             Arguments {
@@ -147,7 +164,7 @@ where
                 cmd: Command::Cancel {
                     swap_id,
                     force,
-                    bitcoin_electrum_rpc_url,
+                    bitcoin_electrum_rpc_urls,
                     bitcoin_target_block,
                 },
             }
@@ -157,7 +174,7 @@ where
             force,
             bitcoin,
         } => {
-            let (bitcoin_electrum_rpc_url, bitcoin_target_block) =
+            let (bitcoin_electrum_rpc_urls, bitcoin_target_block) =
                 bitcoin.apply_defaults(is_testnet)?;
 
             Arguments {
@@ -168,7 +185,7 @@ where
                 cmd: Command::Refund {
                     swap_id,
                     force,
-                    bitcoin_electrum_rpc_url,
+                    bitcoin_electrum_rpc_urls,
                     bitcoin_target_block,
                 },
             }
@@ -196,17 +213,20 @@ where
 pub enum Command {
     BuyXmr {
         seller: Multiaddr,
-        bitcoin_electrum_rpc_url: Url,
+        bitcoin_electrum_rpc_urls: Vec<Url>,
         bitcoin_target_block: usize,
         bitcoin_change_address: bitcoin::Address,
         monero_receive_address: monero::Address,
         monero_daemon_address: String,
         tor_socks5_port: u16,
     },
-    History,
+    History {
+        query: Query,
+        format: Format,
+    },
     Resume {
         swap_id: Uuid,
-        bitcoin_electrum_rpc_url: Url,
+        bitcoin_electrum_rpc_urls: Vec<Url>,
         bitcoin_target_block: usize,
         monero_daemon_address: String,
         tor_socks5_port: u16,
@@ -214,13 +234,13 @@ pub enum Command {
     Cancel {
         swap_id: Uuid,
         force: bool,
-        bitcoin_electrum_rpc_url: Url,
+        bitcoin_electrum_rpc_urls: Vec<Url>,
         bitcoin_target_block: usize,
     },
     Refund {
         swap_id: Uuid,
         force: bool,
-        bitcoin_electrum_rpc_url: Url,
+        bitcoin_electrum_rpc_urls: Vec<Url>,
         bitcoin_target_block: usize,
     },
     ListSellers {
@@ -295,7 +315,40 @@ enum RawCommand {
         tor: Tor,
     },
     /// Show a list of past, ongoing and completed swaps
-    History,
+    History {
+        #[structopt(
+            long = "format",
+            help = "Output format: table, json (one object per line) or csv",
+            default_value = "table"
+        )]
+        format: Format,
+
+        #[structopt(long = "status", help = "Only list swaps that are active or done")]
+        status: Option<Status>,
+
+        #[structopt(
+            long = "since",
+            help = "Only list swaps started on or after this date (YYYY-MM-DD, UTC)",
+            parse(try_from_str = parse_date)
+        )]
+        since: Option<u64>,
+
+        #[structopt(
+            long = "before",
+            help = "Only list swaps started before this date (YYYY-MM-DD, UTC)",
+            parse(try_from_str = parse_date)
+        )]
+        before: Option<u64>,
+
+        #[structopt(
+            long = "after",
+            help = "Continue after the swap with this id, e.g. the last swap of the previous page"
+        )]
+        after: Option<Uuid>,
+
+        #[structopt(long = "limit", help = "List at most this many swaps")]
+        limit: Option<usize>,
+    },
     /// Resume a swap
     Resume {
         #[structopt(flatten)]
@@ -368,8 +421,12 @@ impl Monero {
 
 #[derive(structopt::StructOpt, Debug)]
 struct Bitcoin {
-    #[structopt(long = "electrum-rpc", help = "Provide the Bitcoin Electrum RPC URL")]
-    bitcoin_electrum_rpc_url: Option<Url>,
+    #[structopt(
+        long = "electrum-rpc",
+        help = "Provide the Bitcoin Electrum RPC URL. Can be given multiple times to use several servers",
+        number_of_values = 1
+    )]
+    bitcoin_electrum_rpc_urls: Vec<Url>,
 
     #[structopt(
         long = "bitcoin-target-block",
@@ -379,13 +436,13 @@ struct Bitcoin {
 }
 
 impl Bitcoin {
-    fn apply_defaults(self, testnet: bool) -> Result<(Url, usize)> {
-        let bitcoin_electrum_rpc_url = if let Some(url) = self.bitcoin_electrum_rpc_url {
-            url
+    fn apply_defaults(self, testnet: bool) -> Result<(Vec<Url>, usize)> {
+        let bitcoin_electrum_rpc_urls = if !self.bitcoin_electrum_rpc_urls.is_empty() {
+            self.bitcoin_electrum_rpc_urls
         } else if testnet {
-            Url::from_str(DEFAULT_ELECTRUM_RPC_URL_TESTNET)?
+            vec![Url::from_str(DEFAULT_ELECTRUM_RPC_URL_TESTNET)?]
         } else {
-            Url::from_str(DEFAULT_ELECTRUM_RPC_URL)?
+            vec![Url::from_str(DEFAULT_ELECTRUM_RPC_URL)?]
         };
 
         let bitcoin_target_block = if let Some(target_block) = self.bitcoin_target_block {
@@ -396,7 +453,7 @@ impl Bitcoin {
             DEFAULT_BITCOIN_CONFIRMATION_TARGET
         };
 
-        Ok((bitcoin_electrum_rpc_url, bitcoin_target_block))
+        Ok((bitcoin_electrum_rpc_urls, bitcoin_target_block))
     }
 }
 
@@ -918,6 +975,38 @@ mod tests {
         );
     }
 
+    #[test]
+    fn given_multiple_electrum_rpc_urls_then_all_are_used() {
+        let raw_ars = vec![
+            BINARY_NAME,
+            "resume",
+            "--swap-id",
+            SWAP_ID,
+            "--electrum-rpc",
+            "ssl://electrum.blockstream.info:50002",
+            "--electrum-rpc",
+            "tcp://localhost:50001",
+        ];
+
+        let args = parse_args_and_apply_defaults(raw_ars).unwrap();
+        let expected_urls = vec![
+            Url::from_str("ssl://electrum.blockstream.info:50002").unwrap(),
+            Url::from_str("tcp://localhost:50001").unwrap(),
+        ];
+
+        match args {
+            ParseResult::Arguments(Arguments {
+                cmd:
+                    Command::Resume {
+                        bitcoin_electrum_rpc_urls,
+                        ..
+                    },
+                ..
+            }) => assert_eq!(bitcoin_electrum_rpc_urls, expected_urls),
+            _ => panic!("expected resume command"),
+        }
+    }
+
     #[test]
     fn only_bech32_addresses_mainnet_are_allowed() {
         let raw_ars = vec![
@@ -1026,8 +1115,10 @@ mod tests {
                 data_dir: data_dir_path_cli().join(TESTNET),
                 cmd: Command::BuyXmr {
                     seller: Multiaddr::from_str(MULTI_ADDRESS).unwrap(),
-                    bitcoin_electrum_rpc_url: Url::from_str(DEFAULT_ELECTRUM_RPC_URL_TESTNET)
-                        .unwrap(),
+                    bitcoin_electrum_rpc_urls: vec![Url::from_str(
+                        DEFAULT_ELECTRUM_RPC_URL_TESTNET,
+                    )
+                    .unwrap()],
                     bitcoin_target_block: DEFAULT_BITCOIN_CONFIRMATION_TARGET_TESTNET,
                     bitcoin_change_address: BITCOIN_TESTNET_ADDRESS.parse().unwrap(),
                     monero_receive_address: monero::Address::from_str(MONERO_STAGENET_ADDRESS)
@@ -1046,7 +1137,9 @@ mod tests {
                 data_dir: data_dir_path_cli().join(MAINNET),
                 cmd: Command::BuyXmr {
                     seller: Multiaddr::from_str(MULTI_ADDRESS).unwrap(),
-                    bitcoin_electrum_rpc_url: Url::from_str(DEFAULT_ELECTRUM_RPC_URL).unwrap(),
+                    bitcoin_electrum_rpc_urls: vec![
+                        Url::from_str(DEFAULT_ELECTRUM_RPC_URL).unwrap()
+                    ],
                     bitcoin_target_block: DEFAULT_BITCOIN_CONFIRMATION_TARGET,
                     bitcoin_change_address: BITCOIN_MAINNET_ADDRESS.parse().unwrap(),
                     monero_receive_address: monero::Address::from_str(MONERO_MAINNET_ADDRESS)
@@ -1065,8 +1158,10 @@ mod tests {
                 data_dir: data_dir_path_cli().join(TESTNET),
                 cmd: Command::Resume {
                     swap_id: Uuid::from_str(SWAP_ID).unwrap(),
-                    bitcoin_electrum_rpc_url: Url::from_str(DEFAULT_ELECTRUM_RPC_URL_TESTNET)
-                        .unwrap(),
+                    bitcoin_electrum_rpc_urls: vec![Url::from_str(
+                        DEFAULT_ELECTRUM_RPC_URL_TESTNET,
+                    )
+                    .unwrap()],
                     bitcoin_target_block: DEFAULT_BITCOIN_CONFIRMATION_TARGET_TESTNET,
                     monero_daemon_address: DEFAULT_MONERO_DAEMON_ADDRESS_STAGENET.to_string(),
                     tor_socks5_port: DEFAULT_SOCKS5_PORT,
@@ -1082,7 +1177,9 @@ mod tests {
                 data_dir: data_dir_path_cli().join(MAINNET),
                 cmd: Command::Resume {
                     swap_id: Uuid::from_str(SWAP_ID).unwrap(),
-                    bitcoin_electrum_rpc_url: Url::from_str(DEFAULT_ELECTRUM_RPC_URL).unwrap(),
+                    bitcoin_electrum_rpc_urls: vec![
+                        Url::from_str(DEFAULT_ELECTRUM_RPC_URL).unwrap()
+                    ],
                     bitcoin_target_block: DEFAULT_BITCOIN_CONFIRMATION_TARGET,
                     monero_daemon_address: DEFAULT_MONERO_DAEMON_ADDRESS.to_string(),
                     tor_socks5_port: DEFAULT_SOCKS5_PORT,
@@ -1099,8 +1196,10 @@ mod tests {
                 cmd: Command::Cancel {
                     swap_id: Uuid::from_str(SWAP_ID).unwrap(),
                     force: false,
-                    bitcoin_electrum_rpc_url: Url::from_str(DEFAULT_ELECTRUM_RPC_URL_TESTNET)
-                        .unwrap(),
+                    bitcoin_electrum_rpc_urls: vec![Url::from_str(
+                        DEFAULT_ELECTRUM_RPC_URL_TESTNET,
+                    )
+                    .unwrap()],
                     bitcoin_target_block: DEFAULT_BITCOIN_CONFIRMATION_TARGET_TESTNET,
                 },
             }
@@ -1115,7 +1214,9 @@ mod tests {
                 cmd: Command::Cancel {
                     swap_id: Uuid::from_str(SWAP_ID).unwrap(),
                     force: false,
-                    bitcoin_electrum_rpc_url: Url::from_str(DEFAULT_ELECTRUM_RPC_URL).unwrap(),
+                    bitcoin_electrum_rpc_urls: vec![
+                        Url::from_str(DEFAULT_ELECTRUM_RPC_URL).unwrap()
+                    ],
                     bitcoin_target_block: DEFAULT_BITCOIN_CONFIRMATION_TARGET,
                 },
             }
@@ -1130,8 +1231,10 @@ mod tests {
                 cmd: Command::Refund {
                     swap_id: Uuid::from_str(SWAP_ID).unwrap(),
                     force: false,
-                    bitcoin_electrum_rpc_url: Url::from_str(DEFAULT_ELECTRUM_RPC_URL_TESTNET)
-                        .unwrap(),
+                    bitcoin_electrum_rpc_urls: vec![Url::from_str(
+                        DEFAULT_ELECTRUM_RPC_URL_TESTNET,
+                    )
+                    .unwrap()],
                     bitcoin_target_block: DEFAULT_BITCOIN_CONFIRMATION_TARGET_TESTNET,
                 },
             }
@@ -1146,7 +1249,9 @@ mod tests {
                 cmd: Command::Refund {
                     swap_id: Uuid::from_str(SWAP_ID).unwrap(),
                     force: false,
-                    bitcoin_electrum_rpc_url: Url::from_str(DEFAULT_ELECTRUM_RPC_URL).unwrap(),
+                    bitcoin_electrum_rpc_urls: vec![
+                        Url::from_str(DEFAULT_ELECTRUM_RPC_URL).unwrap()
+                    ],
                     bitcoin_target_block: DEFAULT_BITCOIN_CONFIRMATION_TARGET,
                 },
             }
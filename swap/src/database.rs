@@ -1,18 +1,46 @@
 pub use alice::Alice;
+pub use archive::{ArchiveReader, ArchivedSwap};
 pub use bob::Bob;
-
+pub use history::{export_history, parse_date, Format, HistoryRecord, Query};
+pub use index::{Role, Status};
+pub use journal::JournalEntry;
+pub use reservations::Reservations;
+
+use crate::database::archive::{archived_swap_ids, ArchiveWriter};
+use crate::database::compaction::Compaction;
+use crate::database::group_commit::GroupCommit;
+use crate::database::index::IndexKey;
+use crate::database::journal::JournalKey;
 use anyhow::{anyhow, bail, Context, Result};
-use itertools::Itertools;
 use libp2p::{Multiaddr, PeerId};
 use serde::de::DeserializeOwned;
 use serde::{Deserialize, Serialize};
+use sled::transaction::{ConflictableTransactionError, TransactionError};
+use sled::Transactional;
+use std::convert::TryFrom;
 use std::fmt::Display;
 use std::path::Path;
 use std::str::FromStr;
+use std::sync::Arc;
+use std::time::{Duration, SystemTime, UNIX_EPOCH};
 use uuid::Uuid;
 
 mod alice;
+mod archive;
 mod bob;
+mod compaction;
+mod group_commit;
+mod history;
+mod index;
+mod journal;
+mod reservations;
+
+/// Writes arriving within this window are made durable by the same flush.
+const COMMIT_WINDOW: Duration = Duration::from_millis(2);
+
+/// Key in the default tree that is set once the swap index covers all swaps.
+const SWAP_INDEX_VERSION_KEY: &[u8] = b"swap_index_version";
+const SWAP_INDEX_VERSION: u8 = 1;
 
 #[derive(Clone, Debug, Deserialize, Serialize, PartialEq)]
 pub enum Swap {
@@ -70,12 +98,24 @@ pub struct Database {
     peers: sled::Tree,
     addresses: sled::Tree,
     monero_addresses: sled::Tree,
+    /// [`IndexKey`]s of all swaps.
+    swap_index: sled::Tree,
+    /// The current [`IndexKey`] of each swap, by swap id.
+    swap_index_keys: sled::Tree,
+    /// Every state transition of every swap, by [`JournalKey`].
+    journal: sled::Tree,
+    reservations: Reservations,
+    group_commit: Arc<GroupCommit>,
 }
 
 impl Database {
     pub fn open(path: &Path) -> Result<Self> {
         tracing::debug!("Opening database at {}", path.display());
 
+        Compaction::new(path)
+            .recover()
+            .context("Failed to recover from an interrupted compaction")?;
+
         let db =
             sled::open(path).with_context(|| format!("Could not open the DB at {:?}", path))?;
 
@@ -83,13 +123,37 @@ impl Database {
         let peers = db.open_tree("peers")?;
         let addresses = db.open_tree("addresses")?;
         let monero_addresses = db.open_tree("monero_addresses")?;
+        let swap_index = db.open_tree("swap_index")?;
+        let swap_index_keys = db.open_tree("swap_index_keys")?;
+        let journal = db.open_tree("journal")?;
+
+        build_swap_index(&db, &swaps, &swap_index, &swap_index_keys)
+            .context("Failed to build swap index")?;
 
-        Ok(Database {
+        let db = Database {
             swaps,
             peers,
             addresses,
             monero_addresses,
-        })
+            swap_index,
+            swap_index_keys,
+            journal,
+            reservations: Reservations::default(),
+            group_commit: Arc::new(GroupCommit::new(db, COMMIT_WINDOW)),
+        };
+
+        // Swaps that cannot be read cannot be resumed either, hence they do not
+        // hold on to any Monero.
+        for (swap_id, swap) in db.indexed_swaps(Status::Active, Role::Alice).flatten() {
+            db.reservations.update(swap_id, &swap);
+        }
+
+        Ok(db)
+    }
+
+    /// The Monero reserved for swaps that have not locked it yet.
+    pub fn reservations(&self) -> &Reservations {
+        &self.reservations
     }
 
     pub async fn insert_peer_id(&self, swap_id: Uuid, peer_id: PeerId) -> Result<()> {
@@ -100,11 +164,7 @@ impl Database {
 
         self.peers.insert(key, value)?;
 
-        self.peers
-            .flush_async()
-            .await
-            .map(|_| ())
-            .context("Could not flush db")
+        self.group_commit.commit().await
     }
 
     pub fn get_peer_id(&self, swap_id: Uuid) -> Result<PeerId> {
@@ -129,11 +189,7 @@ impl Database {
 
         self.monero_addresses.insert(key, value)?;
 
-        self.monero_addresses
-            .flush_async()
-            .await
-            .map(|_| ())
-            .context("Could not flush db")
+        self.group_commit.commit().await
     }
 
     pub fn get_monero_address(&self, swap_id: Uuid) -> Result<monero::Address> {
@@ -174,11 +230,7 @@ impl Database {
         self.addresses
             .compare_and_swap(key, existing_addresses, new_addresses)??;
 
-        self.addresses
-            .flush_async()
-            .await
-            .map(|_| ())
-            .context("Could not flush db")
+        self.group_commit.commit().await
     }
 
     pub fn get_addresses(&self, peer_id: PeerId) -> Result<Vec<Multiaddr>> {
@@ -192,22 +244,48 @@ impl Database {
         Ok(addresses)
     }
 
+    /// Stores the state of a swap, moves it to the matching position in the
+    /// swap index and appends the transition to the journal, all in one
+    /// transaction.
     pub async fn insert_latest_state(&self, swap_id: Uuid, state: Swap) -> Result<()> {
         let key = serialize(&swap_id)?;
         let new_value = serialize(&state).context("Could not serialize new state value")?;
+        let now = unix_timestamp();
+        let journal_entry = serialize(&JournalEntry::new(&state, journal::now_millis()))?;
+        // The states of a swap are written one after another, no other entry
+        // can be appended in between.
+        let journal_key = self.next_journal_key(swap_id)?.to_bytes();
+
+        (
+            &self.swaps,
+            &self.swap_index,
+            &self.swap_index_keys,
+            &self.journal,
+        )
+            .transaction(|(swaps, swap_index, swap_index_keys, journal)| {
+                let old_index_key = swap_index_keys.get(swap_id.as_bytes())?;
+                let started_at = old_index_key
+                    .as_ref()
+                    .and_then(|key| IndexKey::from_bytes(key).ok())
+                    .map_or(now, |key| key.started_at);
+                let index_key = IndexKey::new(&state, started_at, swap_id).to_bytes();
+
+                if let Some(old_index_key) = old_index_key {
+                    swap_index.remove(old_index_key)?;
+                }
+                swap_index.insert(&index_key[..], Vec::<u8>::new())?;
+                swap_index_keys.insert(&swap_id.as_bytes()[..], &index_key[..])?;
+                swaps.insert(key.as_slice(), new_value.as_slice())?;
 
-        let old_value = self.swaps.get(&key)?;
+                journal.insert(&journal_key[..], journal_entry.as_slice())?;
 
-        self.swaps
-            .compare_and_swap(key, old_value, Some(new_value))
-            .context("Could not write in the DB")?
-            .context("Stored swap somehow changed, aborting saving")?;
+                Ok::<_, ConflictableTransactionError>(())
+            })
+            .map_err(|error: TransactionError| anyhow!("Could not write in the DB: {:?}", error))?;
 
-        self.swaps
-            .flush_async()
-            .await
-            .map(|_| ())
-            .context("Could not flush db")
+        self.reservations.update(swap_id, &state);
+
+        self.group_commit.commit().await
     }
 
     pub fn get_state(&self, swap_id: Uuid) -> Result<Swap> {
@@ -255,13 +333,291 @@ impl Database {
         })
     }
 
+    /// Swaps of the given status and role in the order they were started,
+    /// without reading any other swaps.
+    fn indexed_swaps(
+        &self,
+        status: Status,
+        role: Role,
+    ) -> impl Iterator<Item = Result<(Uuid, Swap)>> + '_ {
+        self.swap_index
+            .scan_prefix(IndexKey::prefix(status, role))
+            .map(move |item| {
+                let (key, _) = item.context("Failed to retrieve swap index from DB")?;
+                let swap_id = IndexKey::from_bytes(&key)?.swap_id;
+
+                Ok((swap_id, self.get_state(swap_id)?))
+            })
+    }
+
+    fn next_journal_key(&self, swap_id: Uuid) -> Result<JournalKey> {
+        let seq = match self
+            .journal
+            .scan_prefix(swap_id.as_bytes())
+            .keys()
+            .next_back()
+        {
+            Some(key) => JournalKey::from_bytes(&key?)?.seq + 1,
+            None => 0,
+        };
+
+        Ok(JournalKey { swap_id, seq })
+    }
+
+    /// The state transitions of a swap, oldest first.
+    pub fn journal(&self, swap_id: Uuid) -> Result<Vec<JournalEntry>> {
+        self.journal
+            .scan_prefix(swap_id.as_bytes())
+            .values()
+            .map(|item| {
+                let entry = item.context("Failed to retrieve journal entry from DB")?;
+                deserialize(&entry)
+            })
+            .collect()
+    }
+
+    /// The state transitions of all swaps, one swap at a time.
+    pub fn journals(&self) -> impl Iterator<Item = Result<(Uuid, Vec<JournalEntry>)>> + '_ {
+        self.swap_index_keys.iter().keys().map(move |item| {
+            let key = item.context("Failed to retrieve swap index from DB")?;
+            let swap_id = Uuid::from_slice(&key)?;
+
+            Ok((swap_id, self.journal(swap_id)?))
+        })
+    }
+
+    /// Moves the swaps that finished more than `older_than` ago from the
+    /// database to the archive at `archive_path`.
+    ///
+    /// Swaps are only removed from the database once the archive is on disk,
+    /// swaps that are in the archive already are not added again.
+    /// Returns the number of archived swaps.
+    pub async fn archive_finished_swaps(
+        &self,
+        archive_path: &Path,
+        older_than: Duration,
+    ) -> Result<usize> {
+        let now = journal::now_millis();
+        let older_than = u64::try_from(older_than.as_millis()).unwrap_or(u64::MAX);
+
+        let mut finished = Vec::new();
+        for role in [Role::Alice, Role::Bob].iter() {
+            for item in self
+                .swap_index
+                .scan_prefix(IndexKey::prefix(Status::Done, *role))
+            {
+                let (key, _) = item.context("Failed to retrieve swap index from DB")?;
+                let index_key = IndexKey::from_bytes(&key)?;
+
+                let finished_at = match self.journal(index_key.swap_id)?.last() {
+                    Some(entry) => entry.timestamp,
+                    None => index_key.started_at.saturating_mul(1000),
+                };
+                if finished_at.saturating_add(older_than) <= now {
+                    finished.push(index_key.swap_id);
+                }
+            }
+        }
+
+        if finished.is_empty() {
+            return Ok(0);
+        }
+
+        let mut archive = ArchiveWriter::append_to(archive_path)?;
+        // An earlier run may have stopped after archiving swaps but before
+        // removing them here.
+        let already_archived = archived_swap_ids(archive_path)?;
+        for swap_id in finished.iter().copied() {
+            if !already_archived.contains(&swap_id) {
+                archive.write(&self.archived_swap(swap_id)?)?;
+            }
+        }
+        archive.finish()?;
+
+        for swap_id in finished.iter().copied() {
+            self.remove_swap(swap_id)?;
+        }
+        self.group_commit.commit().await?;
+
+        Ok(finished.len())
+    }
+
+    fn archived_swap(&self, swap_id: Uuid) -> Result<ArchivedSwap> {
+        Ok(ArchivedSwap {
+            swap_id,
+            state: self.get_state(swap_id)?,
+            peer_id: self.stored_peer_id(swap_id)?,
+            monero_address: self
+                .monero_addresses
+                .get(swap_id.as_bytes())?
+                .map(|address| deserialize(&address))
+                .transpose()?,
+            journal: self.journal(swap_id)?,
+        })
+    }
+
+    /// Exports the swaps of `role` that match `query`, reading one swap at a
+    /// time.
+    ///
+    /// Active swaps come before finished ones, each in the order they were
+    /// started.
+    pub fn history(
+        &self,
+        role: Role,
+        query: &Query,
+    ) -> Result<impl Iterator<Item = Result<HistoryRecord>> + '_> {
+        let cursor = match query.after {
+            Some(swap_id) => Some(
+                self.swap_index_keys
+                    .get(swap_id.as_bytes())?
+                    .with_context(|| format!("Swap {} not found in database", swap_id))?,
+            ),
+            None => None,
+        };
+        let ranges = history::key_ranges(role, query, cursor.as_deref());
+
+        let records = ranges
+            .into_iter()
+            .flat_map(move |range| self.swap_index.range(range).keys())
+            .map(move |key| {
+                let key = key.context("Failed to retrieve swap index from DB")?;
+                let index_key = IndexKey::from_bytes(&key)?;
+                let swap_id = index_key.swap_id;
+
+                Ok(HistoryRecord::new(
+                    swap_id,
+                    index_key.started_at,
+                    &self.get_state(swap_id)?,
+                    self.journal(swap_id)?,
+                    self.stored_peer_id(swap_id)?,
+                ))
+            })
+            .take(query.limit.unwrap_or(usize::MAX));
+
+        Ok(records)
+    }
+
+    /// The peer id of a swap as it was stored, without parsing it.
+    fn stored_peer_id(&self, swap_id: Uuid) -> Result<Option<String>> {
+        self.peers
+            .get(serialize(&swap_id)?)?
+            .map(|peer_id| deserialize(&peer_id))
+            .transpose()
+    }
+
+    /// Removes a swap and everything stored about it.
+    fn remove_swap(&self, swap_id: Uuid) -> Result<()> {
+        let key = serialize(&swap_id)?;
+        let journal_keys = self
+            .journal
+            .scan_prefix(swap_id.as_bytes())
+            .keys()
+            .collect::<Result<Vec<_>, _>>()?;
+
+        (
+            &self.swaps,
+            &self.swap_index,
+            &self.swap_index_keys,
+            &self.journal,
+            &self.peers,
+            &self.monero_addresses,
+        )
+            .transaction(
+                |(swaps, swap_index, swap_index_keys, journal, peers, monero_addresses)| {
+                    if let Some(index_key) = swap_index_keys.remove(&swap_id.as_bytes()[..])? {
+                        swap_index.remove(index_key)?;
+                    }
+                    for journal_key in journal_keys.iter() {
+                        journal.remove(journal_key.clone())?;
+                    }
+                    swaps.remove(key.as_slice())?;
+                    peers.remove(key.as_slice())?;
+                    monero_addresses.remove(&swap_id.as_bytes()[..])?;
+
+                    Ok::<_, ConflictableTransactionError>(())
+                },
+            )
+            .map_err(|error: TransactionError| {
+                anyhow!("Could not remove swap from the DB: {:?}", error)
+            })
+    }
+
+    /// Copies the database into a new one at the same location, which gives
+    /// back the space left behind by removed swaps.
+    ///
+    /// Nothing else may use the database at `path` meanwhile. If the process
+    /// dies halfway, [`Database::open`] finishes or rolls back the compaction.
+    pub fn compact(self, path: &Path) -> Result<()> {
+        let compaction = Compaction::new(path);
+        let compacted_path = compaction.prepare()?;
+
+        {
+            let compacted = sled::open(compacted_path)
+                .with_context(|| format!("Could not open {}", compacted_path.display()))?;
+            compacted.import(self.group_commit.db().export());
+            compacted.flush()?;
+        }
+        drop(self);
+
+        compaction.finish()
+    }
+
     pub fn unfinished_alice(&self) -> Result<Vec<(Uuid, Alice)>> {
-        self.all_alice_iter()
-            .filter_ok(|(_swap_id, alice)| !matches!(alice, Alice::Done(_)))
+        self.indexed_swaps(Status::Active, Role::Alice)
+            .map(|item| {
+                let (swap_id, swap) = item?;
+                Ok((swap_id, swap.try_into_alice()?))
+            })
             .collect()
     }
 }
 
+/// Adds all swaps to the swap index, unless this was done before.
+///
+/// Databases created before the index existed are migrated this way when they
+/// are opened for the first time.
+fn build_swap_index(
+    db: &sled::Db,
+    swaps: &sled::Tree,
+    swap_index: &sled::Tree,
+    swap_index_keys: &sled::Tree,
+) -> Result<()> {
+    if db.get(SWAP_INDEX_VERSION_KEY)?.is_some() {
+        return Ok(());
+    }
+
+    tracing::debug!("Building swap index");
+
+    for item in swaps.iter() {
+        let (key, value) = item.context("Failed to retrieve swap from DB")?;
+        let swap_id = deserialize::<Uuid>(&key)?;
+        let swap = match deserialize::<Swap>(&value) {
+            Ok(swap) => swap,
+            Err(error) => {
+                tracing::warn!(%swap_id, "Swap cannot be read and is left out of the swap index: {:#}", error);
+                continue;
+            }
+        };
+
+        // When the swaps were started is unknown, they sort before all swaps
+        // that are stored from now on.
+        let index_key = IndexKey::new(&swap, 0, swap_id).to_bytes();
+        swap_index.insert(&index_key[..], Vec::<u8>::new())?;
+        swap_index_keys.insert(&swap_id.as_bytes()[..], &index_key[..])?;
+    }
+
+    db.insert(SWAP_INDEX_VERSION_KEY, &[SWAP_INDEX_VERSION][..])?;
+    db.flush()?;
+
+    Ok(())
+}
+
+fn unix_timestamp() -> u64 {
+    SystemTime::now()
+        .duration_since(UNIX_EPOCH)
+        .map_or(0, |elapsed| elapsed.as_secs())
+}
+
 pub fn serialize<T>(t: &T) -> Result<Vec<u8>>
 where
     T: Serialize,
@@ -474,4 +830,243 @@ mod tests {
 
         Ok(())
     }
+
+    #[tokio::test]
+    async fn finished_swap_releases_its_reservation() -> Result<()> {
+        let db_dir = tempfile::tempdir()?;
+        let db = Database::open(db_dir.path())?;
+        let swap_id = Uuid::new_v4();
+
+        db.reservations()
+            .reserve(swap_id, crate::monero::Amount::from_piconero(1_000));
+        db.insert_latest_state(
+            swap_id,
+            Swap::Alice(Alice::Done(AliceEndState::SafelyAborted)),
+        )
+        .await?;
+
+        assert_eq!(db.reservations().reserved(), crate::monero::Amount::ZERO);
+
+        Ok(())
+    }
+
+    #[tokio::test]
+    async fn finished_swaps_move_to_done_in_index() -> Result<()> {
+        let db_dir = tempfile::tempdir()?;
+        let db = Database::open(db_dir.path())?;
+        let swap_id = Uuid::new_v4();
+
+        db.insert_latest_state(swap_id, bob_started()).await?;
+        let active = db
+            .indexed_swaps(Status::Active, Role::Bob)
+            .collect::<Result<Vec<_>>>()?;
+        assert_eq!(active, vec![(swap_id, bob_started())]);
+
+        let done = Swap::Bob(Bob::Done(BobEndState::SafelyAborted));
+        db.insert_latest_state(swap_id, done.clone()).await?;
+
+        assert_eq!(db.indexed_swaps(Status::Active, Role::Bob).count(), 0);
+        let done_swaps = db
+            .indexed_swaps(Status::Done, Role::Bob)
+            .collect::<Result<Vec<_>>>()?;
+        assert_eq!(done_swaps, vec![(swap_id, done)]);
+
+        Ok(())
+    }
+
+    #[tokio::test]
+    async fn swaps_stored_before_the_index_are_migrated() -> Result<()> {
+        let db_dir = tempfile::tempdir()?;
+        let active_id = Uuid::new_v4();
+        let done_id = Uuid::new_v4();
+        {
+            let db = sled::open(db_dir.path())?;
+            let swaps = db.open_tree("swaps")?;
+            swaps.insert(serialize(&active_id)?, serialize(&bob_started())?)?;
+            swaps.insert(
+                serialize(&done_id)?,
+                serialize(&Swap::Alice(Alice::Done(AliceEndState::BtcRedeemed)))?,
+            )?;
+            db.flush()?;
+        }
+
+        let db = Database::open(db_dir.path())?;
+
+        let active = db
+            .indexed_swaps(Status::Active, Role::Bob)
+            .collect::<Result<Vec<_>>>()?;
+        assert_eq!(active, vec![(active_id, bob_started())]);
+        assert!(db.unfinished_alice()?.is_empty());
+        assert_eq!(db.indexed_swaps(Status::Done, Role::Alice).count(), 1);
+
+        Ok(())
+    }
+
+    #[tokio::test]
+    async fn journal_records_every_transition_in_order() -> Result<()> {
+        let db_dir = tempfile::tempdir()?;
+        let db = Database::open(db_dir.path())?;
+        let swap_id = Uuid::new_v4();
+        let other_swap_id = Uuid::new_v4();
+
+        db.insert_latest_state(swap_id, bob_started()).await?;
+        db.insert_latest_state(other_swap_id, bob_started()).await?;
+        db.insert_latest_state(swap_id, Swap::Bob(Bob::Done(BobEndState::SafelyAborted)))
+            .await?;
+
+        let journal = db.journal(swap_id)?;
+        let tags = journal
+            .iter()
+            .map(|entry| entry.tag.as_str())
+            .collect::<Vec<_>>();
+        assert_eq!(tags, vec!["Started", "Done(SafelyAborted)"]);
+        assert!(journal[0].timestamp <= journal[1].timestamp);
+        assert_eq!(db.journals().count(), 2);
+
+        Ok(())
+    }
+
+    #[tokio::test]
+    async fn finished_swaps_are_moved_to_the_archive() -> Result<()> {
+        let db_dir = tempfile::tempdir()?;
+        let db_path = db_dir.path().join("database");
+        let archive_path = db_dir.path().join("archive");
+        let db = Database::open(&db_path)?;
+        let active_id = Uuid::new_v4();
+        let done_id = Uuid::new_v4();
+        let done = Swap::Bob(Bob::Done(BobEndState::SafelyAborted));
+
+        db.insert_latest_state(active_id, bob_started()).await?;
+        db.insert_latest_state(done_id, bob_started()).await?;
+        db.insert_latest_state(done_id, done.clone()).await?;
+
+        let archived = db
+            .archive_finished_swaps(&archive_path, Duration::from_secs(3600))
+            .await?;
+        assert_eq!(archived, 0);
+
+        let archived = db
+            .archive_finished_swaps(&archive_path, Duration::ZERO)
+            .await?;
+        assert_eq!(archived, 1);
+        assert!(db.get_state(done_id).is_err());
+        assert!(db.journal(done_id)?.is_empty());
+
+        let archive = ArchiveReader::open(&archive_path)?.collect::<Result<Vec<_>>>()?;
+        assert_eq!(archive.len(), 1);
+        assert_eq!(archive[0].swap_id, done_id);
+        assert_eq!(archive[0].state, done);
+        assert_eq!(archive[0].journal.len(), 2);
+
+        db.compact(&db_path)?;
+        let db = Database::open(&db_path)?;
+        assert_eq!(db.get_state(active_id)?, bob_started());
+        assert!(db.get_state(done_id).is_err());
+
+        Ok(())
+    }
+
+    #[tokio::test]
+    async fn swaps_archived_before_a_crash_are_not_archived_again() -> Result<()> {
+        let db_dir = tempfile::tempdir()?;
+        let archive_path = db_dir.path().join("archive");
+        let db = Database::open(&db_dir.path().join("database"))?;
+        let first_id = Uuid::new_v4();
+        let second_id = Uuid::new_v4();
+        let done = Swap::Bob(Bob::Done(BobEndState::SafelyAborted));
+
+        for swap_id in [first_id, second_id].iter().copied() {
+            db.insert_latest_state(swap_id, bob_started()).await?;
+            db.insert_latest_state(swap_id, done.clone()).await?;
+        }
+
+        // Crashed after archiving the first swap, before removing it.
+        let mut archive = ArchiveWriter::append_to(&archive_path)?;
+        archive.write(&db.archived_swap(first_id)?)?;
+        archive.finish()?;
+
+        let archived = db
+            .archive_finished_swaps(&archive_path, Duration::ZERO)
+            .await?;
+        assert_eq!(archived, 2);
+        assert!(db.get_state(first_id).is_err());
+        assert!(db.get_state(second_id).is_err());
+
+        let mut archived_ids = ArchiveReader::open(&archive_path)?
+            .map(|swap| swap.map(|swap| swap.swap_id))
+            .collect::<Result<Vec<_>>>()?;
+        archived_ids.sort();
+        let mut expected = vec![first_id, second_id];
+        expected.sort();
+        assert_eq!(archived_ids, expected);
+
+        Ok(())
+    }
+
+    #[tokio::test]
+    async fn history_is_paged_with_a_cursor() -> Result<()> {
+        let db_dir = tempfile::tempdir()?;
+        let db = Database::open(db_dir.path())?;
+        let mut swap_ids = Vec::new();
+        for _ in 0..3 {
+            let swap_id = Uuid::new_v4();
+            db.insert_latest_state(swap_id, bob_started()).await?;
+            swap_ids.push(swap_id);
+        }
+        db.insert_latest_state(
+            swap_ids[0],
+            Swap::Bob(Bob::Done(BobEndState::SafelyAborted)),
+        )
+        .await?;
+        db.insert_peer_id(swap_ids[1], PeerId::random()).await?;
+
+        let mut exported = Vec::new();
+        let mut query = Query {
+            limit: Some(2),
+            ..Query::default()
+        };
+        loop {
+            let page = db.history(Role::Bob, &query)?.collect::<Result<Vec<_>>>()?;
+            match page.last() {
+                Some(last) => query.after = Some(last.swap_id),
+                None => break,
+            }
+            exported.extend(page);
+        }
+
+        assert_eq!(exported.len(), 3);
+        assert_eq!(exported[2].swap_id, swap_ids[0]);
+        assert!(exported.iter().any(|record| record.peer_id.is_some()));
+        assert!(exported
+            .iter()
+            .all(|record| record.btc_amount_sat.is_none() && record.started_at > 0));
+
+        let done = db
+            .history(Role::Bob, &Query {
+                status: Some(Status::Done),
+                ..Query::default()
+            })?
+            .collect::<Result<Vec<_>>>()?;
+        assert_eq!(done.len(), 1);
+        assert!(db.history(Role::Alice, &Query::default())?.next().is_none());
+
+        let mut csv = Vec::new();
+        export_history(
+            db.history(Role::Bob, &Query::default())?,
+            Format::Csv,
+            &mut csv,
+        )?;
+        assert_eq!(String::from_utf8(csv)?.lines().count(), 4);
+
+        Ok(())
+    }
+
+    fn bob_started() -> Swap {
+        Swap::Bob(Bob::Started {
+            btc_amount: ::bitcoin::Amount::from_sat(100_000),
+            change_address: "bcrt1q08pfqpsyrt7acllzyjm8q5qsz5capvyahm49rw"
+                .parse()
+                .unwrap(),
+        })
+    }
 }
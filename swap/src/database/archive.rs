@@ -0,0 +1,245 @@
+use crate::database::{JournalEntry, Swap};
+use anyhow::{Context, Result};
+use flate2::bufread::GzDecoder;
+use flate2::read::MultiGzDecoder;
+use flate2::write::GzEncoder;
+use flate2::Compression;
+use serde::{Deserialize, Serialize};
+use std::collections::HashSet;
+use std::fs::{File, OpenOptions};
+use std::io::{self, BufRead, BufReader, BufWriter, Seek, Write};
+use std::path::Path;
+use uuid::Uuid;
+
+/// A finished swap together with everything the database knew about it.
+#[derive(Debug, Clone, PartialEq, Serialize, Deserialize)]
+pub struct ArchivedSwap {
+    pub swap_id: Uuid,
+    pub state: Swap,
+    pub peer_id: Option<String>,
+    pub monero_address: Option<::monero::Address>,
+    pub journal: Vec<JournalEntry>,
+}
+
+/// Appends swaps to an archive file.
+///
+/// The archive is a sequence of gzip members holding CBOR encoded
+/// [`ArchivedSwap`]s, each writer adds one member. What was archived before
+/// is never rewritten.
+///
+/// A member left incomplete by a writer that did not finish is cut off before
+/// the next one is appended, otherwise it would hide every member after it
+/// from the [`ArchiveReader`]. The swaps it held are still in the database,
+/// they are only removed there once the member is finished.
+pub struct ArchiveWriter {
+    encoder: GzEncoder<BufWriter<File>>,
+}
+
+impl ArchiveWriter {
+    pub fn append_to(path: &Path) -> Result<Self> {
+        let file = OpenOptions::new()
+            .create(true)
+            .read(true)
+            .append(true)
+            .open(path)
+            .with_context(|| format!("Failed to open archive {}", path.display()))?;
+
+        let complete = complete_members_len(&file)
+            .with_context(|| format!("Failed to read archive {}", path.display()))?;
+        if complete < file.metadata()?.len() {
+            tracing::warn!(
+                "Removing incomplete swaps from the end of archive {}",
+                path.display()
+            );
+            file.set_len(complete)?;
+            file.sync_all()?;
+        }
+
+        Ok(Self {
+            encoder: GzEncoder::new(BufWriter::new(file), Compression::default()),
+        })
+    }
+
+    pub fn write(&mut self, swap: &ArchivedSwap) -> Result<()> {
+        serde_cbor::to_writer(&mut self.encoder, swap).context("Failed to write to archive")
+    }
+
+    /// Completes the member and returns once it is on disk.
+    pub fn finish(self) -> Result<()> {
+        let mut writer = self.encoder.finish()?;
+        writer.flush()?;
+        writer.get_ref().sync_all()?;
+
+        Ok(())
+    }
+}
+
+/// The length of the gzip members at the start of the archive that can be
+/// decompressed completely.
+fn complete_members_len(file: &File) -> io::Result<u64> {
+    let mut reader = BufReader::new(file);
+    reader.seek(io::SeekFrom::Start(0))?;
+
+    let mut complete = 0;
+    while !reader.fill_buf()?.is_empty() {
+        // Unlike its counterpart in `flate2::read`, this decoder doesn't read
+        // past the end of the member.
+        let mut member = GzDecoder::new(&mut reader);
+        if io::copy(&mut member, &mut io::sink()).is_err() {
+            break;
+        }
+        complete = reader.stream_position()?;
+    }
+
+    Ok(complete)
+}
+
+/// Reads the swaps of an archive one by one, in the order they were
+/// archived.
+///
+/// A swap that was archived more than once is only returned the first time.
+pub struct ArchiveReader {
+    swaps: serde_cbor::StreamDeserializer<
+        'static,
+        serde_cbor::de::IoRead<MultiGzDecoder<BufReader<File>>>,
+        ArchivedSwap,
+    >,
+    seen: HashSet<Uuid>,
+}
+
+impl ArchiveReader {
+    pub fn open(path: &Path) -> Result<Self> {
+        let file = File::open(path)
+            .with_context(|| format!("Failed to open archive {}", path.display()))?;
+        let decoder = MultiGzDecoder::new(BufReader::new(file));
+
+        Ok(Self {
+            swaps: serde_cbor::Deserializer::from_reader(decoder).into_iter(),
+            seen: HashSet::new(),
+        })
+    }
+}
+
+impl Iterator for ArchiveReader {
+    type Item = Result<ArchivedSwap>;
+
+    fn next(&mut self) -> Option<Self::Item> {
+        loop {
+            let swap = match self.swaps.next()? {
+                Ok(swap) => swap,
+                Err(error) => return Some(Err(error).context("Failed to read swap from archive")),
+            };
+
+            if self.seen.insert(swap.swap_id) {
+                return Some(Ok(swap));
+            }
+        }
+    }
+}
+
+/// The ids of the swaps in the archive at `path`, if there is one.
+pub fn archived_swap_ids(path: &Path) -> Result<HashSet<Uuid>> {
+    // An empty file is not a valid gzip stream.
+    if !path.exists() || path.metadata()?.len() == 0 {
+        return Ok(HashSet::new());
+    }
+
+    ArchiveReader::open(path)?
+        .map(|swap| swap.map(|swap| swap.swap_id))
+        .collect()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::database::alice::AliceEndState;
+    use crate::database::Alice;
+
+    #[test]
+    fn reads_swaps_from_all_appended_members() -> Result<()> {
+        let dir = tempfile::tempdir()?;
+        let path = dir.path().join("archive");
+        let swaps = (0..3).map(|_| archived_swap()).collect::<Vec<_>>();
+
+        let mut writer = ArchiveWriter::append_to(&path)?;
+        writer.write(&swaps[0])?;
+        writer.write(&swaps[1])?;
+        writer.finish()?;
+
+        let mut writer = ArchiveWriter::append_to(&path)?;
+        writer.write(&swaps[2])?;
+        writer.finish()?;
+
+        let read = ArchiveReader::open(&path)?.collect::<Result<Vec<_>>>()?;
+        assert_eq!(read, swaps);
+
+        Ok(())
+    }
+
+    #[test]
+    fn incomplete_member_is_cut_off_before_appending() -> Result<()> {
+        let dir = tempfile::tempdir()?;
+        let path = dir.path().join("archive");
+        let swaps = (0..3).map(|_| archived_swap()).collect::<Vec<_>>();
+
+        let mut writer = ArchiveWriter::append_to(&path)?;
+        writer.write(&swaps[0])?;
+        writer.finish()?;
+        let complete = std::fs::metadata(&path)?.len();
+
+        // A writer that died halfway through its member.
+        let mut writer = ArchiveWriter::append_to(&path)?;
+        writer.write(&swaps[1])?;
+        writer.finish()?;
+        let file = OpenOptions::new().write(true).open(&path)?;
+        file.set_len(complete + 10)?;
+        drop(file);
+
+        let mut writer = ArchiveWriter::append_to(&path)?;
+        writer.write(&swaps[2])?;
+        writer.finish()?;
+
+        let read = ArchiveReader::open(&path)?.collect::<Result<Vec<_>>>()?;
+        assert_eq!(read, vec![swaps[0].clone(), swaps[2].clone()]);
+
+        Ok(())
+    }
+
+    #[test]
+    fn swaps_archived_twice_are_read_once() -> Result<()> {
+        let dir = tempfile::tempdir()?;
+        let path = dir.path().join("archive");
+        let swaps = (0..2).map(|_| archived_swap()).collect::<Vec<_>>();
+
+        let mut writer = ArchiveWriter::append_to(&path)?;
+        writer.write(&swaps[0])?;
+        writer.finish()?;
+
+        let mut writer = ArchiveWriter::append_to(&path)?;
+        writer.write(&swaps[0])?;
+        writer.write(&swaps[1])?;
+        writer.finish()?;
+
+        let read = ArchiveReader::open(&path)?.collect::<Result<Vec<_>>>()?;
+        assert_eq!(read, swaps);
+        assert_eq!(
+            archived_swap_ids(&path)?,
+            swaps
+                .iter()
+                .map(|swap| swap.swap_id)
+                .collect::<HashSet<_>>()
+        );
+
+        Ok(())
+    }
+
+    fn archived_swap() -> ArchivedSwap {
+        ArchivedSwap {
+            swap_id: Uuid::new_v4(),
+            state: Swap::Alice(Alice::Done(AliceEndState::BtcRedeemed)),
+            peer_id: None,
+            monero_address: None,
+            journal: Vec::new(),
+        }
+    }
+}
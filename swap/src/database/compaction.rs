@@ -0,0 +1,230 @@
+use anyhow::{bail, Context, Result};
+use std::fs::{self, File};
+use std::path::{Path, PathBuf};
+
+/// The directories and files involved in compacting the database at a path.
+///
+/// A compaction copies the database to `compacted`, writes the `marker` once
+/// the copy is complete and durable, then moves the database to `old` and the
+/// copy into its place. The marker is removed after both renames, `old` last.
+/// Hence the marker decides whether an interrupted compaction is finished or
+/// rolled back.
+#[derive(Debug, Clone, PartialEq)]
+pub struct Compaction {
+    path: PathBuf,
+    compacted: PathBuf,
+    marker: PathBuf,
+    old: PathBuf,
+}
+
+impl Compaction {
+    pub fn new(path: &Path) -> Self {
+        Self {
+            path: path.to_owned(),
+            compacted: path.with_extension("compacted"),
+            marker: path.with_extension("compacted.done"),
+            old: path.with_extension("old"),
+        }
+    }
+
+    /// Where the copy of the database is written to.
+    ///
+    /// Leftovers of an earlier attempt are removed.
+    pub fn prepare(&self) -> Result<&Path> {
+        remove_file_if_exists(&self.marker)?;
+        remove_dir_if_exists(&self.compacted)?;
+
+        Ok(&self.compacted)
+    }
+
+    /// Moves the complete and flushed copy into the place of the database.
+    ///
+    /// Nothing may have the database open meanwhile.
+    pub fn finish(&self) -> Result<()> {
+        let marker = File::create(&self.marker)
+            .with_context(|| format!("Could not create {}", self.marker.display()))?;
+        marker.sync_all()?;
+        sync_parent(&self.marker)?;
+
+        self.swap_in()
+    }
+
+    /// Finishes or rolls back a compaction that was interrupted, so that the
+    /// database at `path` can be opened.
+    ///
+    /// A database that was set aside is always moved back or replaced by its
+    /// copy, sled must never create an empty database in its place.
+    pub fn recover(&self) -> Result<()> {
+        if self.marker.exists() {
+            tracing::info!(
+                "Finishing interrupted compaction of the database at {}",
+                self.path.display()
+            );
+            return self.swap_in();
+        }
+
+        // Without the marker the copy may be incomplete.
+        remove_dir_if_exists(&self.compacted)?;
+
+        match (self.path.exists(), self.old.exists()) {
+            (true, true) => {
+                // The compacted database was moved in, only the old one was
+                // left to be removed.
+                remove_dir_if_exists(&self.old)?;
+            }
+            (false, true) => {
+                tracing::warn!(
+                    "Restoring the database at {} from {}",
+                    self.path.display(),
+                    self.old.display()
+                );
+                fs::rename(&self.old, &self.path)?;
+                sync_parent(&self.path)?;
+            }
+            (_, false) => {}
+        }
+
+        Ok(())
+    }
+
+    fn swap_in(&self) -> Result<()> {
+        if !self.compacted.exists() && !self.path.exists() {
+            bail!(
+                "Neither the database at {} nor its compacted copy exist",
+                self.path.display()
+            )
+        }
+
+        if self.compacted.exists() {
+            if self.path.exists() {
+                if self.old.exists() {
+                    bail!(
+                        "Cannot set aside the database at {}, {} already exists",
+                        self.path.display(),
+                        self.old.display()
+                    )
+                }
+                fs::rename(&self.path, &self.old)?;
+            }
+            fs::rename(&self.compacted, &self.path)?;
+            sync_parent(&self.path)?;
+        }
+
+        fs::remove_file(&self.marker)?;
+        sync_parent(&self.marker)?;
+        remove_dir_if_exists(&self.old)?;
+
+        Ok(())
+    }
+}
+
+fn remove_dir_if_exists(path: &Path) -> Result<()> {
+    if path.exists() {
+        fs::remove_dir_all(path).with_context(|| format!("Could not remove {}", path.display()))?;
+    }
+
+    Ok(())
+}
+
+fn remove_file_if_exists(path: &Path) -> Result<()> {
+    if path.exists() {
+        fs::remove_file(path).with_context(|| format!("Could not remove {}", path.display()))?;
+    }
+
+    Ok(())
+}
+
+/// Makes renames and removals within the parent directory of `path` durable.
+#[cfg(unix)]
+fn sync_parent(path: &Path) -> Result<()> {
+    if let Some(parent) = path.parent() {
+        File::open(parent)?.sync_all()?;
+    }
+
+    Ok(())
+}
+
+#[cfg(not(unix))]
+fn sync_parent(_: &Path) -> Result<()> {
+    Ok(())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn copy_is_moved_in_once_marked_complete() -> Result<()> {
+        let dir = tempfile::tempdir()?;
+        let compaction = Compaction::new(&dir.path().join("database"));
+        fake_db(&compaction.path, "original")?;
+        fake_db(&compaction.compacted, "compacted")?;
+        File::create(&compaction.marker)?;
+        // Crashed after setting the database aside.
+        fs::rename(&compaction.path, &compaction.old)?;
+
+        compaction.recover()?;
+
+        assert_eq!(content(&compaction.path)?, "compacted");
+        assert!(!compaction.old.exists());
+        assert!(!compaction.marker.exists());
+
+        Ok(())
+    }
+
+    #[test]
+    fn unmarked_copy_is_discarded() -> Result<()> {
+        let dir = tempfile::tempdir()?;
+        let compaction = Compaction::new(&dir.path().join("database"));
+        fake_db(&compaction.path, "original")?;
+        fake_db(&compaction.compacted, "partial")?;
+
+        compaction.recover()?;
+
+        assert_eq!(content(&compaction.path)?, "original");
+        assert!(!compaction.compacted.exists());
+
+        Ok(())
+    }
+
+    #[test]
+    fn database_set_aside_is_restored() -> Result<()> {
+        let dir = tempfile::tempdir()?;
+        let compaction = Compaction::new(&dir.path().join("database"));
+        fake_db(&compaction.old, "original")?;
+
+        compaction.recover()?;
+
+        assert_eq!(content(&compaction.path)?, "original");
+        assert!(!compaction.old.exists());
+
+        Ok(())
+    }
+
+    #[test]
+    fn finish_replaces_the_database() -> Result<()> {
+        let dir = tempfile::tempdir()?;
+        let compaction = Compaction::new(&dir.path().join("database"));
+        fake_db(&compaction.path, "original")?;
+        fake_db(compaction.prepare()?, "compacted")?;
+
+        compaction.finish()?;
+
+        assert_eq!(content(&compaction.path)?, "compacted");
+        assert!(!compaction.old.exists());
+        assert!(!compaction.marker.exists());
+
+        Ok(())
+    }
+
+    fn fake_db(path: &Path, content: &str) -> Result<()> {
+        fs::create_dir(path)?;
+        fs::write(path.join("db"), content)?;
+
+        Ok(())
+    }
+
+    fn content(path: &Path) -> Result<String> {
+        Ok(fs::read_to_string(path.join("db"))?)
+    }
+}
@@ -0,0 +1,121 @@
+use anyhow::{anyhow, Context, Result};
+use std::sync::{Arc, Mutex, MutexGuard, PoisonError};
+use std::time::Duration;
+use tokio::sync::oneshot;
+
+/// Makes writes to the database durable in groups.
+///
+/// Every write waits for a flush that started after the write, exactly like
+/// flushing after each write would. Writes that arrive while a flush is
+/// running, or within `window` before it starts, share the next flush, so
+/// concurrent swaps do not each pay for an fsync.
+#[derive(Debug)]
+pub struct GroupCommit {
+    db: sled::Db,
+    window: Duration,
+    inner: Mutex<Inner>,
+}
+
+#[derive(Debug, Default)]
+struct Inner {
+    waiting: Vec<oneshot::Sender<Result<(), String>>>,
+    flushing: bool,
+}
+
+impl GroupCommit {
+    pub fn new(db: sled::Db, window: Duration) -> Self {
+        Self {
+            db,
+            window,
+            inner: Mutex::default(),
+        }
+    }
+
+    /// Returns once everything written before the call is durable.
+    pub async fn commit(self: &Arc<Self>) -> Result<()> {
+        let (sender, receiver) = oneshot::channel();
+
+        let start_flushing = {
+            let mut inner = self.inner();
+            inner.waiting.push(sender);
+
+            !std::mem::replace(&mut inner.flushing, true)
+        };
+
+        // The flushes run on their own task, a caller that gives up waiting
+        // must not leave the others hanging.
+        if start_flushing {
+            tokio::spawn(flush_groups(self.clone()));
+        }
+
+        receiver
+            .await
+            .context("Database flush was dropped")?
+            .map_err(|error| anyhow!(error))
+            .context("Could not flush db")
+    }
+
+    pub fn db(&self) -> &sled::Db {
+        &self.db
+    }
+
+    fn inner(&self) -> MutexGuard<'_, Inner> {
+        self.inner.lock().unwrap_or_else(PoisonError::into_inner)
+    }
+}
+
+async fn flush_groups(group_commit: Arc<GroupCommit>) {
+    loop {
+        if group_commit.window > Duration::ZERO {
+            tokio::time::sleep(group_commit.window).await;
+        }
+
+        let group = {
+            let mut inner = group_commit.inner();
+            if inner.waiting.is_empty() {
+                inner.flushing = false;
+                return;
+            }
+
+            std::mem::take(&mut inner.waiting)
+        };
+
+        let result = group_commit
+            .db
+            .flush_async()
+            .await
+            .map(|_| ())
+            .map_err(|error| error.to_string());
+
+        for waiting in group {
+            let _ = waiting.send(result.clone());
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use futures::future;
+
+    #[tokio::test]
+    async fn concurrent_commits_are_acknowledged() {
+        let db_dir = tempfile::tempdir().unwrap();
+        let db = sled::open(db_dir.path()).unwrap();
+        let group_commit = Arc::new(GroupCommit::new(db.clone(), Duration::from_millis(10)));
+
+        let commits = (0..20u8).map(|i| {
+            let db = db.clone();
+            let group_commit = group_commit.clone();
+
+            async move {
+                db.insert([i], vec![i]).unwrap();
+                group_commit.commit().await
+            }
+        });
+        let results = future::join_all(commits).await;
+
+        assert!(results.iter().all(Result::is_ok));
+        assert_eq!(db.len(), 20);
+    }
+}
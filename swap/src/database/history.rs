@@ -0,0 +1,274 @@
+use crate::database::index::{IndexKey, Role, Status, KEY_LEN};
+use crate::database::{JournalEntry, Swap};
+use anyhow::{bail, Context, Result};
+use comfy_table::Table;
+use serde::Serialize;
+use std::convert::TryFrom;
+use std::io::Write;
+use std::ops::Bound;
+use std::str::FromStr;
+use uuid::Uuid;
+
+/// Which swaps to export.
+#[derive(Debug, Clone, Copy, Default, PartialEq)]
+pub struct Query {
+    pub status: Option<Status>,
+    /// Only swaps started at or after this time, in seconds since the Unix
+    /// epoch.
+    pub started_since: Option<u64>,
+    /// Only swaps started before this time, in seconds since the Unix epoch.
+    pub started_before: Option<u64>,
+    /// Continue after this swap, usually the last one of the previous page.
+    pub after: Option<Uuid>,
+    pub limit: Option<usize>,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum Format {
+    Table,
+    /// One JSON object per line.
+    Json,
+    Csv,
+}
+
+impl FromStr for Format {
+    type Err = anyhow::Error;
+
+    fn from_str(s: &str) -> Result<Self> {
+        match s {
+            "table" => Ok(Format::Table),
+            "json" => Ok(Format::Json),
+            "csv" => Ok(Format::Csv),
+            other => bail!("Unknown format {}, expected table, json or csv", other),
+        }
+    }
+}
+
+/// A swap as exported by the history.
+#[derive(Debug, Clone, PartialEq, Serialize)]
+pub struct HistoryRecord {
+    pub swap_id: Uuid,
+    /// Seconds since the Unix epoch, zero for swaps started before this was
+    /// recorded.
+    pub started_at: u64,
+    pub state: String,
+    pub btc_amount_sat: Option<u64>,
+    pub xmr_amount_piconero: Option<u64>,
+    pub btc_lock_txid: Option<String>,
+    pub xmr_lock_tx_hash: Option<String>,
+    pub peer_id: Option<String>,
+}
+
+const CSV_HEADER: &str = "swap_id,started_at,state,btc_amount_sat,xmr_amount_piconero,btc_lock_txid,xmr_lock_tx_hash,peer_id";
+
+impl HistoryRecord {
+    pub(super) fn new(
+        swap_id: Uuid,
+        started_at: u64,
+        state: &Swap,
+        journal: Vec<JournalEntry>,
+        peer_id: Option<String>,
+    ) -> Self {
+        let mut record = Self {
+            swap_id,
+            started_at,
+            state: state.to_string(),
+            btc_amount_sat: None,
+            xmr_amount_piconero: None,
+            btc_lock_txid: None,
+            xmr_lock_tx_hash: None,
+            peer_id,
+        };
+
+        // Swaps stored before the journal existed only have their current
+        // state to tell about them.
+        let current = JournalEntry::new(state, 0);
+        for entry in journal.into_iter().chain(std::iter::once(current)) {
+            record.btc_amount_sat = record
+                .btc_amount_sat
+                .or_else(|| entry.btc_amount.map(|amount| amount.as_sat()));
+            record.xmr_amount_piconero = record
+                .xmr_amount_piconero
+                .or_else(|| entry.xmr_amount.map(|amount| amount.as_piconero()));
+            record.btc_lock_txid = record
+                .btc_lock_txid
+                .or_else(|| entry.bitcoin_txid.map(|txid| txid.to_string()));
+            record.xmr_lock_tx_hash = record
+                .xmr_lock_tx_hash
+                .or_else(|| entry.monero_tx_hash.map(String::from));
+        }
+
+        record
+    }
+
+    fn csv_row(&self) -> String {
+        let optional = |value: Option<String>| value.unwrap_or_default();
+
+        [
+            self.swap_id.to_string(),
+            self.started_at.to_string(),
+            self.state.clone(),
+            optional(self.btc_amount_sat.map(|amount| amount.to_string())),
+            optional(self.xmr_amount_piconero.map(|amount| amount.to_string())),
+            optional(self.btc_lock_txid.clone()),
+            optional(self.xmr_lock_tx_hash.clone()),
+            optional(self.peer_id.clone()),
+        ]
+        .iter()
+        .map(|field| csv_field(field))
+        .collect::<Vec<_>>()
+        .join(",")
+    }
+}
+
+/// Writes `records` to `writer` as they are read.
+///
+/// Only [`Format::Table`] has to hold all records before writing them.
+pub fn export_history<I, W>(records: I, format: Format, mut writer: W) -> Result<()>
+where
+    I: Iterator<Item = Result<HistoryRecord>>,
+    W: Write,
+{
+    match format {
+        Format::Table => {
+            let mut table = Table::new();
+
+            table.set_header(vec!["SWAP ID", "STATE"]);
+
+            for record in records {
+                let record = record?;
+                table.add_row(vec![record.swap_id.to_string(), record.state]);
+            }
+
+            writeln!(writer, "{}", table)?;
+        }
+        Format::Json => {
+            for record in records {
+                serde_json::to_writer(&mut writer, &record?)?;
+                writeln!(writer)?;
+            }
+        }
+        Format::Csv => {
+            writeln!(writer, "{}", CSV_HEADER)?;
+
+            for record in records {
+                writeln!(writer, "{}", record?.csv_row())?;
+            }
+        }
+    }
+
+    writer.flush().context("Failed to write history")
+}
+
+/// Parses a date like `2021-07-09` into the seconds since the Unix epoch at
+/// its start, in UTC.
+pub fn parse_date(date: &str) -> Result<u64> {
+    let timestamp = time::Date::parse(date, "%F")
+        .with_context(|| format!("Invalid date {}, expected YYYY-MM-DD", date))?
+        .midnight()
+        .assume_utc()
+        .unix_timestamp();
+
+    u64::try_from(timestamp).with_context(|| format!("Date {} is before 1970", date))
+}
+
+type KeyRange = (Bound<Vec<u8>>, Bound<Vec<u8>>);
+
+/// The ranges of the swap index that hold the swaps of `role` matching
+/// `query`, starting after the index key `cursor`.
+pub(super) fn key_ranges(role: Role, query: &Query, cursor: Option<&[u8]>) -> Vec<KeyRange> {
+    [Status::Active, Status::Done]
+        .iter()
+        .copied()
+        .filter(|status| query.status.map_or(true, |wanted| wanted == *status))
+        .filter_map(|status| {
+            let prefix = IndexKey::prefix(status, role);
+            let lower = key(prefix, query.started_since.unwrap_or(0), 0x00);
+            let upper = match query.started_before {
+                Some(before) => Bound::Excluded(key(prefix, before, 0x00)),
+                None => Bound::Included(key(prefix, u64::MAX, 0xff)),
+            };
+
+            let lower = match cursor {
+                Some(cursor) if cursor[..2] > prefix[..] => return None,
+                Some(cursor) if cursor[..2] == prefix[..] && cursor >= &lower[..] => {
+                    Bound::Excluded(cursor.to_vec())
+                }
+                _ => Bound::Included(lower),
+            };
+
+            let is_empty = match (&lower, &upper) {
+                (Bound::Included(lower), Bound::Included(upper)) => lower > upper,
+                (Bound::Included(lower), Bound::Excluded(upper))
+                | (Bound::Excluded(lower), Bound::Included(upper))
+                | (Bound::Excluded(lower), Bound::Excluded(upper)) => lower >= upper,
+                _ => false,
+            };
+            if is_empty {
+                return None;
+            }
+
+            Some((lower, upper))
+        })
+        .collect()
+}
+
+fn key(prefix: [u8; 2], started_at: u64, fill: u8) -> Vec<u8> {
+    let mut key = prefix.to_vec();
+    key.extend_from_slice(&started_at.to_be_bytes());
+    key.resize(KEY_LEN, fill);
+
+    key
+}
+
+fn csv_field(field: &str) -> String {
+    if field.contains(|c: char| matches!(c, ',' | '"' | '\n' | '\r')) {
+        format!("\"{}\"", field.replace('"', "\"\""))
+    } else {
+        field.to_owned()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn dates_are_parsed_as_utc_midnight() {
+        assert_eq!(parse_date("2021-07-09").unwrap(), 1_625_788_800);
+        assert!(parse_date("09.07.2021").is_err());
+    }
+
+    #[test]
+    fn csv_fields_are_quoted_when_needed() {
+        assert_eq!(csv_field("Done: BtcRedeemed"), "Done: BtcRedeemed");
+        assert_eq!(csv_field("a,\"b\""), "\"a,\"\"b\"\"\"");
+    }
+
+    #[test]
+    fn cursor_skips_what_was_already_exported() {
+        let cursor = IndexKey {
+            status: Status::Done,
+            role: Role::Alice,
+            started_at: 100,
+            swap_id: Uuid::new_v4(),
+        }
+        .to_bytes();
+
+        let ranges = key_ranges(Role::Alice, &Query::default(), Some(&cursor));
+
+        assert_eq!(ranges.len(), 1);
+        assert_eq!(ranges[0].0, Bound::Excluded(cursor.to_vec()));
+    }
+
+    #[test]
+    fn empty_date_ranges_are_skipped() {
+        let query = Query {
+            started_since: Some(200),
+            started_before: Some(100),
+            ..Query::default()
+        };
+
+        assert!(key_ranges(Role::Bob, &query, None).is_empty());
+    }
+}
@@ -0,0 +1,149 @@
+use crate::database::{Alice, Bob, Swap};
+use anyhow::{bail, Context, Result};
+use std::convert::TryFrom;
+use std::str::FromStr;
+use uuid::Uuid;
+
+/// Length of an encoded [`IndexKey`].
+pub const KEY_LEN: usize = 2 + 8 + 16;
+
+/// Whether a swap still needs to be driven by the node.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord)]
+pub enum Status {
+    Active = 0,
+    Done = 1,
+}
+
+impl FromStr for Status {
+    type Err = anyhow::Error;
+
+    fn from_str(s: &str) -> Result<Self> {
+        match s {
+            "active" => Ok(Status::Active),
+            "done" => Ok(Status::Done),
+            other => bail!("Unknown swap status {}, expected active or done", other),
+        }
+    }
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord)]
+pub enum Role {
+    Alice = 0,
+    Bob = 1,
+}
+
+/// Key of a swap in the secondary index, ordered by status, role and the time
+/// the swap was first stored.
+///
+/// Swaps with the same status and role therefore share a key prefix and can
+/// be found with a range scan, without reading their states.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord)]
+pub struct IndexKey {
+    pub status: Status,
+    pub role: Role,
+    /// Seconds since the Unix epoch, zero for swaps that were stored before
+    /// the index existed.
+    pub started_at: u64,
+    pub swap_id: Uuid,
+}
+
+impl IndexKey {
+    pub fn new(swap: &Swap, started_at: u64, swap_id: Uuid) -> Self {
+        let (status, role) = match swap {
+            Swap::Alice(Alice::Done(_)) => (Status::Done, Role::Alice),
+            Swap::Alice(_) => (Status::Active, Role::Alice),
+            Swap::Bob(Bob::Done(_)) => (Status::Done, Role::Bob),
+            Swap::Bob(_) => (Status::Active, Role::Bob),
+        };
+
+        Self {
+            status,
+            role,
+            started_at,
+            swap_id,
+        }
+    }
+
+    pub fn prefix(status: Status, role: Role) -> [u8; 2] {
+        [status as u8, role as u8]
+    }
+
+    pub fn to_bytes(&self) -> [u8; KEY_LEN] {
+        let mut bytes = [0u8; KEY_LEN];
+        bytes[..2].copy_from_slice(&Self::prefix(self.status, self.role));
+        bytes[2..10].copy_from_slice(&self.started_at.to_be_bytes());
+        bytes[10..].copy_from_slice(self.swap_id.as_bytes());
+
+        bytes
+    }
+
+    pub fn from_bytes(bytes: &[u8]) -> Result<Self> {
+        let bytes = <[u8; KEY_LEN]>::try_from(bytes).context("Index key has the wrong length")?;
+
+        let status = match bytes[0] {
+            0 => Status::Active,
+            1 => Status::Done,
+            other => bail!("Unknown swap status {} in index", other),
+        };
+        let role = match bytes[1] {
+            0 => Role::Alice,
+            1 => Role::Bob,
+            other => bail!("Unknown swap role {} in index", other),
+        };
+        let mut started_at = [0u8; 8];
+        started_at.copy_from_slice(&bytes[2..10]);
+
+        Ok(Self {
+            status,
+            role,
+            started_at: u64::from_be_bytes(started_at),
+            swap_id: Uuid::from_slice(&bytes[10..])?,
+        })
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::database::alice::AliceEndState;
+
+    #[test]
+    fn key_roundtrips() {
+        let key = IndexKey::new(
+            &Swap::Alice(Alice::Done(AliceEndState::BtcRedeemed)),
+            1_626_000_000,
+            Uuid::new_v4(),
+        );
+
+        assert_eq!(IndexKey::from_bytes(&key.to_bytes()).unwrap(), key);
+    }
+
+    #[test]
+    fn encoded_keys_sort_like_keys() {
+        let keys = [
+            key(Status::Active, Role::Alice, 300),
+            key(Status::Active, Role::Bob, 100),
+            key(Status::Done, Role::Alice, 200),
+            key(Status::Active, Role::Alice, 256),
+        ];
+
+        let mut sorted = keys;
+        sorted.sort();
+        let mut sorted_bytes = keys.iter().map(IndexKey::to_bytes).collect::<Vec<_>>();
+        sorted_bytes.sort();
+
+        assert_eq!(
+            sorted.iter().map(IndexKey::to_bytes).collect::<Vec<_>>(),
+            sorted_bytes
+        );
+    }
+
+    fn key(status: Status, role: Role, started_at: u64) -> IndexKey {
+        IndexKey {
+            status,
+            role,
+            started_at,
+            swap_id: Uuid::new_v4(),
+        }
+    }
+}
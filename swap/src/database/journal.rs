@@ -0,0 +1,184 @@
+use crate::database::alice::AliceEndState;
+use crate::database::bob::BobEndState;
+use crate::database::{Alice, Bob, Swap};
+use crate::monero::TxHash;
+use crate::{bitcoin, monero};
+use anyhow::{Context, Result};
+use serde::{Deserialize, Serialize};
+use std::convert::TryFrom;
+use std::time::{SystemTime, UNIX_EPOCH};
+use uuid::Uuid;
+
+/// Length of an encoded [`JournalKey`].
+pub const KEY_LEN: usize = 16 + 8;
+
+/// Key of a journal entry: the swap id followed by a sequence number.
+///
+/// Sequence numbers count the entries of each swap, so the entries of one
+/// swap share a key prefix and are ordered by time. Unlike ids generated by
+/// sled they survive copying the database into a new one.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord)]
+pub struct JournalKey {
+    pub swap_id: Uuid,
+    pub seq: u64,
+}
+
+impl JournalKey {
+    pub fn to_bytes(&self) -> [u8; KEY_LEN] {
+        let mut bytes = [0u8; KEY_LEN];
+        bytes[..16].copy_from_slice(self.swap_id.as_bytes());
+        bytes[16..].copy_from_slice(&self.seq.to_be_bytes());
+
+        bytes
+    }
+
+    pub fn from_bytes(bytes: &[u8]) -> Result<Self> {
+        let bytes = <[u8; KEY_LEN]>::try_from(bytes).context("Journal key has the wrong length")?;
+        let mut seq = [0u8; 8];
+        seq.copy_from_slice(&bytes[16..]);
+
+        Ok(Self {
+            swap_id: Uuid::from_slice(&bytes[..16])?,
+            seq: u64::from_be_bytes(seq),
+        })
+    }
+}
+
+/// A state transition of a swap, as recorded in the journal.
+#[derive(Debug, Clone, PartialEq, Serialize, Deserialize)]
+pub struct JournalEntry {
+    /// The name of the state the swap transitioned into, e.g. `BtcLocked` or
+    /// `Done(BtcRedeemed)`.
+    pub tag: String,
+    /// Milliseconds since the Unix epoch.
+    pub timestamp: u64,
+    /// The Bitcoin locked in the swap, on the transition that agreed on it.
+    #[serde(default, with = "::bitcoin::util::amount::serde::as_sat::opt")]
+    pub btc_amount: Option<bitcoin::Amount>,
+    /// The Monero locked in the swap, on the transition that agreed on it.
+    #[serde(default)]
+    pub xmr_amount: Option<monero::Amount>,
+    /// The Bitcoin lock transaction, on the transitions that observed it.
+    pub bitcoin_txid: Option<bitcoin::Txid>,
+    /// The Monero lock transaction, on the transitions that observed it.
+    pub monero_tx_hash: Option<TxHash>,
+}
+
+impl JournalEntry {
+    pub fn new(swap: &Swap, timestamp: u64) -> Self {
+        let (btc_amount, xmr_amount) = amounts(swap);
+        let (bitcoin_txid, monero_tx_hash) = txids(swap);
+
+        Self {
+            tag: tag(swap).to_owned(),
+            timestamp,
+            btc_amount,
+            xmr_amount,
+            bitcoin_txid,
+            monero_tx_hash,
+        }
+    }
+}
+
+pub fn now_millis() -> u64 {
+    SystemTime::now()
+        .duration_since(UNIX_EPOCH)
+        .map_or(0, |elapsed| {
+            u64::try_from(elapsed.as_millis()).unwrap_or(u64::MAX)
+        })
+}
+
+fn tag(swap: &Swap) -> &'static str {
+    match swap {
+        Swap::Alice(alice) => match alice {
+            Alice::Started { .. } => "Started",
+            Alice::BtcLockTransactionSeen { .. } => "BtcLockTransactionSeen",
+            Alice::BtcLocked { .. } => "BtcLocked",
+            Alice::XmrLockTransactionSent { .. } => "XmrLockTransactionSent",
+            Alice::XmrLocked { .. } => "XmrLocked",
+            Alice::XmrLockTransferProofSent { .. } => "XmrLockTransferProofSent",
+            Alice::EncSigLearned { .. } => "EncSigLearned",
+            Alice::BtcRedeemTransactionPublished { .. } => "BtcRedeemTransactionPublished",
+            Alice::CancelTimelockExpired { .. } => "CancelTimelockExpired",
+            Alice::BtcCancelled { .. } => "BtcCancelled",
+            Alice::BtcPunishable { .. } => "BtcPunishable",
+            Alice::BtcRefunded { .. } => "BtcRefunded",
+            Alice::Done(AliceEndState::SafelyAborted) => "Done(SafelyAborted)",
+            Alice::Done(AliceEndState::BtcRedeemed) => "Done(BtcRedeemed)",
+            Alice::Done(AliceEndState::XmrRefunded) => "Done(XmrRefunded)",
+            Alice::Done(AliceEndState::BtcPunished) => "Done(BtcPunished)",
+        },
+        Swap::Bob(bob) => match bob {
+            Bob::Started { .. } => "Started",
+            Bob::ExecutionSetupDone { .. } => "ExecutionSetupDone",
+            Bob::BtcLocked { .. } => "BtcLocked",
+            Bob::XmrLockProofReceived { .. } => "XmrLockProofReceived",
+            Bob::XmrLocked { .. } => "XmrLocked",
+            Bob::EncSigSent { .. } => "EncSigSent",
+            Bob::BtcRedeemed(_) => "BtcRedeemed",
+            Bob::CancelTimelockExpired(_) => "CancelTimelockExpired",
+            Bob::BtcCancelled(_) => "BtcCancelled",
+            Bob::Done(BobEndState::SafelyAborted) => "Done(SafelyAborted)",
+            Bob::Done(BobEndState::XmrRedeemed { .. }) => "Done(XmrRedeemed)",
+            Bob::Done(BobEndState::BtcRefunded(_)) => "Done(BtcRefunded)",
+            Bob::Done(BobEndState::BtcPunished { .. }) => "Done(BtcPunished)",
+        },
+    }
+}
+
+/// The amounts of a swap, recorded on the first state that knows both of them.
+fn amounts(swap: &Swap) -> (Option<bitcoin::Amount>, Option<monero::Amount>) {
+    match swap {
+        Swap::Alice(Alice::Started { state3 }) => {
+            (Some(state3.tx_lock.lock_amount()), Some(state3.xmr))
+        }
+        Swap::Bob(Bob::BtcLocked { state3 }) => {
+            (Some(state3.tx_lock.lock_amount()), Some(state3.xmr))
+        }
+        _ => (None, None),
+    }
+}
+
+/// The lock transactions that a transition into `swap` observed.
+///
+/// Every later state still knows about them, they are only recorded once to
+/// keep the entries small.
+fn txids(swap: &Swap) -> (Option<bitcoin::Txid>, Option<TxHash>) {
+    match swap {
+        Swap::Alice(Alice::BtcLockTransactionSeen { state3 })
+        | Swap::Alice(Alice::BtcLocked { state3 }) => (Some(state3.tx_lock.txid()), None),
+        Swap::Alice(Alice::XmrLockTransactionSent { transfer_proof, .. }) => {
+            (None, Some(transfer_proof.tx_hash()))
+        }
+        Swap::Bob(Bob::BtcLocked { state3 }) => (Some(state3.tx_lock_id()), None),
+        Swap::Bob(Bob::XmrLockProofReceived {
+            lock_transfer_proof,
+            ..
+        }) => (None, Some(lock_transfer_proof.tx_hash())),
+        _ => (None, None),
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn key_roundtrips() {
+        let key = JournalKey {
+            swap_id: Uuid::new_v4(),
+            seq: 42,
+        };
+
+        assert_eq!(JournalKey::from_bytes(&key.to_bytes()).unwrap(), key);
+    }
+
+    #[test]
+    fn entries_of_a_swap_sort_by_sequence() {
+        let swap_id = Uuid::new_v4();
+        let first = JournalKey { swap_id, seq: 255 };
+        let second = JournalKey { swap_id, seq: 256 };
+
+        assert!(first.to_bytes() < second.to_bytes());
+    }
+}
@@ -0,0 +1,131 @@
+use crate::database::{Alice, Swap};
+use crate::monero;
+use std::collections::HashMap;
+use std::sync::{Mutex, MutexGuard, PoisonError};
+use uuid::Uuid;
+
+/// Monero promised to swaps, as Alice, that completed the setup but have not
+/// locked the Monero yet.
+///
+/// The reservations follow the swap states written to the [`Database`], and
+/// are rebuilt from them when the database is opened. Totals are kept up to
+/// date with every change, so they can be queried in O(1).
+///
+/// [`Database`]: crate::database::Database
+#[derive(Debug, Default)]
+pub struct Reservations {
+    inner: Mutex<Inner>,
+}
+
+#[derive(Debug, Default)]
+struct Inner {
+    by_swap: HashMap<Uuid, monero::Amount>,
+    reserved: u64,
+    /// Everything that was ever locked by the swaps. Lets callers tell how much
+    /// was locked since they last looked at the wallet balance.
+    locked: u64,
+}
+
+impl Reservations {
+    /// Reserves `amount` for the given swap, replacing any previous
+    /// reservation.
+    pub fn reserve(&self, swap_id: Uuid, amount: monero::Amount) {
+        let mut inner = self.inner();
+
+        inner.remove(swap_id);
+        inner.reserved += amount.as_piconero();
+        inner.by_swap.insert(swap_id, amount);
+    }
+
+    /// Releases the reservation of a swap that will not lock the Monero.
+    pub fn release(&self, swap_id: Uuid) {
+        self.inner().remove(swap_id);
+    }
+
+    /// Sum of all reservations.
+    pub fn reserved(&self) -> monero::Amount {
+        monero::Amount::from_piconero(self.inner().reserved)
+    }
+
+    /// Sum of all reservations that were released because the swap locked the
+    /// Monero.
+    pub fn locked(&self) -> monero::Amount {
+        monero::Amount::from_piconero(self.inner().locked)
+    }
+
+    /// Updates the reservation of a swap that moved to the given state.
+    pub(super) fn update(&self, swap_id: Uuid, state: &Swap) {
+        match reservation(state) {
+            Some(amount) => self.reserve(swap_id, amount),
+            None => {
+                let mut inner = self.inner();
+
+                if let Some(amount) = inner.remove(swap_id) {
+                    if matches!(state, Swap::Alice(Alice::XmrLockTransactionSent { .. })) {
+                        inner.locked += amount.as_piconero();
+                    }
+                }
+            }
+        }
+    }
+
+    fn inner(&self) -> MutexGuard<'_, Inner> {
+        self.inner.lock().unwrap_or_else(PoisonError::into_inner)
+    }
+}
+
+impl Inner {
+    fn remove(&mut self, swap_id: Uuid) -> Option<monero::Amount> {
+        let amount = self.by_swap.remove(&swap_id)?;
+        self.reserved -= amount.as_piconero();
+
+        Some(amount)
+    }
+}
+
+/// The Monero a swap in the given state still has to lock, including the fee.
+fn reservation(state: &Swap) -> Option<monero::Amount> {
+    match state {
+        Swap::Alice(Alice::Started { state3 })
+        | Swap::Alice(Alice::BtcLockTransactionSeen { state3 })
+        | Swap::Alice(Alice::BtcLocked { state3 }) => Some(state3.xmr + monero::MONERO_FEE),
+        _ => None,
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::database::alice::AliceEndState;
+
+    #[test]
+    fn reservations_are_summed_and_released() {
+        let reservations = Reservations::default();
+        let first = Uuid::new_v4();
+        let second = Uuid::new_v4();
+
+        reservations.reserve(first, monero::Amount::from_piconero(100));
+        reservations.reserve(second, monero::Amount::from_piconero(50));
+        reservations.reserve(second, monero::Amount::from_piconero(70));
+        assert_eq!(reservations.reserved(), monero::Amount::from_piconero(170));
+
+        reservations.release(first);
+        assert_eq!(reservations.reserved(), monero::Amount::from_piconero(70));
+        assert_eq!(reservations.locked(), monero::Amount::ZERO);
+    }
+
+    #[test]
+    fn aborted_swap_releases_reservation_without_locking() {
+        let reservations = Reservations::default();
+        let swap_id = Uuid::new_v4();
+        reservations.reserve(swap_id, monero::Amount::from_piconero(100));
+
+        reservations.update(
+            swap_id,
+            &Swap::Alice(Alice::Done(AliceEndState::SafelyAborted)),
+        );
+
+        assert_eq!(reservations.reserved(), monero::Amount::ZERO);
+        assert_eq!(reservations.locked(), monero::Amount::ZERO);
+    }
+}
@@ -20,6 +20,15 @@ pub fn system_data_dir() -> Result<PathBuf> {
         .context("Could not generate default system data-dir dir path")
 }
 
+/// This is the default location for files that can be downloaded again
+// Linux: /home/<user>/.cache/xmr-btc-swap/
+// OSX: /Users/<user>/Library/Caches/xmr-btc-swap/
+pub fn system_cache_dir() -> Result<PathBuf> {
+    ProjectDirs::from("", "", "xmr-btc-swap")
+        .map(|proj_dirs| proj_dirs.cache_dir().to_path_buf())
+        .context("Could not generate default system cache dir path")
+}
+
 pub fn ensure_directory_exists(file: &Path) -> Result<(), std::io::Error> {
     if let Some(path) = file.parent() {
         if !path.exists() {
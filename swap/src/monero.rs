@@ -1,11 +1,18 @@
+mod cache;
+mod output_splitter;
+mod transfer_batcher;
+mod transfer_watcher;
 pub mod wallet;
 mod wallet_rpc;
+mod wallet_rpc_pool;
 
 pub use ::monero::network::Network;
 pub use ::monero::{Address, PrivateKey, PublicKey};
 pub use curve25519_dalek::scalar::Scalar;
+pub use output_splitter::keep_outputs_split;
 pub use wallet::Wallet;
 pub use wallet_rpc::{WalletRpc, WalletRpcProcess};
+pub use wallet_rpc_pool::{PooledWorker, WalletRpcPool};
 
 use crate::bitcoin;
 use anyhow::Result;
@@ -109,6 +116,16 @@ impl Amount {
         Self::from_decimal(decimal)
     }
 
+    /// The most Bitcoin that can be sold for this amount, after paying the
+    /// Monero lock fee, at the given price of one XMR.
+    pub fn max_bitcoin_for_price(&self, ask_price: bitcoin::Amount) -> Option<bitcoin::Amount> {
+        let spendable = self.0.checked_sub(MONERO_FEE.0)?;
+        let sats =
+            u128::from(spendable) * u128::from(ask_price.as_sat()) / u128::from(PICONERO_OFFSET);
+
+        u64::try_from(sats).ok().map(bitcoin::Amount::from_sat)
+    }
+
     pub fn as_piconero_decimal(&self) -> Decimal {
         Decimal::from(self.as_piconero())
     }
@@ -198,7 +215,7 @@ impl fmt::Display for TxHash {
     }
 }
 
-#[derive(Debug, Clone, Copy, thiserror::Error)]
+#[derive(Debug, Clone, Copy, PartialEq, thiserror::Error)]
 #[error("expected {expected}, got {actual}")]
 pub struct InsufficientFunds {
     pub expected: Amount,
@@ -341,6 +358,25 @@ mod tests {
         );
     }
 
+    #[test]
+    fn max_bitcoin_for_price_pays_lock_fee() {
+        let balance = Amount::ONE_XMR * 2 + MONERO_FEE;
+        let ask_price = bitcoin::Amount::from_sat(700_000);
+
+        let max_bitcoin = balance.max_bitcoin_for_price(ask_price).unwrap();
+
+        assert_eq!(max_bitcoin, bitcoin::Amount::from_sat(1_400_000));
+    }
+
+    #[test]
+    fn max_bitcoin_for_price_below_lock_fee_is_none() {
+        let balance = Amount::from_piconero(MONERO_FEE.0 - 1);
+
+        assert!(balance
+            .max_bitcoin_for_price(bitcoin::Amount::from_sat(700_000))
+            .is_none());
+    }
+
     use rand::rngs::OsRng;
     use serde::{Deserialize, Serialize};
 
@@ -0,0 +1,52 @@
+use std::sync::{Mutex, MutexGuard, PoisonError};
+use std::time::{Duration, Instant};
+
+/// The last value read from the wallet RPC, together with when it was read.
+#[derive(Debug)]
+pub struct Cached<T> {
+    reading: Mutex<Option<(T, Instant)>>,
+}
+
+impl<T> Default for Cached<T> {
+    fn default() -> Self {
+        Self {
+            reading: Mutex::new(None),
+        }
+    }
+}
+
+impl<T: Copy> Cached<T> {
+    /// The cached value, if it was read less than `max_age` ago.
+    ///
+    /// A `max_age` of zero never returns a value.
+    pub fn get(&self, max_age: Duration) -> Option<T> {
+        match *self.reading() {
+            Some((value, read_at)) if read_at.elapsed() < max_age => Some(value),
+            _ => None,
+        }
+    }
+
+    pub fn set(&self, value: T) {
+        *self.reading() = Some((value, Instant::now()));
+    }
+
+    fn reading(&self) -> MutexGuard<'_, Option<(T, Instant)>> {
+        self.reading.lock().unwrap_or_else(PoisonError::into_inner)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn values_are_served_until_they_are_too_old() {
+        let cached = Cached::default();
+        assert_eq!(cached.get(Duration::from_secs(60)), None);
+
+        cached.set(42);
+
+        assert_eq!(cached.get(Duration::from_secs(60)), Some(42));
+        assert_eq!(cached.get(Duration::from_secs(0)), None);
+    }
+}
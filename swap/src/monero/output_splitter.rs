@@ -0,0 +1,191 @@
+use crate::database::Database;
+use crate::monero::wallet::UnspentOutput;
+use crate::monero::{Amount, Wallet, MONERO_FEE};
+use std::sync::Weak;
+use std::time::Duration;
+
+/// How often the outputs of the wallet are reconciled.
+const RECONCILE_INTERVAL: Duration = Duration::from_secs(120);
+
+/// A Monero transaction can have at most 16 outputs, one of them is needed for
+/// the change.
+const MAX_OUTPUTS_PER_SPLIT: usize = 15;
+
+/// Outputs smaller than this share of the target size do not count towards
+/// the target, they are too small to lock a swap with.
+const MIN_OUTPUT_SHARE: u64 = 2;
+
+/// What needs to happen to the outputs of the wallet.
+#[derive(Debug, Clone, Copy, PartialEq)]
+enum Reconciliation {
+    /// Enough outputs are available, some are still locked, or Monero is
+    /// reserved for swaps.
+    Nothing,
+    /// Send `count` outputs of `amount` to ourselves.
+    Split { count: usize, amount: Amount },
+}
+
+/// Keeps the funds of the wallet split across `target` similarly sized
+/// outputs, until the wallet is dropped.
+///
+/// Sending the Monero for a swap locks the change for 10 blocks. With a single
+/// large output, every swap therefore has to wait for the change of the
+/// previous one. With several outputs, the next swap can spend one of the
+/// others right away.
+///
+/// A split locks everything it spends for 10 blocks as well, hence the wallet
+/// is only split while no swap in the database waits to lock its Monero.
+pub async fn keep_outputs_split(wallet: Weak<Wallet>, db: Weak<Database>, target: usize) {
+    let mut interval = tokio::time::interval(RECONCILE_INTERVAL);
+
+    loop {
+        interval.tick().await;
+
+        let (wallet, db) = match (wallet.upgrade(), db.upgrade()) {
+            (Some(wallet), Some(db)) => (wallet, db),
+            _ => return,
+        };
+
+        let outputs = match wallet.unspent_outputs().await {
+            Ok(outputs) => outputs,
+            Err(error) => {
+                tracing::debug!("Failed to list unspent Monero outputs: {:#}", error);
+                continue;
+            }
+        };
+
+        match reconcile(&outputs, db.reservations().reserved(), target) {
+            Reconciliation::Nothing => {}
+            Reconciliation::Split { count, amount } => {
+                match wallet.split_outputs(count, amount).await {
+                    Ok(txid) => {
+                        tracing::info!(%txid, %count, %amount, "Split Monero balance into more outputs")
+                    }
+                    Err(error) => {
+                        tracing::warn!(
+                            "Failed to split Monero balance into more outputs: {:#}",
+                            error
+                        )
+                    }
+                }
+            }
+        }
+    }
+}
+
+fn reconcile(outputs: &[UnspentOutput], reserved: Amount, target: usize) -> Reconciliation {
+    // Splitting while outputs are locked would count them twice once they
+    // unlock, e.g. the outputs of the previous split.
+    if target < 2 || outputs.iter().any(|output| !output.unlocked) {
+        return Reconciliation::Nothing;
+    }
+
+    // The split would lock the Monero that swaps are about to send.
+    if reserved != Amount::ZERO {
+        return Reconciliation::Nothing;
+    }
+
+    let total = outputs
+        .iter()
+        .fold(0, |total, output| total + output.amount.as_piconero());
+    let target_size = total / target as u64;
+    if target_size <= MONERO_FEE.as_piconero() {
+        return Reconciliation::Nothing;
+    }
+
+    let usable = outputs
+        .iter()
+        .filter(|output| output.amount.as_piconero() >= target_size / MIN_OUTPUT_SHARE)
+        .count();
+    if usable >= target {
+        return Reconciliation::Nothing;
+    }
+
+    // At least one target size is left over to pay the fee and form the change.
+    let count = (target - usable).min(target - 1).min(MAX_OUTPUTS_PER_SPLIT);
+
+    Reconciliation::Split {
+        count,
+        amount: Amount::from_piconero(target_size),
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn splits_single_output_into_target() {
+        let outputs = vec![unlocked(10)];
+
+        assert_eq!(
+            reconcile(&outputs, Amount::ZERO, 4),
+            Reconciliation::Split {
+                count: 3,
+                amount: Amount::from_piconero(xmr(10).as_piconero() / 4),
+            }
+        );
+    }
+
+    #[test]
+    fn does_nothing_while_outputs_are_locked() {
+        let outputs = vec![unlocked(10), locked(1)];
+
+        assert_eq!(
+            reconcile(&outputs, Amount::ZERO, 4),
+            Reconciliation::Nothing
+        );
+    }
+
+    #[test]
+    fn does_nothing_once_target_is_reached() {
+        let outputs = vec![unlocked(3), unlocked(2), unlocked(2), unlocked(3)];
+
+        assert_eq!(
+            reconcile(&outputs, Amount::ZERO, 4),
+            Reconciliation::Nothing
+        );
+    }
+
+    #[test]
+    fn does_nothing_while_monero_is_reserved_for_swaps() {
+        let outputs = vec![unlocked(10)];
+
+        assert_eq!(reconcile(&outputs, xmr(1), 4), Reconciliation::Nothing);
+    }
+
+    #[test]
+    fn small_outputs_do_not_count_towards_target() {
+        let dust = UnspentOutput {
+            amount: Amount::from_piconero(1),
+            unlocked: true,
+        };
+        let outputs = vec![unlocked(8), dust, dust, dust];
+
+        assert_eq!(
+            reconcile(&outputs, Amount::ZERO, 4),
+            Reconciliation::Split {
+                count: 3,
+                amount: Amount::from_piconero((xmr(8).as_piconero() + 3) / 4),
+            }
+        );
+    }
+
+    fn unlocked(amount: u64) -> UnspentOutput {
+        UnspentOutput {
+            amount: xmr(amount),
+            unlocked: true,
+        }
+    }
+
+    fn locked(amount: u64) -> UnspentOutput {
+        UnspentOutput {
+            amount: xmr(amount),
+            unlocked: false,
+        }
+    }
+
+    fn xmr(amount: u64) -> Amount {
+        Amount::ONE_XMR * amount
+    }
+}
@@ -0,0 +1,309 @@
+use crate::monero::{Amount, TransferProof, TxHash};
+use ::monero::Address;
+use anyhow::{anyhow, Context, Result};
+use async_trait::async_trait;
+use monero_rpc::wallet;
+use monero_rpc::wallet::MoneroWalletRpc as _;
+use std::sync::{Arc, Mutex, MutexGuard, PoisonError};
+use std::time::Duration;
+use tokio::sync::oneshot;
+
+/// A Monero transaction can have at most 16 outputs, one of them is needed for
+/// the change.
+const MAX_DESTINATIONS_PER_BATCH: usize = 15;
+
+/// Errors of the wallet RPC that are raised before a transaction is built,
+/// hence nothing of a failed batch was sent.
+const NOTHING_SENT_ERRORS: [&str; 2] = ["not enough unlocked money", "not enough money"];
+
+/// Lock transfers that are waiting to be sent together.
+///
+/// The first transfer opens a batch, every transfer requested within the
+/// window joins it. All of them are then sent in a single transaction with one
+/// output per transfer, which pays one fee and locks one change output instead
+/// of one per transfer.
+#[derive(Debug)]
+pub struct TransferBatcher {
+    window: Duration,
+    pending: Mutex<Vec<PendingTransfer>>,
+}
+
+#[derive(Debug)]
+struct PendingTransfer {
+    destination: Address,
+    amount: Amount,
+    proof: oneshot::Sender<Result<TransferProof, String>>,
+}
+
+/// Where the batched transfers are sent from.
+#[async_trait]
+pub trait SendTransfer: Send + Sync + 'static {
+    async fn send(&self, destinations: Vec<wallet::Destination>) -> Result<TransferProof>;
+}
+
+#[async_trait]
+impl SendTransfer for tokio::sync::Mutex<wallet::Client> {
+    async fn send(&self, destinations: Vec<wallet::Destination>) -> Result<TransferProof> {
+        let transfer = self.lock().await.transfer(0, destinations, true).await?;
+
+        Ok(TransferProof::new(
+            TxHash(transfer.tx_hash),
+            transfer
+                .tx_key
+                .context("Missing tx_key in `transfer` response")?,
+        ))
+    }
+}
+
+impl TransferBatcher {
+    pub fn new(window: Duration) -> Self {
+        Self {
+            window,
+            pending: Mutex::new(Vec::new()),
+        }
+    }
+
+    /// Sends `amount` to `destination` together with all other transfers
+    /// requested within the window.
+    ///
+    /// Every transfer of a batch receives the same transaction hash and key,
+    /// the transfer can be verified per destination address with them.
+    pub async fn transfer<C>(
+        self: &Arc<Self>,
+        client: &Arc<C>,
+        destination: Address,
+        amount: Amount,
+    ) -> Result<TransferProof>
+    where
+        C: SendTransfer,
+    {
+        let (sender, receiver) = oneshot::channel();
+
+        let opened_batch = {
+            let mut pending = self.pending();
+            pending.push(PendingTransfer {
+                destination,
+                amount,
+                proof: sender,
+            });
+
+            pending.len() == 1
+        };
+
+        // The batch is sent by its own task, dropping the transfer that opened
+        // it must not hold up the others.
+        if opened_batch {
+            tokio::spawn(send_batch(self.clone(), client.clone()));
+        }
+
+        receiver
+            .await
+            .context("Batched Monero transfer was dropped")?
+            .map_err(|error| anyhow!(error))
+    }
+
+    fn take(&self) -> Vec<PendingTransfer> {
+        std::mem::take(&mut *self.pending())
+    }
+
+    fn pending(&self) -> MutexGuard<'_, Vec<PendingTransfer>> {
+        self.pending.lock().unwrap_or_else(PoisonError::into_inner)
+    }
+}
+
+async fn send_batch<C>(batcher: Arc<TransferBatcher>, client: Arc<C>)
+where
+    C: SendTransfer,
+{
+    tokio::time::sleep(batcher.window).await;
+
+    let mut pending = batcher.take();
+
+    while !pending.is_empty() {
+        let batch = next_batch(&mut pending);
+
+        match transfer(&client, &batch).await {
+            Ok(proof) => {
+                tracing::debug!(
+                    tx_id = %proof.tx_hash(),
+                    transfers = %batch.len(),
+                    "Sent batch of Monero transfers"
+                );
+
+                respond(batch, Ok(proof));
+            }
+            // A single transfer may still fit into the unlocked balance where
+            // the whole batch did not. Any other error may have come after the
+            // transaction was broadcast, sending the transfers again could pay
+            // them twice.
+            Err(error) if batch.len() > 1 && nothing_was_sent(&error) => {
+                tracing::warn!(
+                    transfers = %batch.len(),
+                    "Failed to send batch of Monero transfers, sending them one by one: {:#}",
+                    error
+                );
+
+                for pending_transfer in batch {
+                    let proof = transfer(&client, std::slice::from_ref(&pending_transfer))
+                        .await
+                        .map_err(|error| format!("{:#}", error));
+                    respond(vec![pending_transfer], proof);
+                }
+            }
+            Err(error) => respond(batch, Err(format!("{:#}", error))),
+        }
+    }
+}
+
+/// Splits off as many transfers as fit into one transaction.
+fn next_batch(pending: &mut Vec<PendingTransfer>) -> Vec<PendingTransfer> {
+    let rest = pending.split_off(pending.len().min(MAX_DESTINATIONS_PER_BATCH));
+
+    std::mem::replace(pending, rest)
+}
+
+async fn transfer<C>(client: &C, batch: &[PendingTransfer]) -> Result<TransferProof>
+where
+    C: SendTransfer,
+{
+    let destinations = batch
+        .iter()
+        .map(|transfer| wallet::Destination {
+            amount: transfer.amount.as_piconero(),
+            address: transfer.destination.to_string(),
+        })
+        .collect();
+
+    client.send(destinations).await
+}
+
+fn nothing_was_sent(error: &anyhow::Error) -> bool {
+    error.chain().any(|cause| {
+        let cause = cause.to_string().to_lowercase();
+
+        NOTHING_SENT_ERRORS
+            .iter()
+            .any(|nothing_sent| cause.contains(nothing_sent))
+    })
+}
+
+fn respond(batch: Vec<PendingTransfer>, proof: Result<TransferProof, String>) {
+    for pending_transfer in batch {
+        // The swap may have given up on the transfer in the meantime.
+        let _ = pending_transfer.proof.send(proof.clone());
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::monero::PrivateViewKey;
+    use std::str::FromStr;
+
+    const ADDRESS: &str = "53gEuGZUhP9JMEBZoGaFNzhwEgiG7hwQdMCqFxiyiTeFPmkbt1mAoNybEUvYBKHcnrSgxnVWgZsTvRBaHBNXPa8tHiCU51a";
+
+    #[test]
+    fn batches_do_not_exceed_the_output_limit() {
+        let mut pending = (0..20).map(|_| pending_transfer()).collect::<Vec<_>>();
+
+        assert_eq!(next_batch(&mut pending).len(), MAX_DESTINATIONS_PER_BATCH);
+        assert_eq!(next_batch(&mut pending).len(), 5);
+        assert!(pending.is_empty());
+    }
+
+    #[tokio::test]
+    async fn transfers_within_the_window_are_sent_together() {
+        let batcher = Arc::new(TransferBatcher::new(Duration::from_millis(100)));
+        let wallet = Arc::new(FakeWallet::new(usize::MAX, "timeout"));
+
+        let (first, second) = tokio::join!(
+            batcher.transfer(&wallet, address(), Amount::ONE_XMR),
+            batcher.transfer(&wallet, address(), Amount::ONE_XMR),
+        );
+
+        assert_eq!(first.unwrap().tx_hash(), second.unwrap().tx_hash());
+        assert_eq!(wallet.sent(), vec![2]);
+    }
+
+    #[tokio::test]
+    async fn batch_over_the_unlocked_balance_is_sent_one_by_one() {
+        let batcher = Arc::new(TransferBatcher::new(Duration::from_millis(100)));
+        let wallet = Arc::new(FakeWallet::new(1, "not enough unlocked money"));
+
+        let (first, second) = tokio::join!(
+            batcher.transfer(&wallet, address(), Amount::ONE_XMR),
+            batcher.transfer(&wallet, address(), Amount::ONE_XMR),
+        );
+
+        assert_ne!(first.unwrap().tx_hash(), second.unwrap().tx_hash());
+        assert_eq!(wallet.sent(), vec![1, 1]);
+    }
+
+    #[tokio::test]
+    async fn batch_is_not_sent_again_after_other_errors() {
+        let batcher = Arc::new(TransferBatcher::new(Duration::from_millis(100)));
+        let wallet = Arc::new(FakeWallet::new(1, "error decoding response body"));
+
+        let (first, second) = tokio::join!(
+            batcher.transfer(&wallet, address(), Amount::ONE_XMR),
+            batcher.transfer(&wallet, address(), Amount::ONE_XMR),
+        );
+
+        assert!(first.is_err());
+        assert!(second.is_err());
+        assert!(wallet.sent().is_empty());
+    }
+
+    /// Sends transactions with up to `max_destinations` outputs, and fails
+    /// with `error` on bigger ones.
+    struct FakeWallet {
+        max_destinations: usize,
+        error: &'static str,
+        sent: Mutex<Vec<usize>>,
+    }
+
+    impl FakeWallet {
+        fn new(max_destinations: usize, error: &'static str) -> Self {
+            Self {
+                max_destinations,
+                error,
+                sent: Mutex::default(),
+            }
+        }
+
+        /// The number of destinations of every transaction sent.
+        fn sent(&self) -> Vec<usize> {
+            self.sent.lock().unwrap().clone()
+        }
+    }
+
+    #[async_trait]
+    impl SendTransfer for FakeWallet {
+        async fn send(&self, destinations: Vec<wallet::Destination>) -> Result<TransferProof> {
+            let count = destinations.len();
+            if count > self.max_destinations {
+                anyhow::bail!(self.error)
+            }
+
+            let mut sent = self.sent.lock().unwrap();
+            sent.push(count);
+
+            Ok(TransferProof::new(
+                TxHash(sent.len().to_string()),
+                PrivateViewKey::new_random(&mut rand::thread_rng()).into(),
+            ))
+        }
+    }
+
+    fn pending_transfer() -> PendingTransfer {
+        PendingTransfer {
+            destination: address(),
+            amount: Amount::ONE_XMR,
+            proof: oneshot::channel().0,
+        }
+    }
+
+    fn address() -> Address {
+        Address::from_str(ADDRESS).unwrap()
+    }
+}
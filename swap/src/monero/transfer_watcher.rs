@@ -0,0 +1,473 @@
+use crate::monero::{Amount, InsufficientFunds};
+use ::monero::{Address, PrivateKey};
+use anyhow::Result;
+use monero_rpc::wallet;
+use monero_rpc::wallet::{CheckTxKey, MoneroWalletRpc as _};
+use std::collections::HashMap;
+use std::future::Future;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Mutex, MutexGuard, PoisonError, Weak};
+use std::time::Duration;
+use tokio::sync::watch;
+
+/// Consecutive failed checks of a transfer after which we start to warn.
+const WARN_AFTER_FAILED_CHECKS: u32 = 10;
+
+/// What we last learned about a watched transfer.
+#[derive(Debug, Clone, PartialEq)]
+pub enum TransferStatus {
+    /// The transfer has not been checked yet.
+    Pending,
+    Confirmed {
+        confirmations: u64,
+    },
+    /// The transfer does not pay the expected amount, checking again will not
+    /// change that.
+    InsufficientFunds(InsufficientFunds),
+    /// Checking the transfer failed. This usually resolves itself, e.g. once
+    /// the transaction has propagated to our node.
+    CheckFailed {
+        consecutive_failures: u32,
+        error: String,
+    },
+}
+
+/// All transfers that are waiting for confirmations.
+///
+/// Instead of every swap polling the wallet RPC on its own, the transfers are
+/// checked together, once per Monero block. Each swap receives the updates for
+/// its own transfer through a [`watch`] channel.
+#[derive(Debug, Default)]
+pub struct TransferWatcher {
+    transfers: Mutex<HashMap<u64, WatchedTransfer>>,
+    next_id: AtomicU64,
+}
+
+#[derive(Debug)]
+struct WatchedTransfer {
+    request: CheckRequest,
+    expected: Amount,
+    /// Height of the last successful check, the transfer is only checked again
+    /// once there is a new block.
+    checked_at: Option<u32>,
+    consecutive_failures: u32,
+    status: watch::Sender<TransferStatus>,
+}
+
+#[derive(Debug, Clone, PartialEq)]
+pub struct CheckRequest {
+    pub txid: String,
+    pub tx_key: PrivateKey,
+    pub address: Address,
+}
+
+/// Where watched transfers are checked.
+#[derive(Debug, Clone)]
+pub enum TransferChecker {
+    /// `check_tx_key` of the wallet RPC. The wallet has to be synced and the
+    /// checks queue up behind everything else the wallet does.
+    WalletRpc(Arc<tokio::sync::Mutex<wallet::Client>>),
+    /// Fetches the transactions from monerod and decrypts them locally.
+    Monerod(monero_wallet::Wallet),
+}
+
+impl TransferChecker {
+    async fn block_height(&self) -> Result<u32> {
+        match self {
+            TransferChecker::WalletRpc(client) => {
+                Ok(client.lock().await.get_height().await?.height)
+            }
+            TransferChecker::Monerod(daemon) => daemon.block_height().await,
+        }
+    }
+
+    async fn check_tx_key(&self, request: CheckRequest) -> Result<CheckTxKey> {
+        match self {
+            TransferChecker::WalletRpc(client) => Ok(client
+                .lock()
+                .await
+                .check_tx_key(
+                    request.txid,
+                    request.tx_key.to_string(),
+                    request.address.to_string(),
+                )
+                .await?),
+            TransferChecker::Monerod(daemon) => {
+                daemon
+                    .check_tx_key(&request.txid, request.tx_key, request.address)
+                    .await
+            }
+        }
+    }
+}
+
+impl TransferWatcher {
+    /// Starts watching a transfer until the returned [`Registration`] is
+    /// dropped.
+    pub fn register(
+        self: &Arc<Self>,
+        request: CheckRequest,
+        expected: Amount,
+    ) -> (Registration, watch::Receiver<TransferStatus>) {
+        let id = self.next_id.fetch_add(1, Ordering::Relaxed);
+        let (sender, receiver) = watch::channel(TransferStatus::Pending);
+
+        self.transfers().insert(id, WatchedTransfer {
+            request,
+            expected,
+            checked_at: None,
+            consecutive_failures: 0,
+            status: sender,
+        });
+
+        let registration = Registration {
+            id,
+            watcher: Arc::downgrade(self),
+        };
+
+        (registration, receiver)
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.transfers().is_empty()
+    }
+
+    /// Checks all transfers that have not been checked at the given height yet
+    /// and publishes the outcome to their receivers.
+    pub async fn check_all<F, Fut>(&self, height: u32, check_tx_key: F)
+    where
+        F: Fn(CheckRequest) -> Fut,
+        Fut: Future<Output = Result<CheckTxKey>>,
+    {
+        let due = self
+            .transfers()
+            .iter()
+            .filter(|(_, transfer)| transfer.checked_at != Some(height))
+            .map(|(id, transfer)| (*id, transfer.request.clone()))
+            .collect::<Vec<_>>();
+
+        for (id, request) in due {
+            let response = check_tx_key(request).await;
+
+            // The transfer might have been unregistered in the meantime.
+            if let Some(transfer) = self.transfers().get_mut(&id) {
+                transfer.record(height, response);
+            }
+        }
+    }
+
+    fn transfers(&self) -> MutexGuard<'_, HashMap<u64, WatchedTransfer>> {
+        self.transfers
+            .lock()
+            .unwrap_or_else(PoisonError::into_inner)
+    }
+}
+
+impl WatchedTransfer {
+    fn record(&mut self, height: u32, response: Result<CheckTxKey>) {
+        let status = match response {
+            Ok(tx) => {
+                self.checked_at = Some(height);
+                self.consecutive_failures = 0;
+
+                let received = Amount::from_piconero(tx.received);
+                if received != self.expected {
+                    TransferStatus::InsufficientFunds(InsufficientFunds {
+                        expected: self.expected,
+                        actual: received,
+                    })
+                } else {
+                    TransferStatus::Confirmed {
+                        confirmations: tx.confirmations,
+                    }
+                }
+            }
+            // The jsonrpc client is too primitive to tell apart all the reasons why this can
+            // fail, hence every error is retried with the next check.
+            Err(error) => {
+                self.consecutive_failures += 1;
+
+                TransferStatus::CheckFailed {
+                    consecutive_failures: self.consecutive_failures,
+                    error: format!("{:#}", error),
+                }
+            }
+        };
+
+        let _ = self.status.send(status);
+    }
+}
+
+/// Keeps a transfer registered with the [`TransferWatcher`].
+#[derive(Debug)]
+pub struct Registration {
+    id: u64,
+    watcher: Weak<TransferWatcher>,
+}
+
+impl Drop for Registration {
+    fn drop(&mut self) {
+        if let Some(watcher) = self.watcher.upgrade() {
+            watcher.transfers().remove(&self.id);
+        }
+    }
+}
+
+/// Checks all watched transfers whenever the checker reports a new block,
+/// until the watcher is dropped.
+pub async fn watch_transfers(
+    watcher: Weak<TransferWatcher>,
+    checker: TransferChecker,
+    sync_interval: Duration,
+) {
+    let mut interval = tokio::time::interval(sync_interval);
+
+    loop {
+        interval.tick().await;
+
+        let watcher = match watcher.upgrade() {
+            Some(watcher) => watcher,
+            None => return,
+        };
+
+        if watcher.is_empty() {
+            continue;
+        }
+
+        let height = match checker.block_height().await {
+            Ok(height) => height,
+            Err(error) => {
+                tracing::debug!("Failed to get Monero block height: {:#}", error);
+                continue;
+            }
+        };
+
+        watcher
+            .check_all(height, |request| {
+                let checker = checker.clone();
+
+                async move { checker.check_tx_key(request).await }
+            })
+            .await;
+    }
+}
+
+/// Waits until the watched transfer has reached the given number of
+/// confirmations.
+pub async fn wait_for_confirmations(
+    txid: &str,
+    mut status: watch::Receiver<TransferStatus>,
+    conf_target: u64,
+) -> Result<(), InsufficientFunds> {
+    let mut seen_confirmations = 0u64;
+
+    loop {
+        let current = status.borrow().clone();
+
+        match current {
+            TransferStatus::Pending => {}
+            TransferStatus::Confirmed { confirmations } => {
+                if confirmations > seen_confirmations {
+                    seen_confirmations = confirmations;
+                    tracing::info!(
+                        %txid,
+                        %seen_confirmations,
+                        needed_confirmations = %conf_target,
+                        "Received new confirmation for Monero lock tx"
+                    );
+                }
+            }
+            TransferStatus::InsufficientFunds(insufficient_funds) => {
+                return Err(insufficient_funds)
+            }
+            TransferStatus::CheckFailed {
+                consecutive_failures,
+                error,
+            } if consecutive_failures >= WARN_AFTER_FAILED_CHECKS => {
+                tracing::warn!(
+                    %txid,
+                    %consecutive_failures,
+                    "Failed to retrieve tx from blockchain: {}", error
+                );
+            }
+            TransferStatus::CheckFailed { error, .. } => {
+                tracing::debug!(
+                    %txid,
+                    "Failed to retrieve tx from blockchain: {}", error
+                );
+            }
+        }
+
+        if seen_confirmations >= conf_target {
+            return Ok(());
+        }
+
+        status
+            .changed()
+            .await
+            .expect("transfer to be watched until the registration is dropped");
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use anyhow::anyhow;
+    use std::sync::atomic::AtomicU32;
+
+    #[tokio::test]
+    async fn transfer_is_checked_once_per_block() {
+        let watcher = Arc::new(TransferWatcher::default());
+        let (_registration, status) = watcher.register(request("TXID"), Amount::from_piconero(100));
+        let checks = Arc::new(AtomicU32::new(0));
+
+        for height in vec![1, 1, 1, 2] {
+            watcher
+                .check_all(height, |_| {
+                    let checks = checks.clone();
+
+                    async move {
+                        Ok(CheckTxKey {
+                            confirmations: u64::from(checks.fetch_add(1, Ordering::SeqCst)) + 1,
+                            received: 100,
+                        })
+                    }
+                })
+                .await;
+        }
+
+        assert_eq!(checks.load(Ordering::SeqCst), 2);
+        assert_eq!(*status.borrow(), TransferStatus::Confirmed {
+            confirmations: 2
+        });
+    }
+
+    #[tokio::test]
+    async fn failed_check_is_retried_at_the_same_height() {
+        let watcher = Arc::new(TransferWatcher::default());
+        let (_registration, status) = watcher.register(request("TXID"), Amount::from_piconero(100));
+
+        watcher
+            .check_all(1, |_| async { Err(anyhow!("connection refused")) })
+            .await;
+        assert_eq!(*status.borrow(), TransferStatus::CheckFailed {
+            consecutive_failures: 1,
+            error: "connection refused".to_owned()
+        });
+
+        watcher
+            .check_all(1, |_| async {
+                Ok(CheckTxKey {
+                    confirmations: 1,
+                    received: 100,
+                })
+            })
+            .await;
+        assert_eq!(*status.borrow(), TransferStatus::Confirmed {
+            confirmations: 1
+        });
+    }
+
+    #[tokio::test]
+    async fn all_transfers_are_checked_together() {
+        let watcher = Arc::new(TransferWatcher::default());
+        let (_first, first) = watcher.register(request("FIRST"), Amount::from_piconero(100));
+        let (second_registration, _) =
+            watcher.register(request("SECOND"), Amount::from_piconero(100));
+        let (_third, third) = watcher.register(request("THIRD"), Amount::from_piconero(200));
+        drop(second_registration);
+
+        let checked = Arc::new(Mutex::new(Vec::new()));
+        watcher
+            .check_all(1, |request| {
+                let checked = checked.clone();
+
+                async move {
+                    checked.lock().unwrap().push(request.txid);
+
+                    Ok(CheckTxKey {
+                        confirmations: 1,
+                        received: 100,
+                    })
+                }
+            })
+            .await;
+
+        let mut checked = checked.lock().unwrap().clone();
+        checked.sort();
+        assert_eq!(checked, vec!["FIRST", "THIRD"]);
+        assert_eq!(*first.borrow(), TransferStatus::Confirmed {
+            confirmations: 1
+        });
+        assert!(matches!(
+            *third.borrow(),
+            TransferStatus::InsufficientFunds(_)
+        ));
+    }
+
+    #[tokio::test]
+    async fn given_exact_confirmations_returns_without_waiting() {
+        let (sender, receiver) = watch::channel(TransferStatus::Pending);
+        sender
+            .send(TransferStatus::Confirmed { confirmations: 10 })
+            .unwrap();
+
+        let result = wait_for_confirmations("TXID", receiver, 10).await;
+
+        assert!(result.is_ok())
+    }
+
+    #[tokio::test]
+    async fn given_insufficient_funds_stops_waiting() {
+        let (sender, receiver) = watch::channel(TransferStatus::Pending);
+        let insufficient_funds = InsufficientFunds {
+            expected: Amount::from_piconero(100),
+            actual: Amount::from_piconero(50),
+        };
+
+        let wait = tokio::spawn(wait_for_confirmations("TXID", receiver, 10));
+        sender
+            .send(TransferStatus::InsufficientFunds(insufficient_funds))
+            .unwrap();
+
+        assert!(wait.await.unwrap().is_err())
+    }
+
+    /// A test that allows us to easily, visually verify if the log output is as
+    /// we desire.
+    ///
+    /// We want the following properties:
+    /// - Only print confirmations if they changed i.e. not every time we
+    ///   receive them
+    /// - Also print the last one, i.e. 10 / 10
+    #[tokio::test]
+    async fn visual_log_check() {
+        let _ = tracing_subscriber::fmt().with_test_writer().try_init();
+
+        let (sender, receiver) = watch::channel(TransferStatus::Pending);
+        let wait = tokio::spawn(wait_for_confirmations("TXID", receiver, 10));
+
+        for update in 0..=20u64 {
+            // every 2nd update "yields" a confirmation
+            let _ = sender.send(TransferStatus::Confirmed {
+                confirmations: update / 2,
+            });
+            tokio::task::yield_now().await;
+        }
+
+        assert!(wait.await.unwrap().is_ok())
+    }
+
+    fn request(txid: &str) -> CheckRequest {
+        let tx_key = PrivateKey {
+            scalar: crate::monero::Scalar::one(),
+        };
+        let public_key = ::monero::PublicKey::from_private_key(&tx_key);
+
+        CheckRequest {
+            txid: txid.to_owned(),
+            tx_key,
+            address: Address::standard(::monero::Network::Mainnet, public_key, public_key),
+        }
+    }
+}
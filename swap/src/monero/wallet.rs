@@ -1,25 +1,44 @@
 use crate::env::Config;
+use crate::monero::cache::Cached;
+use crate::monero::transfer_batcher::TransferBatcher;
+use crate::monero::transfer_watcher::{
+    wait_for_confirmations, watch_transfers, CheckRequest, TransferChecker, TransferWatcher,
+};
 use crate::monero::{
-    Amount, InsufficientFunds, PrivateViewKey, PublicViewKey, TransferProof, TxHash,
+    Amount, InsufficientFunds, PrivateViewKey, PublicViewKey, TransferProof, TxHash, WalletRpcPool,
 };
 use ::monero::{Address, Network, PrivateKey, PublicKey};
 use anyhow::{Context, Result};
 use monero_rpc::wallet;
-use monero_rpc::wallet::{BlockHeight, CheckTxKey, MoneroWalletRpc as _, Refreshed};
+use monero_rpc::wallet::{BlockHeight, MoneroWalletRpc as _, Refreshed};
+use std::convert::TryFrom;
 use std::future::Future;
 use std::str::FromStr;
+use std::sync::{Arc, Once};
 use std::time::Duration;
 use tokio::sync::Mutex;
-use tokio::time::Interval;
 use url::Url;
 
+/// How old a block height may be to serve as restore height of a wallet.
+///
+/// An older height only means scanning a few more blocks when the wallet is
+/// restored, it never misses any funds.
+pub const RESTORE_HEIGHT_MAX_AGE: Duration = Duration::from_secs(5 * 60);
+
 #[derive(Debug)]
 pub struct Wallet {
-    inner: Mutex<wallet::Client>,
+    inner: Arc<Mutex<wallet::Client>>,
     network: Network,
     name: String,
     main_address: monero::Address,
+    workers: Option<WalletRpcPool>,
+    daemon: Option<monero_wallet::Wallet>,
+    batcher: Option<Arc<TransferBatcher>>,
+    transfers: Arc<TransferWatcher>,
+    watching_transfers: Once,
     sync_interval: Duration,
+    cached_balance: Cached<Balance>,
+    cached_height: Cached<BlockHeight>,
 }
 
 impl Wallet {
@@ -45,12 +64,20 @@ impl Wallet {
     pub async fn connect(client: wallet::Client, name: String, env_config: Config) -> Result<Self> {
         let main_address =
             monero::Address::from_str(client.get_address(0).await?.address.as_str())?;
+
         Ok(Self {
-            inner: Mutex::new(client),
+            inner: Arc::new(Mutex::new(client)),
             network: env_config.monero_network,
             name,
             main_address,
+            workers: None,
+            daemon: None,
+            batcher: None,
+            transfers: Arc::new(TransferWatcher::default()),
+            watching_transfers: Once::new(),
             sync_interval: env_config.monero_sync_interval(),
+            cached_balance: Cached::default(),
+            cached_height: Cached::default(),
         })
     }
 
@@ -64,111 +91,208 @@ impl Wallet {
         Ok(())
     }
 
-    pub async fn open(&self, filename: String) -> Result<()> {
-        self.inner.lock().await.open_wallet(filename).await?;
-        Ok(())
+    /// Loads wallets generated from keys into the worker processes of the given
+    /// pool, so the main wallet never has to be closed.
+    pub fn with_workers(mut self, workers: WalletRpcPool) -> Self {
+        self.workers = Some(workers);
+        self
+    }
+
+    /// Checks incoming transfers against the given daemon instead of the wallet
+    /// RPC, so they can be verified without waiting for the wallet to sync.
+    /// Generated wallets are restored from the block that contains their funds,
+    /// found by scanning the daemon's blocks.
+    pub fn with_daemon(mut self, daemon: monero_wallet::Wallet) -> Self {
+        self.daemon = Some(daemon);
+        self
+    }
+
+    /// Sends transfers requested within `window` of each other in a single
+    /// transaction.
+    pub fn with_transfer_batching(mut self, window: Duration) -> Self {
+        self.batcher = Some(Arc::new(TransferBatcher::new(window)));
+        self
     }
 
-    /// Close the wallet and open (load) another wallet by generating it from
-    /// keys. The generated wallet will remain loaded.
-    pub async fn create_from_and_load(
+    /// Generate a wallet from keys and sweep all its funds to the
+    /// main_address.
+    ///
+    /// Failing to refresh or sweep the generated wallet is only logged, the
+    /// wallet file stays around and can be swept manually.
+    pub async fn create_from(
         &self,
         file_name: String,
         private_spend_key: PrivateKey,
         private_view_key: PrivateViewKey,
         restore_height: BlockHeight,
     ) -> Result<()> {
-        let public_spend_key = PublicKey::from_private_key(&private_spend_key);
-        let public_view_key = PublicKey::from_private_key(&private_view_key.into());
-
-        let address = Address::standard(self.network, public_spend_key, public_view_key);
-
-        let wallet = self.inner.lock().await;
+        let keys = self
+            .skip_to_funds(GeneratedWallet {
+                file_name,
+                private_spend_key,
+                private_view_key,
+                restore_height,
+            })
+            .await;
+
+        let sweep = |client: wallet::Client| async move {
+            keys.generate(&client, self.network).await?;
+
+            match sweep_all(&client, self.main_address).await {
+                Ok(tx_hashes) => {
+                    for tx in tx_hashes {
+                        tracing::info!(
+                            %tx,
+                            monero_address = %self.main_address,
+                            "Monero transferred back to default wallet");
+                    }
+                    Ok(true)
+                }
+                Err(error) => {
+                    tracing::warn!(
+                        address = %self.main_address,
+                        "Failed to transfer Monero to default wallet: {:#}", error
+                    );
+                    Ok(false)
+                }
+            }
+        };
 
-        // Properly close the wallet before generating the other wallet to ensure that
-        // it saves its state correctly
-        let _ = wallet
-            .close_wallet()
-            .await
-            .context("Failed to close wallet")?;
+        let swept = self.with_generated_wallet(sweep).await?;
 
-        let _ = wallet
-            .generate_from_keys(
-                file_name,
-                address.to_string(),
-                private_spend_key.to_string(),
-                PrivateKey::from(private_view_key).to_string(),
-                restore_height.height,
-                String::from(""),
-                true,
-            )
-            .await
-            .context("Failed to generate new wallet from keys")?;
+        // Only now the main wallet is loaded again, and its lock released.
+        if swept {
+            self.balance_changed().await;
+        }
 
         Ok(())
     }
 
-    /// Close the wallet and open (load) another wallet by generating it from
-    /// keys. The generated wallet will be opened, all funds sweeped to the
-    /// main_address and then the wallet will be re-loaded using the internally
-    /// stored name.
-    pub async fn create_from(
+    /// Generate a wallet from keys, or open it if it was generated before, and
+    /// sweep all its funds to the given address.
+    pub async fn sweep_from(
         &self,
         file_name: String,
         private_spend_key: PrivateKey,
         private_view_key: PrivateViewKey,
         restore_height: BlockHeight,
-    ) -> Result<()> {
-        let public_spend_key = PublicKey::from_private_key(&private_spend_key);
-        let public_view_key = PublicKey::from_private_key(&private_view_key.into());
+        destination: Address,
+    ) -> Result<Vec<TxHash>> {
+        let keys = self
+            .skip_to_funds(GeneratedWallet {
+                file_name,
+                private_spend_key,
+                private_view_key,
+                restore_height,
+            })
+            .await;
+
+        let sweep = |client: wallet::Client| async move {
+            if let Err(error) = keys.generate(&client, self.network).await {
+                // In case we failed to refresh/sweep, when resuming the wallet might already
+                // exist! This is a very unlikely scenario, but if we don't take care of it we
+                // might not be able to ever transfer the Monero.
+                tracing::warn!("Failed to generate monero wallet from keys: {:#}", error);
+                tracing::info!(wallet_file_name = %keys.file_name,
+                    "Falling back to trying to open the the wallet if it already exists",
+                );
+                client.open_wallet(keys.file_name.clone()).await?;
+            }
 
-        let temp_wallet_address =
-            Address::standard(self.network, public_spend_key, public_view_key);
+            sweep_all(&client, destination).await
+        };
 
-        let wallet = self.inner.lock().await;
+        self.with_generated_wallet(sweep).await
+    }
 
-        // Close the default wallet before generating the other wallet to ensure that
-        // it saves its state correctly
-        let _ = wallet.close_wallet().await?;
+    /// Moves the restore height of a generated wallet up to the block that
+    /// contains its funds, so the wallet RPC does not have to scan every block
+    /// since the lock.
+    ///
+    /// The blocks are scanned by the daemon client, if there is none or the
+    /// scan fails, the wallet is restored from the original height.
+    async fn skip_to_funds(&self, mut keys: GeneratedWallet) -> GeneratedWallet {
+        let daemon = match &self.daemon {
+            Some(daemon) => daemon,
+            None => return keys,
+        };
 
-        let _ = wallet
-            .generate_from_keys(
-                file_name,
-                temp_wallet_address.to_string(),
-                private_spend_key.to_string(),
-                PrivateKey::from(private_view_key).to_string(),
-                restore_height.height,
-                String::from(""),
-                true,
+        let found = daemon
+            .find_output(
+                keys.private_view_key.into(),
+                PublicKey::from_private_key(&keys.private_spend_key),
+                keys.restore_height.height,
             )
-            .await?;
+            .await;
 
-        // Try to send all the funds from the generated wallet to the default wallet
-        match wallet.refresh().await {
-            Ok(_) => match wallet.sweep_all(self.main_address.to_string()).await {
-                Ok(sweep_all) => {
-                    for tx in sweep_all.tx_hash_list {
-                        tracing::info!(
-                            %tx,
-                            monero_address = %self.main_address,
-                            "Monero transferred back to default wallet");
-                    }
-                }
-                Err(error) => {
-                    tracing::warn!(
-                        address = %self.main_address,
-                        "Failed to transfer Monero to default wallet: {:#}", error
-                    );
+        match found {
+            Ok(Some(output)) => {
+                tracing::debug!(
+                    txid = %output.txid,
+                    height = %output.height,
+                    "Found funds of generated Monero wallet"
+                );
+
+                if let Ok(height) = u32::try_from(output.height) {
+                    keys.restore_height = BlockHeight { height };
                 }
-            },
+            }
+            Ok(None) => {
+                tracing::debug!(
+                    restore_height = %keys.restore_height.height,
+                    "No funds of generated Monero wallet found since restore height"
+                );
+            }
             Err(error) => {
-                tracing::warn!("Failed to refresh generated wallet: {:#}", error);
+                tracing::warn!(
+                    "Failed to scan for funds of generated Monero wallet: {:#}",
+                    error
+                );
+            }
+        }
+
+        keys
+    }
+
+    /// Runs `action` against a wallet RPC that is free to load another wallet.
+    ///
+    /// With a worker pool, this is one of the workers and the main wallet stays
+    /// open. Otherwise, the main wallet is closed for the duration of
+    /// `action` and re-opened afterwards.
+    async fn with_generated_wallet<F, Fut, T>(&self, action: F) -> Result<T>
+    where
+        F: FnOnce(wallet::Client) -> Fut,
+        Fut: Future<Output = Result<T>>,
+    {
+        if let Some(workers) = &self.workers {
+            let worker = workers.acquire().await?;
+            let result = action(worker.client().clone()).await;
+
+            if let Err(error) = worker.client().close_wallet().await {
+                tracing::warn!(
+                    "Failed to close wallet on monero-wallet-rpc worker: {:#}",
+                    error
+                );
+                worker.retire();
             }
+
+            return result;
         }
 
+        let wallet = self.inner.lock().await;
+
+        // Properly close the wallet before generating the other wallet to ensure that
+        // it saves its state correctly
+        let _ = wallet
+            .close_wallet()
+            .await
+            .context("Failed to close wallet")?;
+
+        let result = action(wallet.clone()).await;
+
         let _ = wallet.open_wallet(self.name.clone()).await?;
 
-        Ok(())
+        result
     }
 
     pub async fn transfer(&self, request: TransferRequest) -> Result<TransferProof> {
@@ -181,25 +305,38 @@ impl Wallet {
         let destination_address =
             Address::standard(self.network, public_spend_key, public_view_key.into());
 
-        let res = self
-            .inner
-            .lock()
-            .await
-            .transfer_single(0, amount.as_piconero(), &destination_address.to_string())
-            .await?;
+        let transfer_proof = match &self.batcher {
+            Some(batcher) => {
+                batcher
+                    .transfer(&self.inner, destination_address, amount)
+                    .await?
+            }
+            None => {
+                let res = self
+                    .inner
+                    .lock()
+                    .await
+                    .transfer_single(0, amount.as_piconero(), &destination_address.to_string())
+                    .await?;
+
+                TransferProof::new(
+                    TxHash(res.tx_hash),
+                    res.tx_key
+                        .context("Missing tx_key in `transfer` response")?,
+                )
+            }
+        };
 
         tracing::debug!(
             %amount,
             to = %public_spend_key,
-            tx_id = %res.tx_hash,
+            tx_id = %transfer_proof.tx_hash(),
             "Successfully initiated Monero transfer"
         );
 
-        Ok(TransferProof::new(
-            TxHash(res.tx_hash),
-            res.tx_key
-                .context("Missing tx_key in `transfer` response")?,
-        ))
+        self.balance_changed().await;
+
+        Ok(transfer_proof)
     }
 
     pub async fn watch_for_transfer(&self, request: WatchRequest) -> Result<(), InsufficientFunds> {
@@ -221,29 +358,29 @@ impl Wallet {
 
         let address = Address::standard(self.network, public_spend_key, public_view_key.into());
 
-        let check_interval = tokio::time::interval(self.sync_interval);
-        let key = transfer_proof.tx_key().to_string();
-
-        wait_for_confirmations(
-            txid.0,
-            move |txid| {
-                let key = key.clone();
-                async move {
-                    Ok(self
-                        .inner
-                        .lock()
-                        .await
-                        .check_tx_key(txid, key, address.to_string())
-                        .await?)
-                }
+        self.watching_transfers.call_once(|| {
+            let checker = match &self.daemon {
+                Some(daemon) => TransferChecker::Monerod(daemon.clone()),
+                None => TransferChecker::WalletRpc(self.inner.clone()),
+            };
+
+            tokio::spawn(watch_transfers(
+                Arc::downgrade(&self.transfers),
+                checker,
+                self.sync_interval,
+            ));
+        });
+
+        let (_registration, status) = self.transfers.register(
+            CheckRequest {
+                txid: txid.0.clone(),
+                tx_key: transfer_proof.tx_key(),
+                address,
             },
-            check_interval,
             expected,
-            conf_target,
-        )
-        .await?;
+        );
 
-        Ok(())
+        wait_for_confirmations(&txid.0, status, conf_target).await
     }
 
     pub async fn sweep_all(&self, address: Address) -> Result<Vec<TxHash>> {
@@ -254,19 +391,112 @@ impl Wallet {
             .sweep_all(address.to_string())
             .await?;
 
+        self.balance_changed().await;
+
         let tx_hashes = sweep_all.tx_hash_list.into_iter().map(TxHash).collect();
         Ok(tx_hashes)
     }
 
     /// Get the balance of the primary account.
     pub async fn get_balance(&self) -> Result<Amount> {
-        let amount = self.inner.lock().await.get_balance(0).await?.balance;
+        Ok(self.balance(Duration::ZERO).await?.total)
+    }
+
+    /// Get the part of the primary account's balance that can be spent right
+    /// now, i.e. without the outputs that are still locked.
+    pub async fn get_unlocked_balance(&self) -> Result<Amount> {
+        Ok(self.balance(Duration::ZERO).await?.unlocked)
+    }
+
+    /// The balance of the primary account, served from the cache if it was
+    /// read less than `max_age` ago.
+    pub async fn balance(&self, max_age: Duration) -> Result<Balance> {
+        if let Some(balance) = self.cached_balance.get(max_age) {
+            return Ok(balance);
+        }
+
+        let response = self.inner.lock().await.get_balance(0).await?;
+        let balance = Balance {
+            total: Amount::from_piconero(response.balance),
+            unlocked: Amount::from_piconero(response.unlocked_balance),
+        };
+        self.cached_balance.set(balance);
+
+        Ok(balance)
+    }
+
+    /// Reads the balance and block height into the cache.
+    pub async fn refresh_cache(&self) -> Result<Balance> {
+        let balance = self.balance(Duration::ZERO).await?;
+        let _ = self.recent_block_height(Duration::ZERO).await?;
+
+        Ok(balance)
+    }
+
+    /// Reads the balance after we spent or received Monero, failing to do so
+    /// only leaves the cache to expire.
+    async fn balance_changed(&self) {
+        if let Err(error) = self.balance(Duration::ZERO).await {
+            tracing::debug!("Failed to refresh Monero balance: {:#}", error);
+        }
+    }
+
+    /// The unspent outputs of the primary account.
+    pub async fn unspent_outputs(&self) -> Result<Vec<UnspentOutput>> {
+        let incoming = self
+            .inner
+            .lock()
+            .await
+            .incoming_transfers("available".to_owned(), 0)
+            .await?;
+
+        Ok(incoming
+            .transfers
+            .into_iter()
+            .filter(|transfer| !transfer.spent)
+            .map(|transfer| UnspentOutput {
+                amount: Amount::from_piconero(transfer.amount),
+                unlocked: transfer.unlocked,
+            })
+            .collect())
+    }
+
+    /// Sends `count` outputs of `amount` to the main address.
+    pub async fn split_outputs(&self, count: usize, amount: Amount) -> Result<TxHash> {
+        let destinations = (0..count)
+            .map(|_| wallet::Destination {
+                amount: amount.as_piconero(),
+                address: self.main_address.to_string(),
+            })
+            .collect();
+
+        let transfer = self
+            .inner
+            .lock()
+            .await
+            .transfer(0, destinations, true)
+            .await?;
 
-        Ok(Amount::from_piconero(amount))
+        self.balance_changed().await;
+
+        Ok(TxHash(transfer.tx_hash))
     }
 
     pub async fn block_height(&self) -> Result<BlockHeight> {
-        Ok(self.inner.lock().await.get_height().await?)
+        self.recent_block_height(Duration::ZERO).await
+    }
+
+    /// The block height of the wallet, served from the cache if it was read
+    /// less than `max_age` ago.
+    pub async fn recent_block_height(&self, max_age: Duration) -> Result<BlockHeight> {
+        if let Some(height) = self.cached_height.get(max_age) {
+            return Ok(height);
+        }
+
+        let height = self.inner.lock().await.get_height().await?;
+        self.cached_height.set(height);
+
+        Ok(height)
     }
 
     pub fn get_main_address(&self) -> Address {
@@ -278,6 +508,51 @@ impl Wallet {
     }
 }
 
+/// A wallet restored from the keys of a shared Monero output.
+struct GeneratedWallet {
+    file_name: String,
+    private_spend_key: PrivateKey,
+    private_view_key: PrivateViewKey,
+    restore_height: BlockHeight,
+}
+
+impl GeneratedWallet {
+    /// Generates the wallet and loads it into the given wallet RPC.
+    async fn generate(&self, client: &wallet::Client, network: Network) -> Result<()> {
+        let public_spend_key = PublicKey::from_private_key(&self.private_spend_key);
+        let public_view_key = PublicKey::from_private_key(&self.private_view_key.into());
+
+        let address = Address::standard(network, public_spend_key, public_view_key);
+
+        let _ = client
+            .generate_from_keys(
+                self.file_name.clone(),
+                address.to_string(),
+                self.private_spend_key.to_string(),
+                PrivateKey::from(self.private_view_key).to_string(),
+                self.restore_height.height,
+                String::from(""),
+                true,
+            )
+            .await
+            .context("Failed to generate new wallet from keys")?;
+
+        Ok(())
+    }
+}
+
+/// Refreshes the wallet loaded into the given wallet RPC and sweeps all its
+/// funds to the given address.
+async fn sweep_all(client: &wallet::Client, address: Address) -> Result<Vec<TxHash>> {
+    let _ = client
+        .refresh()
+        .await
+        .context("Failed to refresh generated wallet")?;
+    let sweep_all = client.sweep_all(address.to_string()).await?;
+
+    Ok(sweep_all.tx_hash_list.into_iter().map(TxHash).collect())
+}
+
 #[derive(Debug)]
 pub struct TransferRequest {
     pub public_spend_key: PublicKey,
@@ -285,6 +560,20 @@ pub struct TransferRequest {
     pub amount: Amount,
 }
 
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct Balance {
+    pub total: Amount,
+    /// The part of the balance that can be spent right now.
+    pub unlocked: Amount,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct UnspentOutput {
+    pub amount: Amount,
+    /// Whether the output has enough confirmations to be spent.
+    pub unlocked: bool,
+}
+
 #[derive(Debug)]
 pub struct WatchRequest {
     pub public_spend_key: PublicKey,
@@ -294,131 +583,162 @@ pub struct WatchRequest {
     pub expected: Amount,
 }
 
-async fn wait_for_confirmations<Fut>(
-    txid: String,
-    fetch_tx: impl Fn(String) -> Fut,
-    mut check_interval: Interval,
-    expected: Amount,
-    conf_target: u64,
-) -> Result<(), InsufficientFunds>
-where
-    Fut: Future<Output = Result<CheckTxKey>>,
-{
-    let mut seen_confirmations = 0u64;
-
-    while seen_confirmations < conf_target {
-        check_interval.tick().await; // tick() at the beginning of the loop so every `continue` tick()s as well
-
-        let tx = match fetch_tx(txid.clone()).await {
-            Ok(proof) => proof,
-            Err(error) => {
-                tracing::debug!(
-                    %txid,
-                    "Failed to retrieve tx from blockchain: {:#}", error
-                );
-                continue; // treating every error as transient and retrying
-                          // is obviously wrong but the jsonrpc client is
-                          // too primitive to differentiate between all the
-                          // cases
-            }
-        };
-
-        let received = Amount::from_piconero(tx.received);
-
-        if received != expected {
-            return Err(InsufficientFunds {
-                expected,
-                actual: received,
-            });
-        }
-
-        if tx.confirmations > seen_confirmations {
-            seen_confirmations = tx.confirmations;
-            tracing::info!(
-                %txid,
-                %seen_confirmations,
-                needed_confirmations = %conf_target,
-                "Received new confirmation for Monero lock tx"
-            );
-        }
-    }
-
-    Ok(())
-}
-
 #[cfg(test)]
 mod tests {
     use super::*;
-    use monero_rpc::wallet::CheckTxKey;
-    use std::sync::atomic::{AtomicU32, AtomicU64, Ordering};
-    use std::sync::Arc;
+    use crate::env::{GetConfig, Regtest};
+    use serde_json::{json, Value};
+    use std::sync::Mutex as SyncMutex;
+    use tokio::io::{AsyncBufReadExt, AsyncReadExt, AsyncWriteExt, BufReader};
+    use tokio::net::{TcpListener, TcpStream};
 
     #[tokio::test]
-    async fn given_exact_confirmations_does_not_fetch_tx_again() {
-        let requests = Arc::new(AtomicU32::new(0));
+    async fn sweeps_generated_wallet_without_workers() {
+        let rpc = StandIn::start("main").await;
+        let wallet = Wallet::connect(
+            wallet::Client::localhost(rpc.port).unwrap(),
+            "main".to_owned(),
+            Regtest::get_config(),
+        )
+        .await
+        .unwrap();
+
+        tokio::time::timeout(
+            Duration::from_secs(10),
+            wallet.create_from(
+                "generated".to_owned(),
+                random_private_key(),
+                PrivateViewKey::new_random(&mut rand::thread_rng()),
+                BlockHeight { height: 0 },
+            ),
+        )
+        .await
+        .expect("Sweeping the generated wallet never finished")
+        .unwrap();
+
+        let state = rpc.state();
+        assert_eq!(state.loaded.as_deref(), Some("main"));
+        assert_eq!(state.balance_read_from, vec![Some("main".to_owned())]);
+    }
 
-        let result = wait_for_confirmations(
-            String::from("TXID"),
-            move |_| {
-                let requests = requests.clone();
+    fn random_private_key() -> PrivateKey {
+        PrivateViewKey::new_random(&mut rand::thread_rng()).into()
+    }
+
+    #[derive(Debug, Clone, Default)]
+    struct State {
+        /// The wallet currently loaded into the wallet RPC.
+        loaded: Option<String>,
+        /// The wallet that was loaded for each balance request.
+        balance_read_from: Vec<Option<String>>,
+    }
 
+    /// Answers the wallet RPC requests involved in sweeping a generated
+    /// wallet, keeping track of which wallet is loaded.
+    struct StandIn {
+        port: u16,
+        state: Arc<SyncMutex<State>>,
+    }
+
+    impl StandIn {
+        async fn start(loaded: &str) -> Self {
+            let listener = TcpListener::bind("127.0.0.1:0").await.unwrap();
+            let port = listener.local_addr().unwrap().port();
+            let state = Arc::new(SyncMutex::new(State {
+                loaded: Some(loaded.to_owned()),
+                ..State::default()
+            }));
+
+            tokio::spawn({
+                let state = state.clone();
                 async move {
-                    match requests.fetch_add(1, Ordering::SeqCst) {
-                        0 => Ok(CheckTxKey {
-                            confirmations: 10,
-                            received: 100,
-                        }),
-                        _ => panic!("should not be called more than once"),
+                    while let Ok((stream, _)) = listener.accept().await {
+                        tokio::spawn(respond(stream, state.clone()));
                     }
                 }
-            },
-            tokio::time::interval(Duration::from_millis(10)),
-            Amount::from_piconero(100),
-            10,
-        )
-        .await;
+            });
+
+            Self { port, state }
+        }
 
-        assert!(result.is_ok())
+        fn state(&self) -> State {
+            self.state.lock().unwrap().clone()
+        }
     }
 
-    /// A test that allows us to easily, visually verify if the log output is as
-    /// we desire.
-    ///
-    /// We want the following properties:
-    /// - Only print confirmations if they changed i.e. not every time we
-    ///   request them
-    /// - Also print the last one, i.e. 10 / 10
-    #[tokio::test]
-    async fn visual_log_check() {
-        let _ = tracing_subscriber::fmt().with_test_writer().try_init();
-        const MAX_REQUESTS: u64 = 20;
+    async fn respond(mut stream: TcpStream, state: Arc<SyncMutex<State>>) {
+        let mut reader = BufReader::new(&mut stream);
+        let mut content_length = 0;
+        loop {
+            let mut line = String::new();
+            reader.read_line(&mut line).await.unwrap();
+            let line = line.trim_end().to_lowercase();
+            if line.is_empty() {
+                break;
+            }
+            if let Some(value) = line.strip_prefix("content-length: ") {
+                content_length = value.parse().unwrap();
+            }
+        }
+        let mut body = vec![0; content_length];
+        reader.read_exact(&mut body).await.unwrap();
 
-        let requests = Arc::new(AtomicU64::new(0));
+        let request: Value = serde_json::from_slice(&body).unwrap();
+        let result = answer(&request, &mut state.lock().unwrap());
+        let response = json!({ "jsonrpc": "2.0", "id": request["id"], "result": result });
+        let response = response.to_string();
 
-        let result = wait_for_confirmations(
-            String::from("TXID"),
-            move |_| {
-                let requests = requests.clone();
+        let head = format!(
+            "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: {}\r\nConnection: close\r\n\r\n",
+            response.len()
+        );
+        stream.write_all(head.as_bytes()).await.unwrap();
+        stream.write_all(response.as_bytes()).await.unwrap();
+    }
 
-                async move {
-                    match requests.fetch_add(1, Ordering::SeqCst) {
-                        requests if requests <= MAX_REQUESTS => {
-                            Ok(CheckTxKey {
-                                confirmations: requests / 2, /* every 2nd request "yields" a
-                                                              * confirmation */
-                                received: 100,
-                            })
-                        }
-                        _ => panic!("should not be called more than {} times", MAX_REQUESTS),
-                    }
-                }
-            },
-            tokio::time::interval(Duration::from_millis(10)),
-            Amount::from_piconero(100),
-            10,
-        )
-        .await;
+    fn answer(request: &Value, state: &mut State) -> Value {
+        let params = &request["params"];
+        match request["method"].as_str().unwrap() {
+            "get_address" => json!({ "address": main_address().to_string() }),
+            "open_wallet" => {
+                state.loaded = params["filename"].as_str().map(ToOwned::to_owned);
+                json!({})
+            }
+            "close_wallet" => {
+                state.loaded = None;
+                json!({})
+            }
+            "generate_from_keys" => {
+                state.loaded = params["filename"].as_str().map(ToOwned::to_owned);
+                json!({ "address": params["address"], "info": "" })
+            }
+            "refresh" => json!({ "blocks_fetched": 0, "received_money": true }),
+            "sweep_all" => json!({
+                "amount_list": [1_000_000],
+                "fee_list": [1_000],
+                "multisig_txset": "",
+                "tx_hash_list": ["0000000000000000000000000000000000000000000000000000000000000000"],
+                "unsigned_txset": "",
+                "weight_list": [1_500]
+            }),
+            "get_balance" => {
+                state.balance_read_from.push(state.loaded.clone());
+                json!({
+                    "balance": 1_000_000,
+                    "blocks_to_unlock": 10,
+                    "multisig_import_needed": false,
+                    "time_to_unlock": 0,
+                    "unlocked_balance": 0
+                })
+            }
+            method => panic!("Unexpected wallet RPC method {}", method),
+        }
+    }
+
+    fn main_address() -> Address {
+        let spend_key = PublicKey::from_private_key(&random_private_key());
+        let view_key = PublicKey::from_private_key(&random_private_key());
 
-        assert!(result.is_ok())
+        Address::standard(Network::Mainnet, spend_key, view_key)
     }
 }
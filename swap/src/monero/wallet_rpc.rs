@@ -1,24 +1,23 @@
+use crate::fs::system_cache_dir;
 use ::monero::Network;
 use anyhow::{Context, Result};
-use big_bytes::BigByte;
-use futures::{StreamExt, TryStreamExt};
 use monero_rpc::wallet::{Client, MoneroWalletRpc as _};
-use reqwest::header::CONTENT_LENGTH;
 use reqwest::Url;
-use std::io::ErrorKind;
 use std::path::{Path, PathBuf};
 use std::process::Stdio;
-use tokio::fs::{remove_file, OpenOptions};
-use tokio::io::{AsyncBufReadExt, AsyncWriteExt, BufReader};
+use tokio::fs::remove_file;
+use tokio::io::{AsyncBufReadExt, BufReader};
 use tokio::process::{Child, Command};
-use tokio_util::codec::{BytesCodec, FramedRead};
-use tokio_util::io::StreamReader;
+
+mod download;
+
+pub use download::Release;
 
 #[cfg(not(any(target_os = "macos", target_os = "linux", target_os = "windows")))]
 compile_error!("unsupported operating system");
 
 #[cfg(target_os = "macos")]
-const DOWNLOAD_URL: &str = "http://downloads.getmonero.org/cli/monero-mac-x64-v0.17.2.0.tar.bz2";
+const DOWNLOAD_URL: &str = "https://downloads.getmonero.org/cli/monero-mac-x64-v0.17.2.0.tar.bz2";
 
 #[cfg(all(target_os = "linux", target_arch = "x86_64"))]
 const DOWNLOAD_URL: &str = "https://downloads.getmonero.org/cli/monero-linux-x64-v0.17.2.0.tar.bz2";
@@ -30,6 +29,22 @@ const DOWNLOAD_URL: &str =
 #[cfg(target_os = "windows")]
 const DOWNLOAD_URL: &str = "https://downloads.getmonero.org/cli/monero-win-x64-v0.17.2.0.zip";
 
+// SHA-256 of the archive at `DOWNLOAD_URL`, as published in the signed
+// hashes.txt of the release. Every supported target must have one, downloads
+// without a digest are refused.
+
+#[cfg(target_os = "macos")]
+const DOWNLOAD_SHA256: &str = "";
+
+#[cfg(all(target_os = "linux", target_arch = "x86_64"))]
+const DOWNLOAD_SHA256: &str = "59e16c53b2aff8d9ab7a8ba3279ee826ac1f2480fbb98e79a149e6be23dd9086";
+
+#[cfg(all(target_os = "linux", target_arch = "arm"))]
+const DOWNLOAD_SHA256: &str = "";
+
+#[cfg(target_os = "windows")]
+const DOWNLOAD_SHA256: &str = "";
+
 #[cfg(any(target_os = "macos", target_os = "linux"))]
 const PACKED_FILE: &str = "monero-wallet-rpc";
 
@@ -40,6 +55,7 @@ const PACKED_FILE: &str = "monero-wallet-rpc.exe";
 #[error("monero wallet rpc executable not found in downloaded archive")]
 pub struct ExecutableNotFoundInArchive;
 
+#[derive(Debug)]
 pub struct WalletRpcProcess {
     _child: Child,
     port: u16,
@@ -52,72 +68,44 @@ impl WalletRpcProcess {
     }
 }
 
+#[derive(Debug)]
 pub struct WalletRpc {
     working_dir: PathBuf,
+    exec_path: PathBuf,
 }
 
 impl WalletRpc {
+    /// Prepares the given working directory for monero-wallet-rpc processes,
+    /// downloading the executable into the shared cache directory if needed.
     pub async fn new(working_dir: impl AsRef<Path>) -> Result<WalletRpc> {
+        Self::with_cache(working_dir, system_cache_dir()?, &release()?).await
+    }
+
+    /// Like [`WalletRpc::new`], with the executable of `release` in
+    /// `cache_dir`.
+    pub async fn with_cache(
+        working_dir: impl AsRef<Path>,
+        cache_dir: impl AsRef<Path>,
+        release: &Release,
+    ) -> Result<WalletRpc> {
         let working_dir = working_dir.as_ref();
 
         if !working_dir.exists() {
             tokio::fs::create_dir(working_dir).await?;
         }
 
-        let monero_wallet_rpc = WalletRpc {
-            working_dir: working_dir.to_path_buf(),
-        };
-
-        if monero_wallet_rpc.archive_path().exists() {
-            remove_file(monero_wallet_rpc.archive_path()).await?;
+        // Left behind by versions that downloaded into the working directory.
+        let legacy_archive_path = working_dir.join("monero-cli-wallet.archive");
+        if legacy_archive_path.exists() {
+            remove_file(legacy_archive_path).await?;
         }
 
-        if !monero_wallet_rpc.exec_path().exists() {
-            let mut options = OpenOptions::new();
-            let mut file = options
-                .read(true)
-                .write(true)
-                .create_new(true)
-                .open(monero_wallet_rpc.archive_path())
-                .await?;
-
-            let response = reqwest::get(DOWNLOAD_URL).await?;
-
-            let content_length = response.headers()[CONTENT_LENGTH]
-                .to_str()
-                .context("Failed to convert content-length to string")?
-                .parse::<u64>()?;
-
-            tracing::info!(
-                "Downloading monero-wallet-rpc ({}) from {}",
-                content_length.big_byte(2),
-                DOWNLOAD_URL
-            );
-
-            let byte_stream = response
-                .bytes_stream()
-                .map_err(|err| std::io::Error::new(ErrorKind::Other, err));
-
-            #[cfg(not(target_os = "windows"))]
-            let mut stream = FramedRead::new(
-                async_compression::tokio::bufread::BzDecoder::new(StreamReader::new(byte_stream)),
-                BytesCodec::new(),
-            )
-            .map_ok(|bytes| bytes.freeze());
-
-            #[cfg(target_os = "windows")]
-            let mut stream = FramedRead::new(StreamReader::new(byte_stream), BytesCodec::new())
-                .map_ok(|bytes| bytes.freeze());
-
-            while let Some(chunk) = stream.next().await {
-                file.write(&chunk?).await?;
-            }
-
-            file.flush().await?;
+        let exec_path = download::cached_executable(cache_dir.as_ref(), release).await?;
 
-            Self::extract_archive(&monero_wallet_rpc).await?;
-        }
-        Ok(monero_wallet_rpc)
+        Ok(WalletRpc {
+            working_dir: working_dir.to_path_buf(),
+            exec_path,
+        })
     }
 
     pub async fn run(&self, network: Network, daemon_address: &str) -> Result<WalletRpcProcess> {
@@ -143,7 +131,7 @@ impl WalletRpc {
             }
         };
 
-        let mut child = Command::new(self.exec_path())
+        let mut child = Command::new(&self.exec_path)
             .env("LANG", "en_AU.UTF-8")
             .stdout(Stdio::piped())
             .kill_on_drop(true)
@@ -188,79 +176,31 @@ impl WalletRpc {
             port,
         })
     }
+}
 
-    fn archive_path(&self) -> PathBuf {
-        self.working_dir.join("monero-cli-wallet.archive")
-    }
-
-    fn exec_path(&self) -> PathBuf {
-        self.working_dir.join(PACKED_FILE)
-    }
-
-    #[cfg(not(target_os = "windows"))]
-    async fn extract_archive(monero_wallet_rpc: &Self) -> Result<()> {
-        use anyhow::bail;
-        use tokio_tar::Archive;
-
-        let mut options = OpenOptions::new();
-        let file = options
-            .read(true)
-            .open(monero_wallet_rpc.archive_path())
-            .await?;
-
-        let mut ar = Archive::new(file);
-        let mut entries = ar.entries()?;
-
-        loop {
-            match entries.next().await {
-                Some(file) => {
-                    let mut f = file?;
-                    if f.path()?
-                        .to_str()
-                        .context("Could not find convert path to str in tar ball")?
-                        .contains(PACKED_FILE)
-                    {
-                        f.unpack(monero_wallet_rpc.exec_path()).await?;
-                        break;
-                    }
-                }
-                None => bail!(ExecutableNotFoundInArchive),
-            }
-        }
-
-        remove_file(monero_wallet_rpc.archive_path()).await?;
-
-        Ok(())
-    }
-
-    #[cfg(target_os = "windows")]
-    async fn extract_archive(monero_wallet_rpc: &Self) -> Result<()> {
-        use std::fs::File;
-        use tokio::task::JoinHandle;
-        use zip::ZipArchive;
-
-        let archive_path = monero_wallet_rpc.archive_path();
-        let exec_path = monero_wallet_rpc.exec_path();
-
-        let extract: JoinHandle<Result<()>> = tokio::task::spawn_blocking(|| {
-            let file = File::open(archive_path)?;
-            let mut zip = ZipArchive::new(file)?;
-
-            let name = zip
-                .file_names()
-                .find(|name| name.contains(PACKED_FILE))
-                .context(ExecutableNotFoundInArchive)?
-                .to_string();
-
-            let mut rpc = zip.by_name(&name)?;
-            let mut file = File::create(exec_path)?;
-            std::io::copy(&mut rpc, &mut file)?;
-            Ok(())
-        });
-        extract.await??;
-
-        remove_file(monero_wallet_rpc.archive_path()).await?;
+/// The release of the Monero CLI tools for this platform.
+fn release() -> Result<Release> {
+    Ok(Release {
+        url: DOWNLOAD_URL
+            .parse()
+            .context("Failed to parse monero-wallet-rpc download URL")?,
+        sha256: DOWNLOAD_SHA256.to_owned(),
+    })
+}
 
-        Ok(())
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn download_digest_is_pinned_for_target() {
+        assert!(
+            DOWNLOAD_SHA256.len() == 64
+                && DOWNLOAD_SHA256
+                    .chars()
+                    .all(|c| c.is_ascii_digit() || ('a'..='f').contains(&c)),
+            "No SHA-256 pinned for {}",
+            DOWNLOAD_URL
+        );
     }
 }
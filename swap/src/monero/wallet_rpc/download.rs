@@ -0,0 +1,523 @@
+//! Downloads a release archive of the Monero CLI tools into a cache directory
+//! and unpacks the monero-wallet-rpc from it.
+//!
+//! Interrupted downloads are resumed with a range request. On Linux and macOS
+//! the archive is decompressed and unpacked while it is still downloading,
+//! the zip archives for Windows can only be unpacked once they are complete.
+//!
+//! Processes sharing the cache take turns through a lock file in the
+//! directory of the release, so only one of them downloads it.
+
+use super::{ExecutableNotFoundInArchive, PACKED_FILE};
+use anyhow::{bail, Context, Result};
+use big_bytes::BigByte;
+use data_encoding::HEXLOWER;
+use fs2::FileExt;
+use futures::StreamExt;
+use reqwest::header::RANGE;
+use reqwest::{StatusCode, Url};
+use sha2::{Digest, Sha256};
+use std::path::{Path, PathBuf};
+use tokio::fs::{remove_file, rename, File, OpenOptions};
+use tokio::io::{AsyncReadExt, AsyncWriteExt};
+
+/// A release archive of the Monero CLI tools.
+#[derive(Debug, Clone, PartialEq)]
+pub struct Release {
+    pub url: Url,
+    /// SHA-256 digest of the archive, hex encoded. The archive is only
+    /// unpacked if it matches.
+    pub sha256: String,
+}
+
+impl Release {
+    /// Name of the archive, without the extension.
+    fn name(&self) -> Result<&str> {
+        let file_name = self
+            .url
+            .path_segments()
+            .and_then(|segments| segments.last())
+            .filter(|name| !name.is_empty())
+            .context("Download URL does not point to a file")?;
+
+        Ok(file_name
+            .trim_end_matches(".tar.bz2")
+            .trim_end_matches(".zip"))
+    }
+}
+
+/// Returns the path of the monero-wallet-rpc of `release` in `cache_dir`,
+/// downloading it first if it is not there yet.
+///
+/// Every release gets its own sub-directory, so several data directories and
+/// versions of the software share the cache.
+pub async fn cached_executable(cache_dir: &Path, release: &Release) -> Result<PathBuf> {
+    let release_dir = cache_dir.join(release.name()?);
+    let exec_path = release_dir.join(PACKED_FILE);
+
+    if exec_path.exists() {
+        return Ok(exec_path);
+    }
+
+    tokio::fs::create_dir_all(&release_dir).await?;
+
+    // Released when dropped, or by the OS if the process dies.
+    let _lock = lock_exclusive(release_dir.join("download.lock")).await?;
+
+    // Downloaded by another process while we were waiting for the lock.
+    if exec_path.exists() {
+        return Ok(exec_path);
+    }
+
+    if release.sha256.is_empty() {
+        bail!(
+            "No SHA-256 is pinned for {}, refusing to download it. Put a verified monero-wallet-rpc at {}",
+            release.url,
+            exec_path.display()
+        )
+    }
+
+    let archive_path = release_dir.join("archive.partial");
+    let unverified_path = release_dir.join(format!("{}.unverified", PACKED_FILE));
+
+    // Left behind by an earlier attempt, the unpacking starts over as well.
+    let _ = remove_file(&unverified_path).await;
+    let sha256 = download(release, &archive_path, &unverified_path).await?;
+
+    if !sha256.eq_ignore_ascii_case(&release.sha256) {
+        // Starting over is the only way to get rid of corrupted bytes.
+        remove_file(&archive_path).await?;
+        let _ = remove_file(&unverified_path).await;
+
+        bail!(
+            "Downloaded monero-wallet-rpc archive has SHA-256 {} instead of {}",
+            sha256,
+            release.sha256
+        )
+    }
+
+    #[cfg(target_os = "windows")]
+    unpack_zip(&archive_path, &unverified_path).await?;
+
+    rename(&unverified_path, &exec_path).await?;
+    remove_file(&archive_path).await?;
+
+    Ok(exec_path)
+}
+
+/// Waits until no other process holds the lock file at `path`.
+async fn lock_exclusive(path: PathBuf) -> Result<std::fs::File> {
+    tokio::task::spawn_blocking(move || {
+        let file = std::fs::OpenOptions::new()
+            .create(true)
+            .write(true)
+            .open(&path)
+            .with_context(|| format!("Failed to open {}", path.display()))?;
+        file.lock_exclusive()
+            .with_context(|| format!("Failed to lock {}", path.display()))?;
+
+        Ok(file)
+    })
+    .await?
+}
+
+/// Downloads the archive, continuing after the bytes that are already in
+/// `archive_path`, and returns its SHA-256.
+async fn download(release: &Release, archive_path: &Path, unpack_path: &Path) -> Result<String> {
+    let mut archive = OpenOptions::new()
+        .create(true)
+        .append(true)
+        .open(archive_path)
+        .await?;
+    let mut downloaded = archive.metadata().await?.len();
+
+    let client = reqwest::Client::new();
+    let mut response = request(&client, &release.url, downloaded).await?;
+
+    match response.status() {
+        StatusCode::PARTIAL_CONTENT => {}
+        // The server ignored the range or the partial archive is bigger than
+        // the archive, either way the download starts over.
+        StatusCode::OK | StatusCode::RANGE_NOT_SATISFIABLE => {
+            if downloaded > 0 {
+                archive.set_len(0).await?;
+                downloaded = 0;
+            }
+            if response.status() == StatusCode::RANGE_NOT_SATISFIABLE {
+                response = request(&client, &release.url, 0).await?;
+            }
+        }
+        _ => {}
+    }
+
+    let response = response
+        .error_for_status()
+        .context("Failed to download monero-wallet-rpc")?;
+    let total = downloaded + response.content_length().unwrap_or(0);
+
+    if downloaded > 0 {
+        tracing::info!(
+            "Resuming download of monero-wallet-rpc ({} of {}) from {}",
+            downloaded.big_byte(2),
+            total.big_byte(2),
+            release.url
+        );
+    } else {
+        tracing::info!(
+            "Downloading monero-wallet-rpc ({}) from {}",
+            total.big_byte(2),
+            release.url
+        );
+    }
+
+    let mut sha256 = Sha256::new();
+    let mut unpacker = Unpacker::spawn(unpack_path.to_path_buf());
+
+    // The bytes of the previous attempt go through the same pipeline, but only
+    // have to be read from disk.
+    let mut previous = File::open(archive_path).await?.take(downloaded);
+    let mut buffer = vec![0; 64 * 1024];
+    loop {
+        let read = previous.read(&mut buffer).await?;
+        if read == 0 {
+            break;
+        }
+
+        sha256.update(&buffer[..read]);
+        unpacker.feed(&buffer[..read]).await;
+    }
+
+    let mut stream = response.bytes_stream();
+    while let Some(chunk) = stream.next().await {
+        let chunk = chunk.context(
+            "Download of monero-wallet-rpc was interrupted, it will be resumed on the next start",
+        )?;
+
+        archive.write_all(&chunk).await?;
+        sha256.update(&chunk);
+        unpacker.feed(&chunk).await;
+    }
+
+    archive.sync_all().await?;
+    unpacker.finish().await?;
+
+    Ok(HEXLOWER.encode(&sha256.finalize()))
+}
+
+async fn request(client: &reqwest::Client, url: &Url, offset: u64) -> Result<reqwest::Response> {
+    let mut request = client.get(url.clone());
+    if offset > 0 {
+        request = request.header(RANGE, format!("bytes={}-", offset));
+    }
+
+    request
+        .send()
+        .await
+        .context("Failed to download monero-wallet-rpc")
+}
+
+/// Unpacks the monero-wallet-rpc from the archive as its bytes arrive.
+#[cfg(not(target_os = "windows"))]
+struct Unpacker {
+    /// Dropped once the unpacking is done, the remaining bytes are only
+    /// downloaded.
+    pipe: Option<tokio::io::DuplexStream>,
+    task: tokio::task::JoinHandle<Result<()>>,
+}
+
+#[cfg(not(target_os = "windows"))]
+impl Unpacker {
+    fn spawn(destination: PathBuf) -> Self {
+        let (pipe, reader) = tokio::io::duplex(64 * 1024);
+
+        Self {
+            pipe: Some(pipe),
+            task: tokio::spawn(unpack_tar_bz2(reader, destination)),
+        }
+    }
+
+    async fn feed(&mut self, bytes: &[u8]) {
+        if let Some(pipe) = &mut self.pipe {
+            if pipe.write_all(bytes).await.is_err() {
+                self.pipe = None;
+            }
+        }
+    }
+
+    async fn finish(mut self) -> Result<()> {
+        self.pipe = None;
+
+        self.task.await?
+    }
+}
+
+#[cfg(not(target_os = "windows"))]
+async fn unpack_tar_bz2(reader: tokio::io::DuplexStream, destination: PathBuf) -> Result<()> {
+    use async_compression::tokio::bufread::BzDecoder;
+    use tokio::io::BufReader;
+    use tokio_tar::Archive;
+
+    let mut archive = Archive::new(BzDecoder::new(BufReader::new(reader)));
+    let mut entries = archive.entries()?;
+
+    while let Some(entry) = entries.next().await {
+        let mut entry = entry?;
+
+        if entry
+            .path()?
+            .to_str()
+            .context("Could not find convert path to str in tar ball")?
+            .contains(PACKED_FILE)
+        {
+            entry.unpack(&destination).await?;
+            return Ok(());
+        }
+    }
+
+    bail!(ExecutableNotFoundInArchive)
+}
+
+/// Zip archives keep their index at the end, they are unpacked once the
+/// download is complete.
+#[cfg(target_os = "windows")]
+struct Unpacker;
+
+#[cfg(target_os = "windows")]
+impl Unpacker {
+    fn spawn(_: PathBuf) -> Self {
+        Self
+    }
+
+    async fn feed(&mut self, _: &[u8]) {}
+
+    async fn finish(self) -> Result<()> {
+        Ok(())
+    }
+}
+
+#[cfg(target_os = "windows")]
+async fn unpack_zip(archive_path: &Path, destination: &Path) -> Result<()> {
+    use std::fs::File;
+    use zip::ZipArchive;
+
+    let archive_path = archive_path.to_path_buf();
+    let destination = destination.to_path_buf();
+
+    tokio::task::spawn_blocking(move || {
+        let file = File::open(archive_path)?;
+        let mut zip = ZipArchive::new(file)?;
+
+        let name = zip
+            .file_names()
+            .find(|name| name.contains(PACKED_FILE))
+            .context(ExecutableNotFoundInArchive)?
+            .to_string();
+
+        let mut rpc = zip.by_name(&name)?;
+        let mut file = File::create(destination)?;
+        std::io::copy(&mut rpc, &mut file)?;
+
+        Ok(())
+    })
+    .await?
+}
+
+#[cfg(all(test, not(target_os = "windows")))]
+mod tests {
+    use super::*;
+    use std::sync::{Arc, Mutex};
+    use tokio::io::AsyncBufReadExt;
+    use tokio::net::{TcpListener, TcpStream};
+
+    const EXECUTABLE: &[u8] = b"#!/bin/sh\necho monero-wallet-rpc\n";
+
+    #[tokio::test]
+    async fn downloads_verifies_and_caches_executable() {
+        let archive = archive().await;
+        let server = StandIn::start(archive.clone(), None).await;
+        let cache_dir = tempfile::tempdir().unwrap();
+        let release = server.release(sha256(&archive));
+
+        let exec_path = cached_executable(cache_dir.path(), &release).await.unwrap();
+        let cached_exec_path = cached_executable(cache_dir.path(), &release).await.unwrap();
+
+        assert_eq!(tokio::fs::read(&exec_path).await.unwrap(), EXECUTABLE);
+        assert_eq!(cached_exec_path, exec_path);
+        assert_eq!(server.ranges(), vec![None]);
+        assert!(!exec_path.with_file_name("archive.partial").exists());
+    }
+
+    #[tokio::test]
+    async fn resumes_interrupted_download() {
+        let archive = archive().await;
+        let interrupt_after = archive.len() / 2;
+        let server = StandIn::start(archive.clone(), Some(interrupt_after)).await;
+        let cache_dir = tempfile::tempdir().unwrap();
+        let release = server.release(sha256(&archive));
+
+        let interrupted = cached_executable(cache_dir.path(), &release).await;
+        let exec_path = cached_executable(cache_dir.path(), &release).await.unwrap();
+
+        assert!(interrupted.is_err());
+        assert_eq!(tokio::fs::read(&exec_path).await.unwrap(), EXECUTABLE);
+        assert_eq!(server.ranges(), vec![None, Some(interrupt_after as u64)]);
+    }
+
+    #[tokio::test]
+    async fn rejects_archive_with_wrong_digest() {
+        let archive = archive().await;
+        let server = StandIn::start(archive, None).await;
+        let cache_dir = tempfile::tempdir().unwrap();
+        let release = server.release(sha256(b"something else"));
+
+        let result = cached_executable(cache_dir.path(), &release).await;
+
+        assert!(result.is_err());
+        let release_dir = cache_dir.path().join(release.name().unwrap());
+        assert!(!release_dir.join(PACKED_FILE).exists());
+        assert!(!release_dir.join("archive.partial").exists());
+    }
+
+    #[tokio::test]
+    async fn concurrent_processes_download_once() {
+        let archive = archive().await;
+        let server = StandIn::start(archive.clone(), None).await;
+        let cache_dir = tempfile::tempdir().unwrap();
+        let release = server.release(sha256(&archive));
+
+        let (first, second) = tokio::join!(
+            cached_executable(cache_dir.path(), &release),
+            cached_executable(cache_dir.path(), &release)
+        );
+
+        assert_eq!(first.unwrap(), second.unwrap());
+        assert_eq!(server.ranges(), vec![None]);
+    }
+
+    #[tokio::test]
+    async fn refuses_download_without_digest() {
+        let archive = archive().await;
+        let server = StandIn::start(archive, None).await;
+        let cache_dir = tempfile::tempdir().unwrap();
+
+        let result = cached_executable(cache_dir.path(), &server.release(String::new())).await;
+
+        assert!(result.is_err());
+        assert!(server.ranges().is_empty());
+    }
+
+    async fn archive() -> Vec<u8> {
+        use async_compression::tokio::write::BzEncoder;
+
+        let mut header = tokio_tar::Header::new_gnu();
+        header.set_size(EXECUTABLE.len() as u64);
+        header.set_mode(0o755);
+        header.set_cksum();
+
+        let mut builder = tokio_tar::Builder::new(Vec::new());
+        builder
+            .append_data(
+                &mut header,
+                "monero-x86_64-linux-gnu-v0.17.2.0/monero-wallet-rpc",
+                EXECUTABLE,
+            )
+            .await
+            .unwrap();
+        let tar = builder.into_inner().await.unwrap();
+
+        let mut encoder = BzEncoder::new(Vec::new());
+        encoder.write_all(&tar).await.unwrap();
+        encoder.shutdown().await.unwrap();
+
+        encoder.into_inner()
+    }
+
+    fn sha256(bytes: &[u8]) -> String {
+        HEXLOWER.encode(&Sha256::digest(bytes))
+    }
+
+    /// Serves a single file over HTTP, supporting range requests. The first
+    /// response can be cut off after some bytes.
+    struct StandIn {
+        port: u16,
+        ranges: Arc<Mutex<Vec<Option<u64>>>>,
+    }
+
+    impl StandIn {
+        async fn start(body: Vec<u8>, interrupt_after: Option<usize>) -> Self {
+            let listener = TcpListener::bind("127.0.0.1:0").await.unwrap();
+            let port = listener.local_addr().unwrap().port();
+            let ranges = Arc::new(Mutex::new(Vec::new()));
+
+            tokio::spawn({
+                let ranges = ranges.clone();
+                async move {
+                    let mut interrupt_after = interrupt_after;
+
+                    while let Ok((stream, _)) = listener.accept().await {
+                        let range = respond(stream, &body, interrupt_after.take()).await;
+                        ranges.lock().unwrap().push(range);
+                    }
+                }
+            });
+
+            Self { port, ranges }
+        }
+
+        fn release(&self, sha256: String) -> Release {
+            Release {
+                url: format!(
+                    "http://127.0.0.1:{}/cli/monero-linux-x64-v0.17.2.0.tar.bz2",
+                    self.port
+                )
+                .parse()
+                .unwrap(),
+                sha256,
+            }
+        }
+
+        fn ranges(&self) -> Vec<Option<u64>> {
+            self.ranges.lock().unwrap().clone()
+        }
+    }
+
+    async fn respond(
+        mut stream: TcpStream,
+        body: &[u8],
+        interrupt_after: Option<usize>,
+    ) -> Option<u64> {
+        let mut range = None;
+        let mut lines = tokio::io::BufReader::new(&mut stream).lines();
+        while let Some(line) = lines.next_line().await.unwrap() {
+            if line.is_empty() {
+                break;
+            }
+
+            let line = line.to_lowercase();
+            if let Some(value) = line.strip_prefix("range: bytes=") {
+                range = value.trim_end_matches('-').parse::<u64>().ok();
+            }
+        }
+
+        let offset = range.unwrap_or(0) as usize;
+        let head = match range {
+            Some(_) => format!(
+                "HTTP/1.1 206 Partial Content\r\nContent-Length: {}\r\nContent-Range: bytes {}-{}/{}\r\nConnection: close\r\n\r\n",
+                body.len() - offset,
+                offset,
+                body.len() - 1,
+                body.len()
+            ),
+            None => format!(
+                "HTTP/1.1 200 OK\r\nContent-Length: {}\r\nConnection: close\r\n\r\n",
+                body.len()
+            ),
+        };
+        let end = interrupt_after.unwrap_or_else(|| body.len());
+
+        stream.write_all(head.as_bytes()).await.unwrap();
+        stream.write_all(&body[offset..end]).await.unwrap();
+
+        range
+    }
+}
@@ -0,0 +1,122 @@
+use crate::monero::{WalletRpc, WalletRpcProcess};
+use ::monero::Network;
+use anyhow::{Context, Result};
+use monero_rpc::wallet;
+use std::sync::{Mutex, MutexGuard, PoisonError};
+use tokio::sync::{Semaphore, SemaphorePermit};
+
+/// How many worker processes may run at the same time.
+///
+/// Workers are only needed while a refund or redeem wallet is swept, which is
+/// rare compared to everything else the main wallet does.
+pub const MAX_WORKERS: usize = 3;
+
+/// Additional monero-wallet-rpc processes that wallets generated from keys are
+/// loaded into.
+///
+/// A monero-wallet-rpc can only have one wallet open at a time. Without
+/// workers, the main wallet has to be closed for as long as a generated wallet
+/// is refreshed and swept, blocking every other swap that needs it. Workers
+/// are spawned on demand and kept around for later use.
+#[derive(Debug)]
+pub struct WalletRpcPool {
+    wallet_rpc: WalletRpc,
+    network: Network,
+    daemon_address: String,
+    idle: Mutex<Vec<Worker>>,
+    slots: Semaphore,
+}
+
+impl WalletRpcPool {
+    pub fn new(wallet_rpc: WalletRpc, network: Network, daemon_address: String) -> Self {
+        Self {
+            wallet_rpc,
+            network,
+            daemon_address,
+            idle: Mutex::new(Vec::new()),
+            slots: Semaphore::new(MAX_WORKERS),
+        }
+    }
+
+    /// Hands out an idle worker, spawning a new one if there is none.
+    ///
+    /// Waits if [`MAX_WORKERS`] workers are in use already.
+    pub async fn acquire(&self) -> Result<PooledWorker<'_>> {
+        let slot = self
+            .slots
+            .acquire()
+            .await
+            .context("monero-wallet-rpc pool is closed")?;
+
+        let idle = self.idle().pop();
+        let worker = match idle {
+            Some(worker) => worker,
+            None => {
+                tracing::debug!("Starting monero-wallet-rpc worker");
+
+                let process = self
+                    .wallet_rpc
+                    .run(self.network, &self.daemon_address)
+                    .await
+                    .context("Failed to start monero-wallet-rpc worker")?;
+                let client = wallet::Client::new(process.endpoint())?;
+
+                Worker {
+                    client,
+                    _process: process,
+                }
+            }
+        };
+
+        Ok(PooledWorker {
+            worker: Some(worker),
+            pool: self,
+            _slot: slot,
+        })
+    }
+
+    fn idle(&self) -> MutexGuard<'_, Vec<Worker>> {
+        self.idle.lock().unwrap_or_else(PoisonError::into_inner)
+    }
+}
+
+#[derive(Debug)]
+struct Worker {
+    client: wallet::Client,
+    _process: WalletRpcProcess,
+}
+
+/// A worker taken from the [`WalletRpcPool`], it goes back into the pool when
+/// this is dropped.
+#[derive(Debug)]
+pub struct PooledWorker<'a> {
+    worker: Option<Worker>,
+    pool: &'a WalletRpcPool,
+    _slot: SemaphorePermit<'a>,
+}
+
+impl PooledWorker<'_> {
+    pub fn client(&self) -> &wallet::Client {
+        &self
+            .worker
+            .as_ref()
+            .expect("worker to be present until dropped")
+            .client
+    }
+
+    /// Stops the worker process instead of returning it to the pool.
+    ///
+    /// Used if the worker is in an unknown state, e.g. because a wallet could
+    /// not be closed.
+    pub fn retire(mut self) {
+        self.worker.take();
+    }
+}
+
+impl Drop for PooledWorker<'_> {
+    fn drop(&mut self) {
+        if let Some(worker) = self.worker.take() {
+            self.pool.idle().push(worker);
+        }
+    }
+}
@@ -3,8 +3,8 @@ use crate::network::swap_setup;
 use crate::network::swap_setup::{
     protocol, BlockchainNetwork, SpotPriceError, SpotPriceRequest, SpotPriceResponse,
 };
-use crate::protocol::alice::{State0, State3};
-use crate::protocol::{Message0, Message2, Message4};
+use crate::protocol::alice::{SpendKeySharePool, State0, State3};
+use crate::protocol::{crypto, Message0, Message2, Message4};
 use crate::{asb, bitcoin, env, monero};
 use anyhow::{anyhow, Context, Result};
 use futures::future::{BoxFuture, OptionFuture};
@@ -18,6 +18,7 @@ use libp2p::swarm::{
 use libp2p::{Multiaddr, PeerId};
 use std::collections::VecDeque;
 use std::fmt::Debug;
+use std::sync::Arc;
 use std::task::Poll;
 use std::time::{Duration, Instant};
 use uuid::Uuid;
@@ -47,22 +48,23 @@ pub struct WalletSnapshot {
 
     // TODO: Consider using the same address for punish and redeem (they are mutually exclusive, so
     // effectively the address will only be used once)
-    redeem_address: bitcoin::Address,
-    punish_address: bitcoin::Address,
+    redeem_address: bitcoin::PooledAddress,
+    punish_address: bitcoin::PooledAddress,
 
     redeem_fee: bitcoin::Amount,
     punish_fee: bitcoin::Amount,
 }
 
 impl WalletSnapshot {
+    /// Captures the Bitcoin side of the snapshot, `balance` is the Monero
+    /// that can be promised to the swap.
     pub async fn capture(
         bitcoin_wallet: &bitcoin::Wallet,
-        monero_wallet: &monero::Wallet,
+        balance: monero::Amount,
         transfer_amount: bitcoin::Amount,
     ) -> Result<Self> {
-        let balance = monero_wallet.get_balance().await?;
-        let redeem_address = bitcoin_wallet.new_address().await?;
-        let punish_address = bitcoin_wallet.new_address().await?;
+        let redeem_address = bitcoin_wallet.pooled_address().await?;
+        let punish_address = bitcoin_wallet.pooled_address().await?;
         let redeem_fee = bitcoin_wallet
             .estimate_fee(bitcoin::TxRedeem::weight(), transfer_amount)
             .await?;
@@ -115,6 +117,8 @@ pub struct Behaviour<LR> {
 
     latest_rate: LR,
     resume_only: bool,
+
+    spend_key_shares: Arc<SpendKeySharePool>,
 }
 
 impl<LR> Behaviour<LR> {
@@ -132,6 +136,7 @@ impl<LR> Behaviour<LR> {
             env_config,
             latest_rate,
             resume_only,
+            spend_key_shares: SpendKeySharePool::spawn(),
         }
     }
 }
@@ -150,6 +155,7 @@ where
             self.env_config,
             self.latest_rate.clone(),
             self.resume_only,
+            self.spend_key_shares.clone(),
         )
     }
 
@@ -206,6 +212,7 @@ pub struct Handler<LR> {
 
     latest_rate: LR,
     resume_only: bool,
+    spend_key_shares: Arc<SpendKeySharePool>,
 
     timeout: Duration,
     keep_alive: KeepAlive,
@@ -218,6 +225,7 @@ impl<LR> Handler<LR> {
         env_config: env::Config,
         latest_rate: LR,
         resume_only: bool,
+        spend_key_shares: Arc<SpendKeySharePool>,
     ) -> Self {
         Self {
             inbound_stream: OptionFuture::from(None),
@@ -227,6 +235,7 @@ impl<LR> Handler<LR> {
             env_config,
             latest_rate,
             resume_only,
+            spend_key_shares,
             timeout: Duration::from_secs(120),
             keep_alive: KeepAlive::Until(Instant::now() + Duration::from_secs(10)),
         }
@@ -271,6 +280,7 @@ where
         let max_buy = self.max_buy;
         let latest_rate = self.latest_rate.latest_rate();
         let env_config = self.env_config;
+        let spend_key_shares = self.spend_key_shares.clone();
 
         let protocol = tokio::time::timeout(self.timeout, async move {
             let request = swap_setup::read_cbor_message::<SpotPriceRequest>(&mut substream)
@@ -347,18 +357,19 @@ where
                 request.btc,
                 xmr,
                 env_config,
-                wallet_snapshot.redeem_address,
-                wallet_snapshot.punish_address,
+                wallet_snapshot.redeem_address.address().clone(),
+                wallet_snapshot.punish_address.address().clone(),
                 wallet_snapshot.redeem_fee,
                 wallet_snapshot.punish_fee,
+                spend_key_shares.take_or_generate().await?,
                 &mut rand::thread_rng(),
             );
 
             let message0 = swap_setup::read_cbor_message::<Message0>(&mut substream)
                 .await
                 .context("Failed to read message0")?;
-            let (swap_id, state1) = state0
-                .receive(message0)
+            let (swap_id, state1) = crypto::run(move || state0.receive(message0))
+                .await?
                 .context("Failed to transition state0 -> state1 using message0")?;
 
             swap_setup::write_cbor_message(&mut substream, state1.next_message())
@@ -372,15 +383,21 @@ where
                 .receive(message2)
                 .context("Failed to transition state1 -> state2 using message2")?;
 
-            swap_setup::write_cbor_message(&mut substream, state2.next_message())
+            let (state2, message3) = crypto::run(move || {
+                let message3 = state2.next_message();
+                (state2, message3)
+            })
+            .await?;
+
+            swap_setup::write_cbor_message(&mut substream, message3)
                 .await
                 .context("Failed to send message3")?;
 
             let message4 = swap_setup::read_cbor_message::<Message4>(&mut substream)
                 .await
                 .context("Failed to read message4")?;
-            let state3 = state2
-                .receive(message4)
+            let state3 = crypto::run(move || state2.receive(message4))
+                .await?
                 .context("Failed to transition state2 -> state3 using message4")?;
 
             substream
@@ -392,6 +409,11 @@ where
                 .await
                 .context("Failed to close substream after all messages were sent")?;
 
+            // Only now the addresses are used, if we fail earlier they go back into the
+            // pool.
+            let _ = wallet_snapshot.redeem_address.into_address();
+            let _ = wallet_snapshot.punish_address.into_address();
+
             Ok((swap_id, state3))
         });
 
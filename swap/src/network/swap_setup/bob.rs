@@ -3,7 +3,7 @@ use crate::network::swap_setup::{
     SpotPriceRequest, SpotPriceResponse,
 };
 use crate::protocol::bob::{State0, State2};
-use crate::protocol::{Message1, Message3};
+use crate::protocol::{crypto, Message1, Message3};
 use crate::{bitcoin, cli, env, monero};
 use anyhow::Result;
 use futures::future::{BoxFuture, OptionFuture};
@@ -165,18 +165,21 @@ impl ProtocolsHandler for Handler {
 
             let xmr = Result::from(read_cbor_message::<SpotPriceResponse>(&mut substream).await?)?;
 
-            let state0 = State0::new(
-                info.swap_id,
-                &mut rand::thread_rng(),
-                info.btc,
-                xmr,
-                env_config.bitcoin_cancel_timelock,
-                env_config.bitcoin_punish_timelock,
-                info.bitcoin_refund_address,
-                env_config.monero_finality_confirmations,
-                info.tx_refund_fee,
-                info.tx_cancel_fee,
-            );
+            let state0 = crypto::run(move || {
+                State0::new(
+                    info.swap_id,
+                    &mut rand::thread_rng(),
+                    info.btc,
+                    xmr,
+                    env_config.bitcoin_cancel_timelock,
+                    env_config.bitcoin_punish_timelock,
+                    info.bitcoin_refund_address,
+                    env_config.monero_finality_confirmations,
+                    info.tx_refund_fee,
+                    info.tx_cancel_fee,
+                )
+            })
+            .await?;
 
             write_cbor_message(&mut substream, state0.next_message()).await?;
             let message1 = read_cbor_message::<Message1>(&mut substream).await?;
@@ -184,7 +187,7 @@ impl ProtocolsHandler for Handler {
 
             write_cbor_message(&mut substream, state1.next_message()).await?;
             let message3 = read_cbor_message::<Message3>(&mut substream).await?;
-            let state2 = state1.receive(message3)?;
+            let state2 = crypto::run(move || state1.receive(message3)).await??;
 
             write_cbor_message(&mut substream, state2.next_message()).await?;
 
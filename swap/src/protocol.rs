@@ -9,6 +9,7 @@ use uuid::Uuid;
 
 pub mod alice;
 pub mod bob;
+pub mod crypto;
 
 pub static CROSS_CURVE_PROOF_SYSTEM: Lazy<
     CrossCurveDLEQ<HashTranscript<Sha256, rand_chacha::ChaCha20Rng>>,
@@ -6,9 +6,11 @@ use crate::{asb, bitcoin, monero};
 use std::sync::Arc;
 use uuid::Uuid;
 
+pub use self::spend_key_share::{SpendKeyShare, SpendKeySharePool, SpendKeySharePoolStats};
 pub use self::state::*;
 pub use self::swap::{run, run_until};
 
+mod spend_key_share;
 pub mod state;
 pub mod swap;
 
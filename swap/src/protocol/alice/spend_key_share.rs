@@ -0,0 +1,177 @@
+use crate::protocol::{crypto, CROSS_CURVE_PROOF_SYSTEM};
+use crate::{bitcoin, monero};
+use anyhow::Result;
+use rand::rngs::OsRng;
+use rand::{CryptoRng, RngCore};
+use sigma_fun::ext::dl_secp256k1_ed25519_eq::CrossCurveDLEQProof;
+use std::collections::VecDeque;
+use std::convert::TryFrom;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Mutex, MutexGuard, PoisonError, Weak};
+use std::time::{Duration, Instant};
+
+/// How many spend key shares are kept ready.
+const POOL_SIZE: usize = 8;
+
+const REFILL_INTERVAL: Duration = Duration::from_secs(1);
+
+/// Alice's share of the Monero spend key, together with the proof that the
+/// secret is the same on both curves.
+///
+/// Generating the proof is one of the most expensive steps of the swap setup,
+/// hence shares are usually taken from a [`SpendKeySharePool`].
+#[derive(Clone, Debug, PartialEq)]
+pub struct SpendKeyShare {
+    pub(super) s_a: monero::Scalar,
+    pub(super) S_a_bitcoin: bitcoin::PublicKey,
+    pub(super) S_a_monero: monero::PublicKey,
+    pub(super) dleq_proof_s_a: CrossCurveDLEQProof,
+}
+
+impl SpendKeyShare {
+    pub fn new_random<R>(rng: &mut R) -> Self
+    where
+        R: RngCore + CryptoRng,
+    {
+        let s_a = monero::Scalar::random(rng);
+        let (dleq_proof_s_a, (S_a_bitcoin, S_a_monero)) = CROSS_CURVE_PROOF_SYSTEM.prove(&s_a, rng);
+
+        Self {
+            s_a,
+            S_a_bitcoin: S_a_bitcoin.into(),
+            S_a_monero: monero::PublicKey {
+                point: S_a_monero.compress(),
+            },
+            dleq_proof_s_a,
+        }
+    }
+}
+
+/// Keeps a bounded number of [`SpendKeyShare`]s ready for incoming swap
+/// setups.
+///
+/// Shares are generated in the background on the [`crypto`] execution pool.
+/// Each share is handed out exactly once.
+#[derive(Debug, Default)]
+pub struct SpendKeySharePool {
+    shares: Mutex<VecDeque<SpendKeyShare>>,
+    hits: AtomicU64,
+    misses: AtomicU64,
+    refill_micros: AtomicU64,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct SpendKeySharePoolStats {
+    pub hits: u64,
+    pub misses: u64,
+    /// How long it took to generate the last share.
+    pub refill_time: Duration,
+}
+
+impl SpendKeySharePool {
+    /// Creates a new pool and starts filling it in the background.
+    ///
+    /// The background task stops once the pool is dropped.
+    pub fn spawn() -> Arc<Self> {
+        let pool = Arc::new(Self::default());
+        tokio::spawn(refill(Arc::downgrade(&pool)));
+
+        pool
+    }
+
+    /// Takes a ready share from the pool, or generates one right away if the
+    /// pool has run dry.
+    pub async fn take_or_generate(&self) -> Result<SpendKeyShare> {
+        if let Some(share) = self.shares().pop_front() {
+            self.hits.fetch_add(1, Ordering::Relaxed);
+            return Ok(share);
+        }
+
+        let misses = self.misses.fetch_add(1, Ordering::Relaxed) + 1;
+        tracing::debug!(%misses, "Spend key share pool is empty, generating share on demand");
+
+        crypto::run(|| SpendKeyShare::new_random(&mut OsRng)).await
+    }
+
+    pub fn stats(&self) -> SpendKeySharePoolStats {
+        SpendKeySharePoolStats {
+            hits: self.hits.load(Ordering::Relaxed),
+            misses: self.misses.load(Ordering::Relaxed),
+            refill_time: Duration::from_micros(self.refill_micros.load(Ordering::Relaxed)),
+        }
+    }
+
+    fn len(&self) -> usize {
+        self.shares().len()
+    }
+
+    fn push(&self, share: SpendKeyShare, refill_time: Duration) {
+        let refill_micros = u64::try_from(refill_time.as_micros()).unwrap_or(u64::MAX);
+        self.refill_micros.store(refill_micros, Ordering::Relaxed);
+
+        self.shares().push_back(share);
+    }
+
+    fn shares(&self) -> MutexGuard<'_, VecDeque<SpendKeyShare>> {
+        self.shares.lock().unwrap_or_else(PoisonError::into_inner)
+    }
+}
+
+async fn refill(pool: Weak<SpendKeySharePool>) {
+    let mut interval = tokio::time::interval(REFILL_INTERVAL);
+
+    loop {
+        interval.tick().await;
+
+        let pool = match pool.upgrade() {
+            Some(pool) => pool,
+            None => return,
+        };
+
+        if pool.len() >= POOL_SIZE {
+            continue;
+        }
+
+        while pool.len() < POOL_SIZE {
+            let started = Instant::now();
+            let share = match crypto::run(|| SpendKeyShare::new_random(&mut OsRng)).await {
+                Ok(share) => share,
+                Err(error) => {
+                    tracing::error!("Failed to generate spend key share: {:#}", error);
+                    break;
+                }
+            };
+
+            pool.push(share, started.elapsed());
+        }
+
+        let stats = pool.stats();
+        tracing::debug!(
+            hits = %stats.hits,
+            misses = %stats.misses,
+            refill_time_ms = %stats.refill_time.as_millis(),
+            "Refilled spend key share pool"
+        );
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[tokio::test]
+    async fn shares_are_handed_out_once_and_counted() {
+        let pool = SpendKeySharePool::default();
+        let share = SpendKeyShare::new_random(&mut OsRng);
+        pool.push(share.clone(), Duration::from_millis(100));
+
+        assert_eq!(pool.take_or_generate().await.unwrap(), share);
+        assert_ne!(pool.take_or_generate().await.unwrap(), share);
+
+        assert_eq!(pool.stats(), SpendKeySharePoolStats {
+            hits: 1,
+            misses: 1,
+            refill_time: Duration::from_millis(100),
+        });
+    }
+}
@@ -6,6 +6,7 @@ use crate::env::Config;
 use crate::monero::wallet::{TransferRequest, WatchRequest};
 use crate::monero::TransferProof;
 use crate::monero_ext::ScalarExt;
+use crate::protocol::alice::SpendKeyShare;
 use crate::protocol::{Message0, Message1, Message2, Message3, Message4, CROSS_CURVE_PROOF_SYSTEM};
 use crate::{bitcoin, monero};
 use anyhow::{anyhow, bail, Context, Result};
@@ -135,6 +136,7 @@ impl State0 {
         punish_address: bitcoin::Address,
         tx_redeem_fee: bitcoin::Amount,
         tx_punish_fee: bitcoin::Amount,
+        spend_key_share: SpendKeyShare,
         rng: &mut R,
     ) -> Self
     where
@@ -143,18 +145,13 @@ impl State0 {
         let a = bitcoin::SecretKey::new_random(rng);
         let v_a = monero::PrivateViewKey::new_random(rng);
 
-        let s_a = monero::Scalar::random(rng);
-        let (dleq_proof_s_a, (S_a_bitcoin, S_a_monero)) = CROSS_CURVE_PROOF_SYSTEM.prove(&s_a, rng);
-
         Self {
             a,
-            s_a,
+            s_a: spend_key_share.s_a,
             v_a,
-            S_a_bitcoin: S_a_bitcoin.into(),
-            S_a_monero: monero::PublicKey {
-                point: S_a_monero.compress(),
-            },
-            dleq_proof_s_a,
+            S_a_bitcoin: spend_key_share.S_a_bitcoin,
+            S_a_monero: spend_key_share.S_a_monero,
+            dleq_proof_s_a: spend_key_share.dleq_proof_s_a,
             redeem_address,
             punish_address,
             btc,
@@ -379,7 +376,7 @@ pub struct State3 {
     pub v: monero::PrivateViewKey,
     #[serde(with = "::bitcoin::util::amount::serde::as_sat")]
     btc: bitcoin::Amount,
-    xmr: monero::Amount,
+    pub xmr: monero::Amount,
     pub cancel_timelock: CancelTimelock,
     pub punish_timelock: PunishTimelock,
     refund_address: bitcoin::Address,
@@ -3,6 +3,7 @@
 use crate::asb::{EventLoopHandle, LatestRate};
 use crate::bitcoin::ExpiredTimelocks;
 use crate::env::Config;
+use crate::monero::wallet::RESTORE_HEIGHT_MAX_AGE;
 use crate::protocol::alice::{AliceState, Swap};
 use crate::{bitcoin, database, monero};
 use anyhow::{bail, Context, Result};
@@ -116,7 +117,9 @@ where
                 ExpiredTimelocks::None => {
                     // Record the current monero wallet block height so we don't have to scan from
                     // block 0 for scenarios where we create a refund wallet.
-                    let monero_wallet_restore_blockheight = monero_wallet.block_height().await?;
+                    let monero_wallet_restore_blockheight = monero_wallet
+                        .recent_block_height(RESTORE_HEIGHT_MAX_AGE)
+                        .await?;
 
                     let transfer_proof = monero_wallet
                         .transfer(state3.lock_xmr_transfer_request())
@@ -7,7 +7,9 @@ use crate::monero;
 use crate::monero::wallet::WatchRequest;
 use crate::monero::{monero_private_key, TransferProof};
 use crate::monero_ext::ScalarExt;
-use crate::protocol::{Message0, Message1, Message2, Message3, Message4, CROSS_CURVE_PROOF_SYSTEM};
+use crate::protocol::{
+    crypto, Message0, Message1, Message2, Message3, Message4, CROSS_CURVE_PROOF_SYSTEM,
+};
 use anyhow::{anyhow, bail, Context, Result};
 use bdk::database::BatchDatabase;
 use ecdsa_fun::adaptor::{Adaptor, HashTranscript};
@@ -155,16 +157,18 @@ impl State0 {
         C: EstimateFeeRate,
         D: BatchDatabase,
     {
-        let valid = CROSS_CURVE_PROOF_SYSTEM.verify(
-            &msg.dleq_proof_s_a,
-            (
-                msg.S_a_bitcoin.into(),
-                msg.S_a_monero
-                    .point
-                    .decompress()
-                    .ok_or_else(|| anyhow!("S_a is not a monero curve point"))?,
-            ),
-        );
+        let S_a_bitcoin = msg.S_a_bitcoin;
+        let S_a_monero = msg
+            .S_a_monero
+            .point
+            .decompress()
+            .ok_or_else(|| anyhow!("S_a is not a monero curve point"))?;
+        let dleq_proof_s_a = msg.dleq_proof_s_a.clone();
+
+        let valid = crypto::run(move || {
+            CROSS_CURVE_PROOF_SYSTEM.verify(&dleq_proof_s_a, (S_a_bitcoin.into(), S_a_monero))
+        })
+        .await?;
 
         if !valid {
             bail!("Alice's dleq proof doesn't verify")
@@ -363,7 +367,7 @@ pub struct State3 {
     S_a_monero: monero::PublicKey,
     S_a_bitcoin: bitcoin::PublicKey,
     v: monero::PrivateViewKey,
-    xmr: monero::Amount,
+    pub xmr: monero::Amount,
     pub cancel_timelock: CancelTimelock,
     punish_timelock: PunishTimelock,
     refund_address: bitcoin::Address,
@@ -505,7 +509,10 @@ impl State4 {
 
         let tx_redeem_sig =
             tx_redeem.extract_signature_by_key(tx_redeem_candidate, self.b.public())?;
-        let s_a = bitcoin::recover(self.S_a_bitcoin, tx_redeem_sig, tx_redeem_encsig)?;
+        let S_a_bitcoin = self.S_a_bitcoin;
+        let s_a =
+            crypto::run(move || bitcoin::recover(S_a_bitcoin, tx_redeem_sig, tx_redeem_encsig))
+                .await??;
         let s_a = monero::private_key_from_secp256k1_scalar(s_a.into());
 
         Ok(State5 {
@@ -1,9 +1,10 @@
 use crate::bitcoin::{ExpiredTimelocks, TxCancel, TxRefund};
 use crate::cli::EventLoopHandle;
 use crate::database::Swap;
+use crate::monero::wallet::RESTORE_HEIGHT_MAX_AGE;
 use crate::network::swap_setup::bob::NewSwap;
-use crate::protocol::bob;
 use crate::protocol::bob::state::*;
+use crate::protocol::{bob, crypto};
 use crate::{bitcoin, monero};
 use anyhow::{bail, Context, Result};
 use tokio::select;
@@ -107,7 +108,9 @@ async fn next_state(
 
                 // Record the current monero wallet block height so we don't have to scan from
                 // block 0 once we create the redeem wallet.
-                let monero_wallet_restore_blockheight = monero_wallet.block_height().await?;
+                let monero_wallet_restore_blockheight = monero_wallet
+                    .recent_block_height(RESTORE_HEIGHT_MAX_AGE)
+                    .await?;
 
                 tracing::info!("Waiting for Alice to lock Monero");
 
@@ -174,8 +177,14 @@ async fn next_state(
                 // Alice has locked Xmr
                 // Bob sends Alice his key
 
+                let tx_redeem_encsig = crypto::run({
+                    let state = state.clone();
+                    move || state.tx_redeem_encsig()
+                })
+                .await?;
+
                 select! {
-                    _ = event_loop_handle.send_encrypted_signature(state.tx_redeem_encsig()) => {
+                    _ = event_loop_handle.send_encrypted_signature(tx_redeem_encsig) => {
                         BobState::EncSigSent(state)
                     },
                     _ = tx_lock_status.wait_until_confirmed_with(state.cancel_timelock) => {
@@ -205,30 +214,15 @@ async fn next_state(
         BobState::BtcRedeemed(state) => {
             let (spend_key, view_key) = state.xmr_keys();
 
-            let wallet_file_name = swap_id.to_string();
-            if let Err(e) = monero_wallet
-                .create_from_and_load(
-                    wallet_file_name.clone(),
+            let tx_hashes = monero_wallet
+                .sweep_from(
+                    swap_id.to_string(),
                     spend_key,
                     view_key,
                     state.monero_wallet_restore_blockheight,
+                    monero_receive_address,
                 )
-                .await
-            {
-                // In case we failed to refresh/sweep, when resuming the wallet might already
-                // exist! This is a very unlikely scenario, but if we don't take care of it we
-                // might not be able to ever transfer the Monero.
-                tracing::warn!("Failed to generate monero wallet from keys: {:#}", e);
-                tracing::info!(%wallet_file_name,
-                    "Falling back to trying to open the the wallet if it already exists",
-                );
-                monero_wallet.open(wallet_file_name).await?;
-            }
-
-            // Ensure that the generated wallet is synced so we have a proper balance
-            monero_wallet.refresh().await?;
-            // Sweep (transfer all funds) to the given address
-            let tx_hashes = monero_wallet.sweep_all(monero_receive_address).await?;
+                .await?;
 
             for tx_hash in tx_hashes {
                 tracing::info!(%monero_receive_address, txid=%tx_hash.0, "Successfully transferred XMR to wallet");
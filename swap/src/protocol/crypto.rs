@@ -0,0 +1,77 @@
+//! Runs CPU-bound cryptography, such as cross-curve DLEQ proofs and adaptor
+//! signatures, on the blocking thread pool.
+//!
+//! The number of jobs running at the same time is bounded by the number of
+//! cores. Further jobs wait for a slot without occupying a thread, so a burst
+//! of swap setups neither starves the async runtime nor floods the blocking
+//! pool.
+
+use anyhow::{Context, Result};
+use conquer_once::Lazy;
+use std::time::{Duration, Instant};
+use tokio::sync::Semaphore;
+
+/// Jobs waiting longer than this for a slot are logged.
+const SLOW_QUEUE_THRESHOLD: Duration = Duration::from_millis(500);
+
+static SLOTS: Lazy<Semaphore> = Lazy::new(|| Semaphore::new(max_concurrent_jobs()));
+
+pub fn max_concurrent_jobs() -> usize {
+    num_cpus::get().max(1)
+}
+
+/// Runs the job on the blocking thread pool once a slot is free.
+pub async fn run<T, F>(job: F) -> Result<T>
+where
+    F: FnOnce() -> T + Send + 'static,
+    T: Send + 'static,
+{
+    let queued = Instant::now();
+    let _slot = SLOTS
+        .acquire()
+        .await
+        .context("Crypto execution pool is closed")?;
+
+    let waited = queued.elapsed();
+    if waited > SLOW_QUEUE_THRESHOLD {
+        tracing::debug!(
+            waited_ms = %waited.as_millis(),
+            "Crypto job was queued behind other jobs"
+        );
+    }
+
+    tokio::task::spawn_blocking(job)
+        .await
+        .context("Crypto job did not complete")
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::sync::atomic::{AtomicUsize, Ordering};
+    use std::sync::Arc;
+
+    #[tokio::test]
+    async fn never_runs_more_jobs_than_slots() {
+        let running = Arc::new(AtomicUsize::new(0));
+        let most_running = Arc::new(AtomicUsize::new(0));
+
+        let jobs = (0..max_concurrent_jobs() * 3).map(|_| {
+            let running = running.clone();
+            let most_running = most_running.clone();
+
+            run(move || {
+                let now_running = running.fetch_add(1, Ordering::SeqCst) + 1;
+                most_running.fetch_max(now_running, Ordering::SeqCst);
+                std::thread::sleep(Duration::from_millis(10));
+                running.fetch_sub(1, Ordering::SeqCst);
+            })
+        });
+
+        for result in futures::future::join_all(jobs).await {
+            result.unwrap();
+        }
+
+        assert!(most_running.load(Ordering::SeqCst) <= max_concurrent_jobs());
+    }
+}
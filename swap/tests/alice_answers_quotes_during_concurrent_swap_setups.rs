@@ -0,0 +1,81 @@
+pub mod harness;
+
+use harness::bob_run_until::is_btc_locked;
+use harness::SlowCancelConfig;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::Arc;
+use std::time::{Duration, Instant};
+use swap::protocol::bob;
+use tokio::time::{sleep, timeout};
+
+const CONCURRENT_SETUPS: usize = 5;
+const SETUP_DELAY: Duration = Duration::from_secs(1);
+const QUOTE_INTERVAL: Duration = Duration::from_millis(100);
+
+/// Capturing the wallet snapshot for a swap setup talks to both wallets. This
+/// must not hold up the event loop of the ASB, otherwise quote requests queue
+/// up behind swap setups.
+///
+/// Every request to Alice's monero-wallet-rpc is delayed by `SETUP_DELAY`. An
+/// event loop that asks the wallet for its balance while capturing a snapshot
+/// is blocked for at least that long per setup, and the quotes requested
+/// meanwhile take as long.
+#[tokio::test]
+async fn alice_answers_quotes_during_concurrent_swap_setups() {
+    harness::setup_test(SlowCancelConfig, |mut ctx| async move {
+        let (mut quote_swap, _quote_handle) = ctx.bob_swap().await;
+
+        let mut bob_swaps = Vec::new();
+        for _ in 0..CONCURRENT_SETUPS {
+            bob_swaps.push(ctx.bob_swap().await);
+        }
+
+        ctx.delay_alice_monero_wallet_rpc(SETUP_DELAY);
+
+        // Kick off all swap setups at once.
+        let finished_setups = Arc::new(AtomicUsize::new(0));
+        let bob_handles = bob_swaps
+            .into_iter()
+            .map(|(bob_swap, bob_handle)| {
+                let finished_setups = finished_setups.clone();
+                tokio::spawn(async move {
+                    bob::run_until(bob_swap, is_btc_locked).await.unwrap();
+                    finished_setups.fetch_add(1, Ordering::SeqCst);
+                });
+                bob_handle
+            })
+            .collect::<Vec<_>>();
+
+        let mut quotes = 0;
+        let mut slowest_quote = Duration::default();
+        timeout(Duration::from_secs(120), async {
+            while finished_setups.load(Ordering::SeqCst) < CONCURRENT_SETUPS {
+                let started = Instant::now();
+                quote_swap.event_loop_handle.request_quote().await?;
+                slowest_quote = slowest_quote.max(started.elapsed());
+                quotes += 1;
+
+                sleep(QUOTE_INTERVAL).await;
+            }
+
+            Ok::<_, anyhow::Error>(())
+        })
+        .await
+        .expect("Swap setups did not finish within 120 seconds")?;
+
+        assert!(quotes > 0);
+        assert!(
+            slowest_quote < SETUP_DELAY / 2,
+            "Quote took {:?} while swap setups were in flight, requests to the Monero wallet take {:?}",
+            slowest_quote,
+            SETUP_DELAY
+        );
+
+        for bob_handle in bob_handles {
+            bob_handle.abort();
+        }
+
+        Ok(())
+    })
+    .await;
+}
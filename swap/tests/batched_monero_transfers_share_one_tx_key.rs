@@ -0,0 +1,72 @@
+use monero_harness::Monero;
+use std::time::Duration;
+use swap::env::{GetConfig, Regtest};
+use swap::monero::wallet::TransferRequest;
+use swap::monero::{Address, Amount, Network, PrivateViewKey, PublicKey, Wallet};
+use testcontainers::clients::Cli;
+
+const FUNDS: u64 = 100_000_000_000_000;
+
+/// Transfers of a batch share the transaction and its key, each destination
+/// must still be able to verify what it received with them.
+#[tokio::test]
+async fn batched_monero_transfers_share_one_tx_key() {
+    let tc = Cli::default();
+    let (monero, _monerod_container, _wallet_containers) =
+        Monero::new(&tc, vec!["alice"]).await.unwrap();
+    monero.init_miner().await.unwrap();
+    monero.init_wallet("alice", vec![FUNDS]).await.unwrap();
+    monero.start_miner().await.unwrap();
+
+    let wallet = Wallet::connect(
+        monero.wallet("alice").unwrap().client().clone(),
+        "alice".to_owned(),
+        Regtest::get_config(),
+    )
+    .await
+    .unwrap()
+    .with_transfer_batching(Duration::from_secs(1));
+
+    let (first_request, first_address) = transfer_request(Amount::ONE_XMR);
+    let (second_request, second_address) = transfer_request(Amount::from_piconero(2_000_000_000));
+
+    let (first, second) = tokio::join!(
+        wallet.transfer(first_request),
+        wallet.transfer(second_request)
+    );
+    let (first, second) = (first.unwrap(), second.unwrap());
+
+    assert_eq!(first.tx_hash(), second.tx_hash());
+    assert_eq!(first.tx_key(), second.tx_key());
+
+    let daemon = monero_wallet::Wallet::new(monero.monerod().client().clone());
+    let txid = String::from(first.tx_hash());
+    let first_received = daemon
+        .check_tx_key(&txid, first.tx_key(), first_address)
+        .await
+        .unwrap()
+        .received;
+    let second_received = daemon
+        .check_tx_key(&txid, second.tx_key(), second_address)
+        .await
+        .unwrap()
+        .received;
+
+    assert_eq!(first_received, Amount::ONE_XMR.as_piconero());
+    assert_eq!(second_received, 2_000_000_000);
+}
+
+fn transfer_request(amount: Amount) -> (TransferRequest, Address) {
+    let mut rng = rand::thread_rng();
+    let spend_key = PublicKey::from_private_key(&PrivateViewKey::new_random(&mut rng).into());
+    let view_key = PrivateViewKey::new_random(&mut rng).public();
+    let address = Address::standard(Network::Mainnet, spend_key, view_key.into());
+
+    let request = TransferRequest {
+        public_spend_key: spend_key,
+        public_view_key: view_key,
+        amount,
+    };
+
+    (request, address)
+}
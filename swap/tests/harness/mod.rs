@@ -1,5 +1,6 @@
 mod bitcoind;
 mod electrs;
+mod slow_proxy;
 
 use anyhow::{bail, Context, Result};
 use async_trait::async_trait;
@@ -9,6 +10,8 @@ use get_port::get_port;
 use libp2p::core::Multiaddr;
 use libp2p::PeerId;
 use monero_harness::{image, Monero};
+use monero_rpc::wallet;
+use slow_proxy::SlowProxy;
 use std::cmp::Ordering;
 use std::fmt;
 use std::path::{Path, PathBuf};
@@ -64,11 +67,17 @@ where
         .get_host_port(electrs::RPC_PORT)
         .expect("Could not map electrs rpc port");
 
+    // Alice's requests to her monero-wallet-rpc go through a proxy that lets
+    // tests slow them down.
+    let alice_monero_wallet_rpc =
+        SlowProxy::start(monero.wallet(MONERO_WALLET_NAME_ALICE).unwrap().rpc_port()).await;
+
     let alice_seed = Seed::random().unwrap();
     let (alice_bitcoin_wallet, alice_monero_wallet) = init_test_wallets(
         MONERO_WALLET_NAME_ALICE,
         containers.bitcoind_url.clone(),
         &monero,
+        wallet::Client::localhost(alice_monero_wallet_rpc.port()).unwrap(),
         alice_starting_balances.clone(),
         tempdir().unwrap().path(),
         electrs_rpc_port,
@@ -100,6 +109,11 @@ where
         MONERO_WALLET_NAME_BOB,
         containers.bitcoind_url,
         &monero,
+        monero
+            .wallet(MONERO_WALLET_NAME_BOB)
+            .unwrap()
+            .client()
+            .clone(),
         bob_starting_balances.clone(),
         tempdir().unwrap().path(),
         electrs_rpc_port,
@@ -130,6 +144,7 @@ where
         alice_starting_balances,
         alice_bitcoin_wallet,
         alice_monero_wallet,
+        alice_monero_wallet_rpc,
         alice_swap_handle,
         alice_handle,
         bob_params,
@@ -264,6 +279,7 @@ async fn init_test_wallets(
     name: &str,
     bitcoind_url: Url,
     monero: &Monero,
+    monero_wallet_client: wallet::Client,
     starting_balances: StartingBalances,
     datadir: &Path,
     electrum_rpc_port: u16,
@@ -282,13 +298,10 @@ async fn init_test_wallets(
         .await
         .unwrap();
 
-    let xmr_wallet = swap::monero::Wallet::connect(
-        monero.wallet(name).unwrap().client().clone(),
-        name.to_string(),
-        env_config,
-    )
-    .await
-    .unwrap();
+    let xmr_wallet =
+        swap::monero::Wallet::connect(monero_wallet_client, name.to_string(), env_config)
+            .await
+            .unwrap();
 
     let electrum_rpc_url = {
         let input = format!("tcp://@localhost:{}", electrum_rpc_port);
@@ -296,7 +309,7 @@ async fn init_test_wallets(
     };
 
     let btc_wallet = swap::bitcoin::Wallet::new(
-        electrum_rpc_url,
+        vec![electrum_rpc_url],
         datadir,
         seed.derive_extended_private_key(env_config.bitcoin_network)
             .expect("Could not create extended private key from seed"),
@@ -499,6 +512,7 @@ pub struct TestContext {
     alice_starting_balances: StartingBalances,
     alice_bitcoin_wallet: Arc<bitcoin::Wallet>,
     alice_monero_wallet: Arc<monero::Wallet>,
+    alice_monero_wallet_rpc: SlowProxy,
     alice_swap_handle: mpsc::Receiver<Swap>,
     alice_handle: AliceApplicationHandle,
 
@@ -509,6 +523,11 @@ pub struct TestContext {
 }
 
 impl TestContext {
+    /// Delays every request Alice sends to her monero-wallet-rpc from now on.
+    pub fn delay_alice_monero_wallet_rpc(&self, delay: Duration) {
+        self.alice_monero_wallet_rpc.set_delay(delay);
+    }
+
     pub async fn restart_alice(&mut self) {
         self.alice_handle.abort();
 
@@ -628,9 +647,6 @@ impl TestContext {
         .await
         .unwrap();
 
-        // unload the generated wallet by opening the original wallet
-        self.bob_monero_wallet.re_open().await.unwrap();
-
         assert_eventual_balance(
             self.bob_monero_wallet.as_ref(),
             Ordering::Greater,
@@ -0,0 +1,77 @@
+use std::convert::TryFrom;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Arc;
+use std::time::Duration;
+use tokio::io::{AsyncReadExt, AsyncWriteExt};
+use tokio::net::{TcpListener, TcpStream};
+
+/// Forwards TCP connections to a local port, holding back everything the
+/// client sends by an adjustable delay.
+///
+/// Put in front of an RPC server, it makes every request take at least that
+/// long.
+#[derive(Debug, Clone)]
+pub struct SlowProxy {
+    port: u16,
+    delay_millis: Arc<AtomicU64>,
+}
+
+impl SlowProxy {
+    pub async fn start(target_port: u16) -> Self {
+        let listener = TcpListener::bind("127.0.0.1:0").await.unwrap();
+        let port = listener.local_addr().unwrap().port();
+        let delay_millis = Arc::new(AtomicU64::new(0));
+
+        tokio::spawn({
+            let delay_millis = delay_millis.clone();
+            async move {
+                while let Ok((client, _)) = listener.accept().await {
+                    tokio::spawn(forward(client, target_port, delay_millis.clone()));
+                }
+            }
+        });
+
+        Self { port, delay_millis }
+    }
+
+    pub fn port(&self) -> u16 {
+        self.port
+    }
+
+    pub fn set_delay(&self, delay: Duration) {
+        let millis = u64::try_from(delay.as_millis()).unwrap();
+        self.delay_millis.store(millis, Ordering::Relaxed);
+    }
+}
+
+async fn forward(client: TcpStream, target_port: u16, delay_millis: Arc<AtomicU64>) {
+    let upstream = match TcpStream::connect(("127.0.0.1", target_port)).await {
+        Ok(upstream) => upstream,
+        Err(_) => return,
+    };
+    let (mut client_read, mut client_write) = client.into_split();
+    let (mut upstream_read, mut upstream_write) = upstream.into_split();
+
+    let requests = async move {
+        let mut buffer = [0u8; 8192];
+        loop {
+            let read = match client_read.read(&mut buffer).await {
+                Ok(0) | Err(_) => break,
+                Ok(read) => read,
+            };
+
+            let delay = Duration::from_millis(delay_millis.load(Ordering::Relaxed));
+            tokio::time::sleep(delay).await;
+
+            if upstream_write.write_all(&buffer[..read]).await.is_err() {
+                break;
+            }
+        }
+        let _ = upstream_write.shutdown().await;
+    };
+    let responses = async move {
+        let _ = tokio::io::copy(&mut upstream_read, &mut client_write).await;
+    };
+
+    tokio::join!(requests, responses);
+}